@@ -0,0 +1,81 @@
+// headless dam break: a block of fluid collapses in a static container with
+// a few floating boxes, prints how long a tick of physics and fluid takes
+//
+// usage: fluid_benchmark [particle_count] [tick_count]
+#include <cstdio>
+#include <cstdlib>
+#include "core/coordinator.hpp"
+#include "physics/fluid_system.hpp"
+#include "physics/physics_system.hpp"
+#include "utils/time.hpp"
+
+using namespace emp;
+static std::vector<vec2f> rect(float width, float height) {
+    return {vec2f(-width / 2.f, -height / 2.f), vec2f(-width / 2.f, height / 2.f),
+            vec2f(width / 2.f, height / 2.f), vec2f(width / 2.f, -height / 2.f)};
+}
+static void addBody(Coordinator& ECS, vec2f position, float width, float height, bool isStatic, float density) {
+    auto entity = ECS.createEntity();
+    ECS.addComponent(entity, Transform(position));
+    ECS.addComponent(entity, Collider(rect(width, height)));
+    ECS.addComponent(entity, Rigidbody(isStatic, false, true, density));
+    ECS.addComponent(entity, Material());
+}
+int main(int argc, char** argv) {
+    const size_t particle_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000U;
+    const int tick_count = argc > 2 ? std::atoi(argv[2]) : 600;
+    const float delT = 1.f / 60.f;
+
+    Coordinator ECS;
+    ECS.registerComponent<Transform>();
+    ECS.registerComponent<Constraint>();
+    ECS.registerComponent<Material>();
+    ECS.registerComponent<Collider>();
+    ECS.registerComponent<Rigidbody>();
+    auto& transform_sys = ECS.registerSystem<TransformSystem>();
+    auto& rigidbody_sys = ECS.registerSystem<RigidbodySystem>();
+    auto& collider_sys = ECS.registerSystem<ColliderSystem>();
+    auto& constraint_sys = ECS.registerSystem<ConstraintSystem>();
+    auto& physics_sys = ECS.registerSystem<PhysicsSystem>();
+    auto& fluid_sys = ECS.registerSystem<FluidSystem>(std::ref(physics_sys.threadPool()));
+    ECS.addComponent(ECS.world(), Transform(vec2f(0.f, 0.f)));
+    physics_sys.gravity = vec2f(0.f, 1000.f);
+    fluid_sys.gravity = physics_sys.gravity;
+
+    // block of fluid twice as wide as high filling a third of the container
+    const float spacing = 2.f * fluid_sys.particle_radius;
+    const float block_height = std::sqrt(static_cast<float>(particle_count) / 2.f) * spacing;
+    const float block_width = 2.f * block_height;
+    const float width = 3.f * block_width;
+    const float height = 2.f * block_height;
+    addBody(ECS, vec2f(width / 2.f, height + 50.f), width + 200.f, 100.f, true, 1.f);
+    addBody(ECS, vec2f(-50.f, height / 2.f), 100.f, height + 200.f, true, 1.f);
+    addBody(ECS, vec2f(width + 50.f, height / 2.f), 100.f, height + 200.f, true, 1.f);
+    for (int i = 0; i < 5; i++) {
+        addBody(ECS, vec2f(block_width + (i + 1) * block_width / 3.f, height - 30.f), 40.f, 40.f, false, 0.5f);
+    }
+    fluid_sys.addBlock(AABB::CreateMinMax(vec2f(0.f, height - block_height), vec2f(block_width, height)));
+    fluid_sys.bounds = AABB::CreateMinMax(vec2f(-100.f, -height), vec2f(width + 100.f, height + 100.f));
+    std::printf("%zu particles, %d ticks\n", fluid_sys.particleCount(), tick_count);
+
+    double physics_time = 0.0;
+    double fluid_time = 0.0;
+    double slowest_tick = 0.0;
+    for (int tick = 0; tick < tick_count; tick++) {
+        Stopwatch physics_clock;
+        physics_sys.update(transform_sys, collider_sys, rigidbody_sys, constraint_sys, delT);
+        const double physics_tick = physics_clock.stop();
+        Stopwatch fluid_clock;
+        fluid_sys.update(delT);
+        const double fluid_tick = fluid_clock.stop();
+        physics_time += physics_tick;
+        fluid_time += fluid_tick;
+        slowest_tick = std::max(slowest_tick, physics_tick + fluid_tick);
+    }
+    const double ms = 1000.0 / tick_count;
+    std::printf("physics %.3f ms, fluid %.3f ms per tick, slowest tick %.3f ms\n", physics_time * ms,
+                fluid_time * ms, slowest_tick * 1000.0);
+    const bool isRealTime = (physics_time + fluid_time) / tick_count < delT;
+    std::printf("%s at %.0f Hz\n", isRealTime ? "keeps up" : "can not keep up", 1.f / delT);
+    return isRealTime ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+// headless integration: bodies fly without colliders, prints how long
+// integrating and deriving velocities takes over all substeps of a tick
+//
+// usage: rigidbody_benchmark [body_count] [tick_count] [substep_count]
+#include <cstdio>
+#include <cstdlib>
+#include "core/coordinator.hpp"
+#include "physics/collider.hpp"
+#include "physics/rigidbody.hpp"
+#include "utils/time.hpp"
+
+using namespace emp;
+int main(int argc, char** argv) {
+    const int body_count = std::min(argc > 1 ? std::atoi(argv[1]) : 4000, static_cast<int>(MAX_ENTITIES) - 1);
+    const int tick_count = argc > 2 ? std::atoi(argv[2]) : 1000;
+    const int substep_count = argc > 3 ? std::atoi(argv[3]) : 8;
+    const float delT = 1.f / 60.f;
+    const float substep_delT = delT / static_cast<float>(substep_count);
+
+    Coordinator ECS;
+    ECS.registerComponent<Transform>();
+    ECS.registerComponent<Rigidbody>();
+    ECS.registerComponent<Collider>();
+    ECS.registerSystem<TransformSystem>();
+    auto& rigidbody_sys = ECS.registerSystem<RigidbodySystem>();
+    ECS.addComponent(ECS.world(), Transform(vec2f(0.f, 0.f)));
+    std::vector<Rigidbody*> bodies;
+    for (int i = 0; i < body_count; i++) {
+        auto entity = ECS.createEntity();
+        ECS.addComponent(entity, Transform(vec2f(i % 64 * 10.f, i / 64 * 10.f)));
+        Rigidbody rigidbody;
+        rigidbody.useAutomaticMass = false;
+        rigidbody.real_mass = 1.f + static_cast<float>(i % 7);
+        rigidbody.velocity = vec2f(1.f, static_cast<float>(i % 5));
+        ECS.addComponent(entity, rigidbody);
+        bodies.push_back(ECS.getComponent<Rigidbody>(entity));
+    }
+    std::printf("%d bodies, %d ticks of %d substeps\n", body_count, tick_count, substep_count);
+
+    double total_time = 0.0;
+    for (int tick = 0; tick < tick_count; tick++) {
+        rigidbody_sys.gatherBodies();
+        for (auto* rigidbody : bodies) {
+            rigidbody->force = vec2f(0.f, 1000.f) * rigidbody->mass();
+        }
+        Stopwatch clock;
+        for (int substep = 0; substep < substep_count; substep++) {
+            rigidbody_sys.integrate(substep_delT);
+            rigidbody_sys.deriveVelocities(substep_delT);
+        }
+        total_time += clock.stop();
+    }
+    std::printf("%.3f ms per tick, %.1f ns per body and substep\n", total_time * 1000.0 / tick_count,
+                total_time * 1e9 / (static_cast<double>(tick_count) * substep_count * body_count));
+    return 0;
+}
@@ -0,0 +1,46 @@
+// headless falling sand: sand and water pour onto stone ledges of a world,
+// prints how long a step takes while it is busy and once it settled
+//
+// usage: sand_benchmark [world_size] [step_count]
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include "physics/sand_world.hpp"
+#include "utils/time.hpp"
+
+using namespace emp;
+int main(int argc, char** argv) {
+    const int size = argc > 1 ? std::atoi(argv[1]) : 1024;
+    const int step_count = argc > 2 ? std::atoi(argv[2]) : 600;
+    const float delT = 1.f / 60.f;
+
+    ThreadPool thread_pool{std::max(std::thread::hardware_concurrency(), 1U) - 1U};
+    SandWorld world(size, size, thread_pool);
+    world.fill(0, size - 8, size, 8, SandWorld::STONE);
+    for (int i = 0; i < 6; i++) {
+        const int y = size * (i + 2) / 9;
+        const int x = (i % 2 == 0) ? 0 : size / 3;
+        world.fill(x, y, size * 2 / 3, 4, SandWorld::STONE);
+    }
+    // about a third of the world starts falling at once
+    world.fill(size / 8, 0, size * 3 / 8, size / 6, SandWorld::SAND);
+    world.fill(size / 2, 0, size * 3 / 8, size / 6, SandWorld::WATER);
+    world.fill(0, size / 6, size, size / 24, SandWorld::OIL);
+    std::printf("%dx%d cells, %d steps\n", size, size, step_count);
+
+    double total_time = 0.0;
+    double slowest_step = 0.0;
+    for (int i = 0; i < step_count; i++) {
+        Stopwatch clock;
+        world.step();
+        world.takeChangedRows();
+        const double elapsed = clock.stop();
+        total_time += elapsed;
+        slowest_step = std::max(slowest_step, elapsed);
+    }
+    std::printf("%.3f ms per step, slowest step %.3f ms, %zu chunks still active\n",
+                total_time * 1000.0 / step_count, slowest_step * 1000.0, world.activeChunkCount());
+    const bool isRealTime = total_time / step_count < delT;
+    std::printf("%s at %.0f Hz\n", isRealTime ? "keeps up" : "can not keep up", 1.f / delT);
+    return isRealTime ? 0 : 1;
+}
@@ -13,24 +13,6 @@
 #include <vector>
 using namespace emp;
 
-class MouseSelectionSystem : public System<Transform, Collider, Rigidbody> {
-public:
-    std::vector<Entity> query(vec2f point) {
-        std::vector<Entity> result;
-        for(auto e : entities) {
-            auto& shape = getComponent<Collider>(e);
-            auto& transform = getComponent<Transform>(e);
-            auto transformed_outline = shape.transformed_outline(transform);
-            
-            auto overlap = isOverlappingPointPoly(point, transformed_outline);
-            if(overlap) {
-                result.push_back(e);
-            }
-        }
-        return result;
-    }
-};
-
 enum CollisionLayers {
     GROUND,
     PLAYER,
@@ -89,7 +71,6 @@ class Demo : public App {
 void Demo::onSetup(Window& window, Device& device) {
     Log::enableLoggingToCerr();
     gui_manager.alias(ECS.world(), "world_entity");
-    ECS.registerSystem<MouseSelectionSystem>();
     ECS.getSystem<ColliderSystem>()->disableCollision(FRIENDLY, FRIENDLY);
     ECS.getSystem<ColliderSystem>()->disableCollision(FRIENDLY, PLAYER);
 
@@ -276,7 +257,8 @@ void Demo::onUpdate(const float delta_time, Window& window, KeyboardController&
     
     auto mouse_pos = controller.global_mouse_pos();
     if (controller.get(eKeyMappings::Shoot).pressed) {
-        auto entities= ECS.getSystem<MouseSelectionSystem>()->query(mouse_pos);
+        std::vector<Entity> entities;
+        ECS.getSystem<PhysicsSystem>()->overlapPoint(mouse_pos, entities);
         if(entities.size() != 0) {
             if(ECS.isEntityAlive(mouse_entity)) {
                 ECS.removeComponentIfExists<Constraint>(mouse_entity);
@@ -301,7 +283,8 @@ void Demo::onUpdate(const float delta_time, Window& window, KeyboardController&
     }
     if(controller.get(eKeyMappings::Shoot).released) {
 
-        auto entities= ECS.getSystem<MouseSelectionSystem>()->query(mouse_pos);
+        std::vector<Entity> entities;
+        ECS.getSystem<PhysicsSystem>()->overlapPoint(mouse_pos, entities);
 
         if(entities.size() == 2 && ECS.getComponent<Constraint>(entities.front()) == nullptr) {
             assert(ECS.getComponent<Transform>(entities.front()) && ECS.getComponent<Transform>(entities.back()));
@@ -1,11 +1,13 @@
 #ifndef EMP_THREAD_POOL_HPP
 #define EMP_THREAD_POOL_HPP
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <queue>
-#include <vector>
 #include <thread>
-#include <mutex>
-#include <atomic>
+#include <vector>
 
 namespace emp {
 
@@ -24,12 +26,13 @@ class TaskQueue {
         target_callback = std::move(m_tasks.front());
         m_tasks.pop();
     }
-    void wait() {
+    // predicate guards against a task being pushed between getTask and wait
+    void wait(const std::atomic<bool>& running) {
         std::unique_lock<std::mutex> lk(m_mutex);
-        m_cond.wait(lk);
+        m_cond.wait(lk, [&]() { return !m_tasks.empty() || !running; });
     }
     void wakeUpAll() {
-        m_mutex.unlock();
+        std::lock_guard<std::mutex> lock_guard{m_mutex};
         m_cond.notify_all();
     }
     void workDone() {
@@ -39,9 +42,9 @@ public:
     template<typename TCallback>
     void addTask(TCallback&& callback) {
         std::lock_guard<std::mutex> lock_guard{m_mutex};
+        m_remaining_tasks++;
         m_tasks.push(std::forward<TCallback>(callback));
         m_cond.notify_all();
-        m_remaining_tasks++;
     }
 
     void waitForCompletion() const {
@@ -77,7 +80,7 @@ public:
         while (m_running) {
             m_queue->getTask(m_task);
             if (m_task == nullptr) {
-                m_queue->wait();
+                m_queue->wait(m_running);
             } else {
                 m_task();
                 m_queue->workDone();
@@ -124,9 +127,19 @@ public:
         m_queue.waitForCompletion();
     }
 
+    uint32_t threadCount() const
+    {
+        return m_thread_count;
+    }
+
     template<typename TCallback>
     void dispatch(uint32_t element_count, TCallback&& callback)
     {
+        // pool without workers, e.g. on a single core machine
+        if (m_thread_count == 0) {
+            callback(0, element_count);
+            return;
+        }
         const uint32_t batch_size = element_count / m_thread_count;
         for (uint32_t i{0}; i < m_thread_count; ++i) {
             const uint32_t start = batch_size * i;
@@ -47,7 +47,7 @@ namespace emp {
             getComponent<AnimatedSprite>(entity).updateState(entity, delta_time);
         }
     }
-    void AnimatedSpriteSystem::updateBuffer(int frameIndex) {
+    void AnimatedSpriteSystem::updateBuffer(int frameIndex, float interpolation) {
         // copy model matrix and normal matrix for each gameObj into
         // buffer for this frame
         uboBuffers[frameIndex]->map();
@@ -58,7 +58,7 @@ namespace emp {
             const auto& animated = getComponent<AnimatedSprite>(entity);
             SpriteInfo data{};
 
-            data.model_matrix = transform.global();
+            data.model_matrix = transform.interpolated(interpolation);
             data.offset_matrix = glm::translate(
                     glm::mat4x4(1.f), glm::vec3(animated.sprite().position_offset + animated.position_offset, 0)
             );
@@ -19,7 +19,8 @@ namespace emp {
         void render(FrameInfo& frame_info, SimpleRenderSystem& simple_rend_system);
 
         void updateTransitions(float delta_time);
-        void updateBuffer(int frameIndex);
+        // interpolation blends transforms of the last two fixed ticks
+        void updateBuffer(int frameIndex, float interpolation = 1.f);
         std::vector<std::unique_ptr<Buffer>> uboBuffers{
                 SwapChain::MAX_FRAMES_IN_FLIGHT
         };
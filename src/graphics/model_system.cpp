@@ -53,7 +53,7 @@ ModelSystem::ModelSystem(Device& device) {
     Texture::create("default", device, "../assets/textures/invalid.png");
 }
 
-void ModelSystem::updateBuffer(int frameIndex) {
+void ModelSystem::updateBuffer(int frameIndex, float interpolation) {
     // copy model matrix and normal matrix for each gameObj into
     // buffer for this frame
     for (auto e : entities) {
@@ -61,7 +61,7 @@ void ModelSystem::updateBuffer(int frameIndex) {
         const auto& transform = getComponent<Transform>(e);
         const auto& model = getComponent<Model>(e);
         ModelShaderInfo data{};
-        data.modelMatrix = transform.global();
+        data.modelMatrix = transform.interpolated(interpolation);
         data.color = model.color.value_or(glm::vec4{1, 1, 1, 1});
         uboBuffers[frameIndex]->writeToIndex(&data, e);
     }
@@ -34,7 +34,8 @@ public:
         return uboBuffers[frameIndex]->descriptorInfoForIndex(entity);
     }
 
-    void updateBuffer(int frameIndex);
+    // interpolation blends transforms of the last two fixed ticks
+    void updateBuffer(int frameIndex, float interpolation = 1.f);
     std::vector<std::unique_ptr<Buffer>> uboBuffers{
             SwapChain::MAX_FRAMES_IN_FLIGHT
     };
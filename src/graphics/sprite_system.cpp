@@ -40,7 +40,7 @@ void SpriteSystem::render(FrameInfo& frame_info, SimpleRenderSystem& simple_rend
     );
 }
 
-void SpriteSystem::updateBuffer(int frameIndex) {
+void SpriteSystem::updateBuffer(int frameIndex, float interpolation) {
     // copy model matrix and normal matrix for each gameObj into
     // buffer for this frame
     uboBuffers[frameIndex]->map();
@@ -50,7 +50,7 @@ void SpriteSystem::updateBuffer(int frameIndex) {
         const auto& sprite = getComponent<Sprite>(e);
         SpriteInfo data{};
 
-        data.model_matrix = transform.global();
+        data.model_matrix = transform.interpolated(interpolation);
         data.offset_matrix = glm::translate(
                 glm::mat4x4(1.f), glm::vec3(sprite.position_offset, 0)
         );
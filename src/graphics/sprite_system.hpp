@@ -31,7 +31,8 @@ struct SpriteSystem : public System<Sprite, Transform> {
 
     void render(FrameInfo& frame_info, SimpleRenderSystem& simple_rend_system);
 
-    void updateBuffer(int frameIndex);
+    // interpolation blends transforms of the last two fixed ticks
+    void updateBuffer(int frameIndex, float interpolation = 1.f);
     std::vector<std::unique_ptr<Buffer>> uboBuffers{
             SwapChain::MAX_FRAMES_IN_FLIGHT
     };
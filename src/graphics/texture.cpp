@@ -8,6 +8,7 @@
 #include <stb_image.h>
 
 // std
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
 
@@ -139,6 +140,48 @@ std::vector<TextureAsset::Pixel> TextureAsset::getPixelsFromGPU() {
 
     return pixels;
 }
+void TextureAsset::writePixels(const void* pixels, uint32_t first_row, uint32_t row_count) {
+    const uint32_t width = m_extent.width;
+    row_count = std::min(row_count, m_extent.height - std::min(first_row, m_extent.height));
+    if (row_count == 0) {
+        return;
+    }
+    if (m_staging_buffer == nullptr) {
+        m_staging_buffer = std::make_unique<Buffer>(
+                m_device,
+                sizeof(Pixel),
+                width * m_extent.height,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        m_staging_buffer->map();
+    }
+    const VkDeviceSize offset = static_cast<VkDeviceSize>(first_row) * width * sizeof(Pixel);
+    memcpy(static_cast<char*>(m_staging_buffer->getMappedMemory()) + offset,
+           static_cast<const char*>(pixels) + offset,
+           static_cast<size_t>(row_count) * width * sizeof(Pixel));
+
+    auto command_buffer = m_device.beginSingleTimeCommands();
+    transitionLayout(command_buffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    VkBufferImageCopy region{};
+    region.bufferOffset = offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = m_layer_count;
+    region.imageOffset = {0, static_cast<int32_t>(first_row), 0};
+    region.imageExtent = {width, row_count, 1};
+    vkCmdCopyBufferToImage(
+            command_buffer,
+            m_staging_buffer->getBuffer(),
+            m_texture_image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &region
+    );
+    transitionLayout(command_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    m_device.endSingleTimeCommands(command_buffer);
+    updateDescriptor();
+}
 void TextureAsset::createTextureImage(const std::string& filepath) {
     int texWidth, texHeight, texChannels;
     // stbi_set_flip_vertically_on_load(1);  // todo determine why texture
@@ -14,6 +14,7 @@
 #include <string>
 
 namespace emp {
+class Buffer;
 class TextureAsset {
 public:
     TextureAsset(Device& device, const std::string& textureFilepath);
@@ -84,6 +85,9 @@ public:
         unsigned char alpha;
     };
     std::vector<Pixel> getPixelsFromGPU();
+    // uploads rows [first_row, first_row + row_count) of a full image of tightly
+    // packed Pixels, the texture needs VK_IMAGE_USAGE_TRANSFER_DST_BIT
+    void writePixels(const void* pixels, uint32_t first_row = 0, uint32_t row_count = UINT32_MAX);
 
     static std::unique_ptr<TextureAsset> createTextureFromFile(
             Device& device, const std::string& filepath
@@ -106,6 +110,8 @@ private:
     uint32_t m_mip_levels{1};
     uint32_t m_layer_count{1};
     VkExtent3D m_extent{};
+    // kept mapped between writePixels calls
+    std::unique_ptr<Buffer> m_staging_buffer;
 };
 class Texture {
 private:
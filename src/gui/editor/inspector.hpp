@@ -121,7 +121,9 @@ void operator()(Entity e, Rigidbody& rigidbody) {
         ImGui::Checkbox("isStatic", &rigidbody.isStatic);
         ImGui::Text("time rested: %.2f", rigidbody.time_resting);
         ImGui::Checkbox("lock rotation", &rigidbody.isRotationLocked);
-        ImGui::Checkbox("use auto mass", &rigidbody.useAutomaticMass);
+        if (ImGui::Checkbox("use auto mass", &rigidbody.useAutomaticMass)) {
+            rigidbody.invalidateMass();
+        }
         ImGui::Indent();
         if(!rigidbody.useAutomaticMass && !rigidbody.isStatic) {
             ImGui::DragFloat("mass", &rigidbody.real_mass, 1.f, 1.f);
@@ -1,5 +1,10 @@
 #include "geometry_func.hpp"
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
 #include "debug/log.hpp"
 #include "math/math_func.hpp"
 namespace emp {
@@ -486,6 +491,248 @@ IntersectionRayPolygonResult intersectRayPolygon(
     }
     return {false};
 }
+float segmentEntryTimeAABB(vec2f ray_origin, vec2f ray_dir, const AABB& r) {
+    static const float eps = 1e-12f;
+    float t_enter = 0.f;
+    float t_exit = 1.f;
+    for (int axis = 0; axis < 2; axis++) {
+        if (std::abs(ray_dir[axis]) < eps) {
+            if (ray_origin[axis] < r.min[axis] || ray_origin[axis] > r.max[axis]) {
+                return INFINITY;
+            }
+            continue;
+        }
+        float t_near = (r.min[axis] - ray_origin[axis]) / ray_dir[axis];
+        float t_far = (r.max[axis] - ray_origin[axis]) / ray_dir[axis];
+        if (t_near > t_far) {
+            std::swap(t_near, t_far);
+        }
+        t_enter = std::max(t_enter, t_near);
+        t_exit = std::min(t_exit, t_far);
+        if (t_enter > t_exit) {
+            return INFINITY;
+        }
+    }
+    return t_enter;
+}
+// result for segments that start inside of the shape
+static IntersectionRayShapeResult startingInside(vec2f ray_origin, vec2f ray_dir) {
+    const vec2f back = ray_dir == vec2f(0.f, 0.f) ? vec2f(0.f, 0.f) : -normal(ray_dir);
+    return {true, 0.f, back, ray_origin};
+}
+IntersectionRayShapeResult intersectRayCircle(
+        vec2f ray_origin, vec2f ray_dir, const Circle& circle
+) {
+    const vec2f offset = ray_origin - circle.pos;
+    const float c = dot(offset, offset) - circle.radius * circle.radius;
+    if (c <= 0.f) {
+        return startingInside(ray_origin, ray_dir);
+    }
+    const float a = dot(ray_dir, ray_dir);
+    const float b = dot(offset, ray_dir);
+    const float discriminant = b * b - a * c;
+    if (a == 0.f || b >= 0.f || discriminant < 0.f) {
+        return {};
+    }
+    const float t = (-b - std::sqrt(discriminant)) / a;
+    if (t > 1.f) {
+        return {};
+    }
+    const vec2f point = ray_origin + ray_dir * t;
+    return {true, t, (point - circle.pos) / circle.radius, point};
+}
+IntersectionRayShapeResult intersectRayCapsule(
+        vec2f ray_origin, vec2f ray_dir, const Capsule& capsule
+) {
+    const vec2f segment = capsule.b - capsule.a;
+    const float segment_len = length(segment);
+    if (segment_len == 0.f) {
+        return intersectRayCircle(ray_origin, ray_dir, Circle(capsule.a, capsule.radius));
+    }
+    const vec2f closest = findClosestPointOnRay(capsule.a, segment, ray_origin);
+    if (length(ray_origin - closest) <= capsule.radius) {
+        return startingInside(ray_origin, ray_dir);
+    }
+    auto result = intersectRayCircle(ray_origin, ray_dir, Circle(capsule.a, capsule.radius));
+    const auto end_hit = intersectRayCircle(ray_origin, ray_dir, Circle(capsule.b, capsule.radius));
+    if (end_hit.time_hit < result.time_hit) {
+        result = end_hit;
+    }
+    // flat sides are offset copies of the core segment
+    const vec2f axis = segment / segment_len;
+    for (float sign : {1.f, -1.f}) {
+        const vec2f side_normal = vec2f(-axis.y, axis.x) * sign;
+        const float approach = dot(side_normal, ray_dir);
+        if (approach >= 0.f) {
+            continue;
+        }
+        const vec2f side_point = capsule.a + side_normal * capsule.radius;
+        const float t = dot(side_normal, side_point - ray_origin) / approach;
+        if (t < 0.f || t > 1.f || t >= result.time_hit) {
+            continue;
+        }
+        const vec2f point = ray_origin + ray_dir * t;
+        const float along = dot(point - side_point, axis);
+        if (along >= 0.f && along <= segment_len) {
+            result = {true, t, side_normal, point};
+        }
+    }
+    return result;
+}
+IntersectionRayShapeResult intersectRayConvex(
+        vec2f ray_origin, vec2f ray_dir, const ConvexPiece& piece
+) {
+    static const float eps = 1e-12f;
+    float t_enter = 0.f;
+    float t_exit = 1.f;
+    size_t entry_face = piece.vertices.size();
+    for (size_t i = 0; i < piece.vertices.size(); i++) {
+        const vec2f n = piece.normals[i];
+        const float distance = dot(n, ray_origin - piece.vertices[i]);
+        const float approach = dot(n, ray_dir);
+        if (std::abs(approach) < eps) {
+            if (distance > 0.f) {
+                return {};
+            }
+            continue;
+        }
+        const float t = -distance / approach;
+        if (approach < 0.f) {
+            if (t > t_enter) {
+                t_enter = t;
+                entry_face = i;
+            }
+        } else {
+            t_exit = std::min(t_exit, t);
+        }
+        if (t_enter > t_exit) {
+            return {};
+        }
+    }
+    if (entry_face == piece.vertices.size()) {
+        return startingInside(ray_origin, ray_dir);
+    }
+    return {true, t_enter, piece.normals[entry_face], ray_origin + ray_dir * t_enter};
+}
+#if defined(__SSE__)
+// lanes of mask take a, others b
+static inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+static inline __m128 absolute(__m128 x) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.f), x);
+}
+#endif
+uint32_t segmentPacketEntryMaskAABB(const RayPacket& packet, const AABB& r) {
+#if defined(__SSE__)
+    const __m128 eps = _mm_set1_ps(1e-12f);
+    const __m128 inf = _mm_set1_ps(INFINITY);
+    __m128 t_enter = _mm_setzero_ps();
+    __m128 t_exit = _mm_load_ps(packet.max_time);
+    auto clipAxis = [&](const float* origin_lanes, const float* dir_lanes, float min, float max) {
+        const __m128 origin = _mm_load_ps(origin_lanes);
+        const __m128 dir = _mm_load_ps(dir_lanes);
+        const __m128 t1 = _mm_div_ps(_mm_sub_ps(_mm_set1_ps(min), origin), dir);
+        const __m128 t2 = _mm_div_ps(_mm_sub_ps(_mm_set1_ps(max), origin), dir);
+        // lanes parallel to the slab either always or never lie within it
+        const __m128 parallel = _mm_cmplt_ps(absolute(dir), eps);
+        const __m128 inside = _mm_and_ps(
+                _mm_cmpge_ps(origin, _mm_set1_ps(min)), _mm_cmple_ps(origin, _mm_set1_ps(max))
+        );
+        const __m128 t_near = select(parallel, select(inside, _mm_sub_ps(_mm_setzero_ps(), inf), inf), _mm_min_ps(t1, t2));
+        const __m128 t_far = select(parallel, select(inside, inf, _mm_sub_ps(_mm_setzero_ps(), inf)), _mm_max_ps(t1, t2));
+        t_enter = _mm_max_ps(t_enter, t_near);
+        t_exit = _mm_min_ps(t_exit, t_far);
+    };
+    clipAxis(packet.origin_x, packet.dir_x, r.min.x, r.max.x);
+    clipAxis(packet.origin_y, packet.dir_y, r.min.y, r.max.y);
+    return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(t_enter, t_exit)));
+#else
+    uint32_t result = 0;
+    for (size_t i = 0; i < RayPacket::WIDTH; i++) {
+        const vec2f origin(packet.origin_x[i], packet.origin_y[i]);
+        const vec2f dir(packet.dir_x[i], packet.dir_y[i]);
+        const float entry = segmentEntryTimeAABB(origin, dir * packet.max_time[i], r);
+        if (packet.max_time[i] >= 0.f && entry != INFINITY) {
+            result |= 1U << i;
+        }
+    }
+    return result;
+#endif
+}
+uint32_t intersectRayPacketConvex(
+        const RayPacket& packet,
+        const ConvexPiece& piece,
+        float time_hit[RayPacket::WIDTH],
+        vec2f contact_normal[RayPacket::WIDTH]
+) {
+#if defined(__SSE__)
+    const __m128 eps = _mm_set1_ps(1e-12f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 origin_x = _mm_load_ps(packet.origin_x);
+    const __m128 origin_y = _mm_load_ps(packet.origin_y);
+    const __m128 dir_x = _mm_load_ps(packet.dir_x);
+    const __m128 dir_y = _mm_load_ps(packet.dir_y);
+    __m128 t_enter = zero;
+    __m128 t_exit = _mm_load_ps(packet.max_time);
+    // face index stored as float, -1 while lane starts inside of every face
+    __m128 entry_face = _mm_set1_ps(-1.f);
+    __m128 alive = _mm_cmple_ps(t_enter, t_exit);
+    for (size_t i = 0; i < piece.vertices.size() && _mm_movemask_ps(alive) != 0; i++) {
+        const __m128 nx = _mm_set1_ps(piece.normals[i].x);
+        const __m128 ny = _mm_set1_ps(piece.normals[i].y);
+        const __m128 distance = _mm_add_ps(
+                _mm_mul_ps(nx, _mm_sub_ps(origin_x, _mm_set1_ps(piece.vertices[i].x))),
+                _mm_mul_ps(ny, _mm_sub_ps(origin_y, _mm_set1_ps(piece.vertices[i].y)))
+        );
+        const __m128 approach = _mm_add_ps(_mm_mul_ps(nx, dir_x), _mm_mul_ps(ny, dir_y));
+        const __m128 parallel = _mm_cmplt_ps(absolute(approach), eps);
+        const __m128 t = _mm_div_ps(_mm_sub_ps(zero, distance), approach);
+        const __m128 entering = _mm_andnot_ps(parallel, _mm_cmplt_ps(approach, zero));
+        const __m128 leaving = _mm_andnot_ps(parallel, _mm_cmpgt_ps(approach, zero));
+        const __m128 later_entry = _mm_and_ps(entering, _mm_cmpgt_ps(t, t_enter));
+        t_enter = select(later_entry, t, t_enter);
+        entry_face = select(later_entry, _mm_set1_ps(static_cast<float>(i)), entry_face);
+        t_exit = select(leaving, _mm_min_ps(t_exit, t), t_exit);
+        alive = _mm_andnot_ps(_mm_and_ps(parallel, _mm_cmpgt_ps(distance, zero)), alive);
+        alive = _mm_and_ps(alive, _mm_cmple_ps(t_enter, t_exit));
+    }
+    const uint32_t result = static_cast<uint32_t>(_mm_movemask_ps(alive));
+    alignas(16) float faces[RayPacket::WIDTH];
+    alignas(16) float times[RayPacket::WIDTH];
+    _mm_store_ps(faces, entry_face);
+    _mm_store_ps(times, t_enter);
+    for (size_t lane = 0; lane < RayPacket::WIDTH; lane++) {
+        if (((result >> lane) & 1U) == 0) {
+            continue;
+        }
+        time_hit[lane] = times[lane];
+        if (faces[lane] < 0.f) {
+            const vec2f dir(packet.dir_x[lane], packet.dir_y[lane]);
+            contact_normal[lane] = dir == vec2f(0.f, 0.f) ? vec2f(0.f, 0.f) : -normal(dir);
+        } else {
+            contact_normal[lane] = piece.normals[static_cast<size_t>(faces[lane])];
+        }
+    }
+    return result;
+#else
+    uint32_t result = 0;
+    for (size_t lane = 0; lane < RayPacket::WIDTH; lane++) {
+        const vec2f origin(packet.origin_x[lane], packet.origin_y[lane]);
+        const vec2f dir(packet.dir_x[lane], packet.dir_y[lane]);
+        if (packet.max_time[lane] < 0.f) {
+            continue;
+        }
+        const auto hit = intersectRayConvex(origin, dir * packet.max_time[lane], piece);
+        if (hit.detected) {
+            time_hit[lane] = hit.time_hit * packet.max_time[lane];
+            contact_normal[lane] = hit.contact_normal;
+            result |= 1U << lane;
+        }
+    }
+    return result;
+#endif
+}
 vec2f findClosestPointOnRay(vec2f ray_origin, vec2f ray_dir, vec2f point) {
     float ray_dir_len = length(ray_dir);
     vec2f ray_dir_normal = ray_dir / ray_dir_len;
@@ -634,89 +881,221 @@ float area(const std::vector<vec2f>& model) {
 // std::pair<float, float> calcProjectionPolygon(const std::vector<vec2f>&r,
 // vec2f projectionAxis) {
 // }
-struct IntersetionPolygonPolygonAxis {
-    bool detected = false;
-    float overlap = INFINITY;
-    vec2f cn;
-    bool foundSeparatingAxis = false;
-    vec2f most_pertruding;
-};
-template <class Key, class Data>
-std::pair<Key, Data> compMax(std::pair<Key, Data> p1, std::pair<Key, Data> p2) {
-    return (p1.first > p2.first ? p1 : p2);
+// outward normal of edge [idx, idx + 1], orientation is the sign of
+// polygon's winding so that it works for both orderings of vertices
+static vec2f edgeOutwardNormal(
+        const std::vector<vec2f>& poly, size_t idx, float orientation
+) {
+    vec2f edge = poly[(idx + 1) % poly.size()] - poly[idx];
+    return normal(vec2f(edge.y, -edge.x)) * orientation;
 }
-template <class Key, class Data>
-std::pair<Key, Data> compMin(std::pair<Key, Data> p1, std::pair<Key, Data> p2) {
-    return (p1.first < p2.first ? p1 : p2);
+static float windingOrientation(const std::vector<vec2f>& poly) {
+    float signed_area = 0.f;
+    for (size_t i = 0; i < poly.size(); i++) {
+        signed_area += perp_dot(poly[i], poly[(i + 1) % poly.size()]);
+    }
+    return signed_area < 0.f ? -1.f : 1.f;
 }
-IntersectionPolygonPolygonResult intersectPolygonPolygon(
-        const std::vector<vec2f>& r1, const std::vector<vec2f>& r2
+// clips segment to lo <= dot(tangent, p) <= hi, ids of clipped ends become
+// 2 + side of the plane, returns false if nothing is left
+static bool clipToSlab(
+        vec2f (&points)[2], uint32_t (&ids)[2], vec2f tangent, float lo, float hi
 ) {
-    float overlap = INFINITY;
-    vec2f cn;
+    for (int side = 0; side < 2; side++) {
+        float sign = side == 0 ? 1.f : -1.f;
+        float offset = side == 0 ? lo : -hi;
+        float d0 = dot(tangent, points[0]) * sign - offset;
+        float d1 = dot(tangent, points[1]) * sign - offset;
+        if (d0 < 0.f && d1 < 0.f) {
+            return false;
+        }
+        if (d0 < 0.f || d1 < 0.f) {
+            int outside = d0 < 0.f ? 0 : 1;
+            float t = d0 / (d0 - d1);
+            points[outside] = points[0] + (points[1] - points[0]) * t;
+            ids[outside] = 2 + side;
+        }
+    }
+    return true;
+}
+ConvexPiece::ConvexPiece(std::vector<vec2f> verts) : vertices(std::move(verts)) {
+    const float orientation = windingOrientation(vertices);
+    normals.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        normals[i] = edgeOutwardNormal(vertices, i, orientation);
+    }
+}
+static_assert(sizeof(vec2f) == 2 * sizeof(float), "vertices are read as packed floats");
+// smallest projection of vertices onto axis
+static float minProjection(const std::vector<vec2f>& vertices, vec2f axis) {
+    float result = INFINITY;
+    size_t i = 0;
+#if defined(__SSE__)
+    // two vertices per register, lanes 0 and 2 end up holding their dot products
+    const float* data = &vertices[0].x;
+    const __m128 axis2 = _mm_setr_ps(axis.x, axis.y, axis.x, axis.y);
+    __m128 smallest = _mm_set1_ps(INFINITY);
+    for (; i + 2 <= vertices.size(); i += 2) {
+        const __m128 prod = _mm_mul_ps(_mm_loadu_ps(data + 2 * i), axis2);
+        const __m128 sum =
+                _mm_add_ps(prod, _mm_shuffle_ps(prod, prod, _MM_SHUFFLE(2, 3, 0, 1)));
+        smallest = _mm_min_ps(smallest, sum);
+    }
+    smallest = _mm_min_ps(smallest, _mm_movehl_ps(smallest, smallest));
+    result = _mm_cvtss_f32(smallest);
+#endif
+    for (; i < vertices.size(); i++) {
+        result = std::min(result, dot(vertices[i], axis));
+    }
+    return result;
+}
+// distance of 'other' from face of 'poly' along its normal, negative if penetrating
+static float faceSeparation(const ConvexPiece& poly, size_t face, const ConvexPiece& other) {
+    return minProjection(other.vertices, poly.normals[face]) -
+           dot(poly.normals[face], poly.vertices[face]);
+}
+// returns separation of the face with the largest one, stops at the first
+// separating face since that is enough to reject the pair
+static float maxFaceSeparation(const ConvexPiece& poly, const ConvexPiece& other, size_t& face) {
+    float result = -INFINITY;
+    for (size_t i = 0; i < poly.normals.size(); i++) {
+        const float separation = faceSeparation(poly, i, other);
+        if (separation > result) {
+            result = separation;
+            face = i;
+        }
+        if (separation > 0.f) {
+            break;
+        }
+    }
+    return result;
+}
+// clips incident edge of 'incident' against side planes of reference edge of
+// 'reference', returns number of points that lie below the reference face
+static uint8_t clipContactManifold(
+        const ConvexPiece& reference,
+        size_t ref_edge,
+        const ConvexPiece& incident,
+        ContactManifoldPoint (&out)[2]
+) {
+    const vec2f normal_dir = reference.normals[ref_edge];
+    size_t inc_edge = 0;
+    float best_inc = INFINITY;
+    for (size_t i = 0; i < incident.normals.size(); i++) {
+        float d = dot(incident.normals[i], normal_dir);
+        if (d < best_inc) {
+            best_inc = d;
+            inc_edge = i;
+        }
+    }
+    const auto& ref_vertices = reference.vertices;
+    const auto& inc_vertices = incident.vertices;
+    vec2f ref_a = ref_vertices[ref_edge];
+    vec2f ref_b = ref_vertices[(ref_edge + 1) % ref_vertices.size()];
+    vec2f tangent = normal(ref_b - ref_a);
 
-    int incidentEdgeOwner = -1;
-    std::pair<vec2f, vec2f> incident_edge;
-    vec2f contact_vertex;
-
-    for (int flipShapes = 0; flipShapes < 2; flipShapes++) {
-        auto& poly1 = (flipShapes ? r2 : r1);
-        auto& poly2 = (flipShapes ? r1 : r2);
-        vec2f contact_vertex_p1;
-        vec2f contact_vertex_p2;
-        for (int a = 0; a < poly1.size(); a++) {
-            int b = (a + 1) % poly1.size();
-            vec2f axis_proj_perp = poly1[b] - poly1[a];
-            vec2f axis_proj =
-                    normal(vec2f(-axis_proj_perp.y, axis_proj_perp.x));
-
-            std::pair<float, vec2f> min_r1 = {INFINITY, {}},
-                                    max_r1 = {-INFINITY, {}};
-            for (int p = 0; p < poly1.size(); p++) {
-                float q = dot(poly1[p], axis_proj);
-                min_r1 = compMin(min_r1, {q, poly1[p]});
-                max_r1 = compMax(max_r1, {q, poly1[p]});
-            }
-
-            std::pair<float, vec2f> min_r2 = {INFINITY, {}},
-                                    max_r2 = {-INFINITY, {}};
-            for (int p = 0; p < poly2.size(); p++) {
-                float q = dot(poly2[p], axis_proj);
-                min_r2 = compMin(min_r2, {q, poly2[p]});
-                max_r2 = compMax(max_r2, {q, poly2[p]});
-            }
-
-            auto minmax = compMin(max_r1, max_r2).first;
-            auto maxmin = compMax(min_r1, min_r2).first;
-            auto current_overlap = minmax - maxmin;
-            if (current_overlap < overlap && maxmin == min_r2.first) {
-                overlap = current_overlap;
-                cn = axis_proj;
-                incidentEdgeOwner = flipShapes;
-                incident_edge.first = poly1[a];
-                incident_edge.second = poly1[b];
-                contact_vertex = min_r2.second;
-
-                if (!flipShapes) {
-                    cn *= -1.f;
-                }
-            }
+    vec2f clipped[2] = {
+            inc_vertices[inc_edge], inc_vertices[(inc_edge + 1) % inc_vertices.size()]
+    };
+    // which incident vertex, or which side plane produced the clipped point
+    uint32_t clip_ids[2] = {0, 1};
+    if (!clipToSlab(clipped, clip_ids, tangent, dot(tangent, ref_a), dot(tangent, ref_b))) {
+        return 0;
+    }
 
-            if (!(max_r2.first >= min_r1.first && max_r1.first >= min_r2.first))
-                return {false};
+    const float face = dot(normal_dir, ref_a);
+    uint8_t count = 0;
+    for (int i = 0; i < 2; i++) {
+        float depth = face - dot(normal_dir, clipped[i]);
+        if (depth < 0.f) {
+            continue;
         }
+        out[count].point1 = clipped[i] + normal_dir * depth;
+        out[count].point2 = clipped[i];
+        out[count].depth = depth;
+        out[count].feature_id = (static_cast<uint32_t>(ref_edge) << 16) |
+                                (static_cast<uint32_t>(inc_edge) << 8) |
+                                clip_ids[i];
+        count++;
     }
-    if (overlap == 0.f)
+    return count;
+}
+IntersectionPolygonPolygonResult intersectPolygonPolygon(
+        const ConvexPiece& r1, const ConvexPiece& r2, uint32_t& separating_axis
+) {
+    // axis that separated the pair last time most likely still does
+    const bool isHintOnSecond = (separating_axis >> 16) != 0;
+    const size_t hint_face = separating_axis & 0xFFFFU;
+    const auto& hint_poly = (isHintOnSecond ? r2 : r1);
+    if (hint_face < hint_poly.normals.size() &&
+        faceSeparation(hint_poly, hint_face, isHintOnSecond ? r1 : r2) > 0.f) {
         return {false};
+    }
 
-    auto closest = findClosestPointOnRay(
-            incident_edge.first,
-            incident_edge.second - incident_edge.first,
-            contact_vertex
-    );
-    auto cp1 = (incidentEdgeOwner ? contact_vertex : closest);
-    auto cp2 = cp1;
-    return {true, cn, overlap, cp1, cp2};
+    size_t face1 = 0;
+    const float separation1 = maxFaceSeparation(r1, r2, face1);
+    if (separation1 > 0.f) {
+        separating_axis = static_cast<uint32_t>(face1);
+        return {false};
+    }
+    size_t face2 = 0;
+    const float separation2 = maxFaceSeparation(r2, r1, face2);
+    if (separation2 > 0.f) {
+        separating_axis = (1U << 16) | static_cast<uint32_t>(face2);
+        return {false};
+    }
+
+    // r1 stays the reference unless r2 is clearly better,
+    // keeps the features from flickering between nearly equal axes
+    static const float relative_tolerance = 0.98f;
+    static const float absolute_tolerance = 0.001f;
+    const bool isFlipped =
+            separation2 > relative_tolerance * separation1 + absolute_tolerance;
+    const auto& reference = (isFlipped ? r2 : r1);
+    const auto& incident = (isFlipped ? r1 : r2);
+    const size_t ref_face = (isFlipped ? face2 : face1);
+    const float overlap = -(isFlipped ? separation2 : separation1);
+    separating_axis = (isFlipped ? (1U << 16) : 0U) | static_cast<uint32_t>(ref_face);
+    if (overlap == 0.f) {
+        return {false};
+    }
+
+    // contact normal points from r2 towards r1
+    const vec2f ref_normal = reference.normals[ref_face];
+    IntersectionPolygonPolygonResult result{true, isFlipped ? ref_normal : -ref_normal, overlap};
+    result.point_count = clipContactManifold(reference, ref_face, incident, result.points);
+    if (result.point_count == 0) {
+        // deepest incident vertex, only happens with degenerate clipping
+        vec2f deepest = incident.vertices.front();
+        for (const auto& v : incident.vertices) {
+            if (dot(v, ref_normal) < dot(deepest, ref_normal)) {
+                deepest = v;
+            }
+        }
+        result.points[0] = {deepest + ref_normal * overlap, deepest, overlap, 0};
+        result.point_count = 1;
+    }
+    // points are generated as (reference, incident), swap them back into (r1, r2)
+    for (uint8_t i = 0; i < result.point_count; i++) {
+        auto& point = result.points[i];
+        if (isFlipped) {
+            std::swap(point.point1, point.point2);
+            point.feature_id |= (1U << 24);
+        }
+    }
+    const auto& deepest = (result.point_count == 2 &&
+                                           result.points[1].depth > result.points[0].depth
+                                   ? result.points[1]
+                                   : result.points[0]);
+    result.cp1 = deepest.point1;
+    result.cp2 = deepest.point2;
+    return result;
+}
+IntersectionPolygonPolygonResult intersectPolygonPolygon(
+        const std::vector<vec2f>& r1, const std::vector<vec2f>& r2
+) {
+    uint32_t separating_axis = 0;
+    return intersectPolygonPolygon(ConvexPiece(r1), ConvexPiece(r2), separating_axis);
 }
 IntersectionPolygonPolygonResult intersectPolygonPolygon(
         const ConvexPolygon& r1, const ConvexPolygon& r2
@@ -769,6 +1148,324 @@ IntersectionCircleCircleResult intersectCircleCircle(
     vec2f contact_point = dist / dist_len * c2.radius + c2.pos;
     return {true, dist / dist_len, contact_point, overlap};
 }
+// closest points between segments [p1, q1] and [p2, q2]
+static void closestPointsOnSegments(
+        vec2f p1, vec2f q1, vec2f p2, vec2f q2, vec2f& closest1, vec2f& closest2
+) {
+    static const float eps = 1e-8f;
+    const vec2f d1 = q1 - p1;
+    const vec2f d2 = q2 - p2;
+    const vec2f r = p1 - p2;
+    const float a = dot(d1, d1);
+    const float e = dot(d2, d2);
+    const float f = dot(d2, r);
+    float s = 0.f;
+    float t = 0.f;
+    if (a <= eps && e > eps) {
+        t = std::clamp(f / e, 0.f, 1.f);
+    } else if (a > eps) {
+        const float c = dot(d1, r);
+        if (e <= eps) {
+            s = std::clamp(-c / a, 0.f, 1.f);
+        } else {
+            const float b = dot(d1, d2);
+            const float denom = a * e - b * b;
+            s = denom != 0.f ? std::clamp((b * f - c * e) / denom, 0.f, 1.f) : 0.f;
+            t = (b * s + f) / e;
+            if (t < 0.f) {
+                t = 0.f;
+                s = std::clamp(-c / a, 0.f, 1.f);
+            } else if (t > 1.f) {
+                t = 1.f;
+                s = std::clamp((b - c) / a, 0.f, 1.f);
+            }
+        }
+    }
+    closest1 = p1 + d1 * s;
+    closest2 = p2 + d2 * t;
+}
+// fills overlap and deepest points, no points means no contact
+static ContactManifold& finishManifold(ContactManifold& manifold) {
+    if (manifold.point_count == 0) {
+        manifold.detected = false;
+        return manifold;
+    }
+    const auto& deepest = (manifold.point_count == 2 &&
+                                           manifold.points[1].depth > manifold.points[0].depth
+                                   ? manifold.points[1]
+                                   : manifold.points[0]);
+    manifold.overlap = deepest.depth;
+    manifold.cp1 = deepest.point1;
+    manifold.cp2 = deepest.point2;
+    return manifold;
+}
+ContactManifold flipped(ContactManifold manifold) {
+    manifold.contact_normal *= -1.f;
+    std::swap(manifold.cp1, manifold.cp2);
+    for (uint8_t i = 0; i < manifold.point_count; i++) {
+        std::swap(manifold.points[i].point1, manifold.points[i].point2);
+    }
+    return manifold;
+}
+ContactManifold collideCircleCircle(const Circle& c1, const Circle& c2) {
+    const vec2f dist = c1.pos - c2.pos;
+    const float dist_len = length(dist);
+    const float radii = c1.radius + c2.radius;
+    if (dist_len > radii) {
+        return {false};
+    }
+    const vec2f n = dist_len > 0.f ? dist / dist_len : vec2f(0.f, 1.f);
+    ContactManifold result{true, n};
+    result.points[0] = {c1.pos - n * c1.radius, c2.pos + n * c2.radius, radii - dist_len, 0};
+    result.point_count = 1;
+    return finishManifold(result);
+}
+ContactManifold collideCirclePolygon(const Circle& c, const ConvexPiece& piece) {
+    const auto& poly = piece.vertices;
+    size_t face = 0;
+    float separation = -INFINITY;
+    for (size_t i = 0; i < poly.size(); i++) {
+        float s = dot(piece.normals[i], c.pos - poly[i]);
+        if (s > separation) {
+            separation = s;
+            face = i;
+        }
+    }
+    if (separation > c.radius) {
+        return {false};
+    }
+    vec2f n = piece.normals[face];
+    vec2f on_poly = c.pos - n * separation;
+    // center outside, closest point can also be one of face's vertices
+    if (separation > 0.f) {
+        const vec2f a = poly[face];
+        const vec2f b = poly[(face + 1) % poly.size()];
+        on_poly = findClosestPointOnRay(a, b - a, c.pos);
+        const float dist = length(c.pos - on_poly);
+        if (dist > c.radius) {
+            return {false};
+        }
+        if (dist > 0.f) {
+            n = (c.pos - on_poly) / dist;
+        }
+    }
+    ContactManifold result{true, n};
+    result.points[0] = {
+            c.pos - n * c.radius,
+            on_poly,
+            c.radius - dot(c.pos - on_poly, n),
+            static_cast<uint32_t>(face)};
+    result.point_count = 1;
+    return finishManifold(result);
+}
+ContactManifold collideCapsuleCapsule(const Capsule& c1, const Capsule& c2) {
+    static const float eps = 1e-6f;
+    vec2f closest1, closest2;
+    closestPointsOnSegments(c1.a, c1.b, c2.a, c2.b, closest1, closest2);
+    const float radii = c1.radius + c2.radius;
+    const float dist = length(closest1 - closest2);
+    if (dist > radii) {
+        return {false};
+    }
+    const vec2f dir1 = c1.b - c1.a;
+    const vec2f dir2 = c2.b - c2.a;
+    const float len1 = length(dir1);
+    const float len2 = length(dir2);
+    vec2f n = {0.f, 1.f};
+    if (dist > eps) {
+        n = (closest1 - closest2) / dist;
+    } else if (len2 > eps || len1 > eps) {
+        // cores cross each other, separate along the normal of a segment
+        const vec2f dir = len2 > eps ? dir2 : dir1;
+        n = normal(vec2f(-dir.y, dir.x));
+        if (dot(n, (c1.a + c1.b) - (c2.a + c2.b)) < 0.f) {
+            n *= -1.f;
+        }
+    }
+    ContactManifold result{true, n};
+    auto addPoint = [&](vec2f on1, vec2f on2, uint32_t feature_id) {
+        const float depth = radii - dot(on1 - on2, n);
+        if (depth < 0.f) {
+            return;
+        }
+        result.points[result.point_count++] = {
+                on1 - n * c1.radius, on2 + n * c2.radius, depth, feature_id};
+    };
+    // capsules lying on each other need both ends of the overlap,
+    // a single point would let them rock
+    static const float parallel_tolerance = 0.05f;
+    const bool isParallel = len1 > eps && len2 > eps &&
+                            abs(perp_dot(dir1 / len1, dir2 / len2)) < parallel_tolerance;
+    if (isParallel && dist > eps) {
+        const vec2f tangent = dir2 / len2;
+        const float proj_a = dot(c1.a - c2.a, tangent);
+        const float proj_b = dot(c1.b - c2.a, tangent);
+        const float lo = std::max(0.f, std::min(proj_a, proj_b));
+        const float hi = std::min(len2, std::max(proj_a, proj_b));
+        if (hi - lo > eps) {
+            for (uint32_t i = 0; i < 2; i++) {
+                const vec2f on2 = c2.a + tangent * (i == 0 ? lo : hi);
+                addPoint(findClosestPointOnRay(c1.a, dir1, on2), on2, 1 + i);
+            }
+        }
+    }
+    if (result.point_count == 0) {
+        addPoint(closest1, closest2, 0);
+    }
+    return finishManifold(result);
+}
+ContactManifold collideCapsuleCircle(const Capsule& capsule, const Circle& c) {
+    return collideCapsuleCapsule(capsule, Capsule(c.pos, c.pos, c.radius));
+}
+ContactManifold collideCapsulePolygon(const Capsule& capsule, const ConvexPiece& piece) {
+    static const float eps = 1e-6f;
+    const float radius = capsule.radius;
+    const auto& poly = piece.vertices;
+
+    size_t face = 0;
+    float face_separation = -INFINITY;
+    for (size_t i = 0; i < poly.size(); i++) {
+        const vec2f n = piece.normals[i];
+        const float s = std::min(
+                dot(n, capsule.a - poly[i]), dot(n, capsule.b - poly[i])
+        );
+        if (s > face_separation) {
+            face_separation = s;
+            face = i;
+        }
+    }
+    const vec2f segment = capsule.b - capsule.a;
+    const float segment_len = length(segment);
+    float segment_separation = -INFINITY;
+    vec2f segment_axis;
+    if (segment_len > eps) {
+        const vec2f side = normal(vec2f(-segment.y, segment.x));
+        for (float sign : {1.f, -1.f}) {
+            float s = INFINITY;
+            for (const auto& v : poly) {
+                s = std::min(s, dot(side * sign, v - capsule.a));
+            }
+            if (s > segment_separation) {
+                segment_separation = s;
+                segment_axis = side * sign;
+            }
+        }
+    }
+    const float separation = std::max(face_separation, segment_separation);
+    if (separation > radius) {
+        return {false};
+    }
+
+    // with disjoint cores axes underestimate the distance next to round caps
+    if (separation > 0.f) {
+        vec2f on_capsule(0.f, 0.f);
+        vec2f on_poly(0.f, 0.f);
+        float dist = INFINITY;
+        for (size_t i = 0; i < poly.size(); i++) {
+            vec2f p, q;
+            closestPointsOnSegments(
+                    capsule.a, capsule.b, poly[i], poly[(i + 1) % poly.size()], p, q
+            );
+            if (length(p - q) < dist) {
+                dist = length(p - q);
+                on_capsule = p;
+                on_poly = q;
+            }
+        }
+        if (dist > radius) {
+            return {false};
+        }
+        static const float region_tolerance = 0.005f;
+        if (dist > separation + region_tolerance * radius) {
+            const vec2f n = (on_capsule - on_poly) / dist;
+            ContactManifold result{true, n};
+            result.points[0] = {on_capsule - n * radius, on_poly, radius - dist, 0};
+            result.point_count = 1;
+            return finishManifold(result);
+        }
+    }
+
+    ContactManifold result{true};
+    if (face_separation >= segment_separation) {
+        // polygon face is the reference, capsule's core is clipped against it
+        const vec2f n = piece.normals[face];
+        const vec2f a = poly[face];
+        const vec2f b = poly[(face + 1) % poly.size()];
+        const vec2f tangent = normal(b - a);
+        vec2f clipped[2] = {capsule.a, capsule.b};
+        uint32_t ids[2] = {0, 1};
+        result.contact_normal = n;
+        if (clipToSlab(clipped, ids, tangent, dot(tangent, a), dot(tangent, b))) {
+            for (int i = 0; i < 2; i++) {
+                const float s = dot(n, clipped[i] - a);
+                if (s > radius) {
+                    continue;
+                }
+                result.points[result.point_count++] = {
+                        clipped[i] - n * radius,
+                        clipped[i] - n * s,
+                        radius - s,
+                        (static_cast<uint32_t>(face) << 8) | ids[i]};
+            }
+        }
+    } else {
+        // side of the capsule is the reference, incident polygon edge is clipped
+        size_t incident = 0;
+        float most_opposite = INFINITY;
+        for (size_t i = 0; i < poly.size(); i++) {
+            float d = dot(piece.normals[i], segment_axis);
+            if (d < most_opposite) {
+                most_opposite = d;
+                incident = i;
+            }
+        }
+        const vec2f tangent = segment / segment_len;
+        vec2f clipped[2] = {poly[incident], poly[(incident + 1) % poly.size()]};
+        uint32_t ids[2] = {0, 1};
+        result.contact_normal = -segment_axis;
+        if (clipToSlab(clipped, ids, tangent, dot(tangent, capsule.a), dot(tangent, capsule.b))) {
+            for (int i = 0; i < 2; i++) {
+                const float s = dot(segment_axis, clipped[i] - capsule.a);
+                if (s > radius) {
+                    continue;
+                }
+                result.points[result.point_count++] = {
+                        clipped[i] - segment_axis * (s - radius),
+                        clipped[i],
+                        radius - s,
+                        (1U << 24) | (static_cast<uint32_t>(incident) << 8) | ids[i]};
+            }
+        }
+    }
+    return finishManifold(result);
+}
+MIAInfo calculateMassInertiaArea(
+        const Circle& circle, float thickness, float density
+) {
+    const float area = fEMP_PI * circle.radius * circle.radius;
+    const float mass = area * thickness * density;
+    return {mass * circle.radius * circle.radius / 2.f, mass, area, circle.pos};
+}
+MIAInfo calculateMassInertiaArea(
+        const Capsule& capsule, float thickness, float density
+) {
+    // box between the ends and two half discs moved out by half_len
+    const float half_len = length(capsule.b - capsule.a) / 2.f;
+    const float r = capsule.radius;
+    const float box_area = 4.f * half_len * r;
+    const float disc_area = fEMP_PI * r * r;
+    const float box_mass = box_area * thickness * density;
+    const float disc_mass = disc_area * thickness * density;
+    const float box_mmoi = box_mass * (4.f * half_len * half_len + 4.f * r * r) / 12.f;
+    const float disc_mmoi =
+            disc_mass * (r * r / 2.f + half_len * half_len +
+                         8.f * half_len * r / (3.f * fEMP_PI));
+    return {
+            box_mmoi + disc_mmoi,
+            box_mass + disc_mass,
+            box_area + disc_area,
+            (capsule.a + capsule.b) / 2.f};
+}
 float calculateInertia(const std::vector<vec2f>& model, float mass) {
     float area = 0;
     float mmoi = 0;
@@ -825,4 +1522,169 @@ MIAInfo calculateMassInertiaArea(
     }
     return {combinedMMOI, combinedMass, combinedArea, combinedCentroid};
 }
+// relative to the size of polygons, points closer to a line count as lying on it
+static constexpr float CLIP_EPSILON = 1e-4f;
+static float signedArea(const std::vector<vec2f>& poly) {
+    float result = 0.f;
+    for (size_t i = 0; i < poly.size(); i++) {
+        result += perp_dot(poly[i], poly[(i + 1) % poly.size()]);
+    }
+    return result / 2.f;
+}
+static float extentOf(const std::vector<vec2f>& poly) {
+    const auto aabb = AABB::CreateFromVerticies(poly);
+    return std::max(aabb.size().x, aabb.size().y);
+}
+void splitConvex(
+        const std::vector<vec2f>& polygon,
+        vec2f point,
+        vec2f plane_normal,
+        std::vector<vec2f>& front,
+        std::vector<vec2f>& back
+) {
+    front.clear();
+    back.clear();
+    const float tolerance = CLIP_EPSILON * extentOf(polygon);
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const vec2f a = polygon[i];
+        const vec2f b = polygon[(i + 1) % polygon.size()];
+        const float da = dot(a - point, plane_normal);
+        const float db = dot(b - point, plane_normal);
+        if (da >= -tolerance) {
+            front.push_back(a);
+        }
+        if (da <= tolerance) {
+            back.push_back(a);
+        }
+        if ((da > tolerance && db < -tolerance) || (da < -tolerance && db > tolerance)) {
+            const vec2f crossing = a + (b - a) * (da / (da - db));
+            front.push_back(crossing);
+            back.push_back(crossing);
+        }
+    }
+    // parts that only touch the line are degenerate
+    if (front.size() < 3 || fabsf(signedArea(front)) <= tolerance * tolerance) {
+        front.clear();
+    }
+    if (back.size() < 3 || fabsf(signedArea(back)) <= tolerance * tolerance) {
+        back.clear();
+    }
+}
+// the part of piece inside of every cutter edge shrinks with each split,
+// whatever is cut off in front of an edge lies outside of the cutter
+bool subtractConvex(
+        const std::vector<vec2f>& piece,
+        const std::vector<vec2f>& cutter,
+        std::vector<std::vector<vec2f>>& result
+) {
+    const size_t first = result.size();
+    const float orientation = windingOrientation(cutter);
+    std::vector<vec2f> remaining = piece;
+    std::vector<vec2f> front;
+    std::vector<vec2f> back;
+    for (size_t i = 0; i < cutter.size(); i++) {
+        splitConvex(remaining, cutter[i], edgeOutwardNormal(cutter, i, orientation), front, back);
+        if (back.empty()) {
+            result.resize(first);
+            return false;
+        }
+        if (!front.empty()) {
+            result.push_back(front);
+        }
+        remaining.swap(back);
+    }
+    return true;
+}
+std::vector<vec2f> convexHull(std::vector<vec2f> points, float orientation) {
+    std::sort(points.begin(), points.end(), [](vec2f a, vec2f b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    if (points.size() < 3) {
+        return points;
+    }
+    // monotone chain, lower and upper halves wind counter clockwise
+    std::vector<vec2f> hull(points.size() * 2);
+    size_t count = 0;
+    auto isLeftTurn = [&](vec2f p) {
+        return perp_dot(hull[count - 1] - hull[count - 2], p - hull[count - 2]) > 0.f;
+    };
+    for (size_t i = 0; i < points.size(); i++) {
+        while (count >= 2 && !isLeftTurn(points[i])) {
+            count--;
+        }
+        hull[count++] = points[i];
+    }
+    const size_t lower_count = count + 1;
+    for (size_t i = points.size() - 1; i > 0; i--) {
+        while (count >= lower_count && !isLeftTurn(points[i - 1])) {
+            count--;
+        }
+        hull[count++] = points[i - 1];
+    }
+    hull.resize(count - 1);
+    if (orientation < 0.f) {
+        std::reverse(hull.begin(), hull.end());
+    }
+    return hull;
+}
+bool areConvexNeighbours(const std::vector<vec2f>& p1, const std::vector<vec2f>& p2) {
+    const float tolerance = CLIP_EPSILON * std::max(extentOf(p1), extentOf(p2));
+    for (size_t i = 0; i < p1.size(); i++) {
+        const vec2f a = p1[i];
+        const vec2f edge = p1[(i + 1) % p1.size()] - a;
+        const float edge_length = length(edge);
+        if (edge_length <= tolerance) {
+            continue;
+        }
+        const vec2f dir = edge / edge_length;
+        for (size_t j = 0; j < p2.size(); j++) {
+            const vec2f c = p2[j];
+            const vec2f d = p2[(j + 1) % p2.size()];
+            if (fabsf(perp_dot(dir, c - a)) > tolerance || fabsf(perp_dot(dir, d - a)) > tolerance) {
+                continue;
+            }
+            // collinear edges have to overlap by more than a point
+            const float lo = std::max(0.f, std::min(dot(c - a, dir), dot(d - a, dir)));
+            const float hi = std::min(edge_length, std::max(dot(c - a, dir), dot(d - a, dir)));
+            if (hi - lo > tolerance) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+// union of two non overlapping convex polygons is convex exactly when
+// their hull adds no area
+void mergeConvexNeighbours(std::vector<std::vector<vec2f>>& polygons) {
+    std::vector<vec2f> both;
+    auto tryMerge = [&](size_t i, size_t j) {
+        if (!areConvexNeighbours(polygons[i], polygons[j])) {
+            return false;
+        }
+        both = polygons[i];
+        both.insert(both.end(), polygons[j].begin(), polygons[j].end());
+        auto hull = convexHull(both, windingOrientation(polygons[i]));
+        const float parts_area = fabsf(signedArea(polygons[i])) + fabsf(signedArea(polygons[j]));
+        if (fabsf(signedArea(hull)) - parts_area > CLIP_EPSILON * parts_area) {
+            return false;
+        }
+        polygons[i] = std::move(hull);
+        return true;
+    };
+    for (size_t i = 0; i < polygons.size(); i++) {
+        // pairs with earlier polygons were tried already, only a merged
+        // polygon can have new partners among them
+        for (size_t j = i + 1; j < polygons.size(); j++) {
+            if (j == i || !tryMerge(i, j)) {
+                continue;
+            }
+            polygons.erase(polygons.begin() + j);
+            if (j < i) {
+                i--;
+            }
+            // wraps around to try every other polygon against the merged one
+            j = SIZE_MAX;
+        }
+    }
+}
 } // namespace emp
@@ -1,5 +1,6 @@
 #ifndef EMP_GEOMETRY_FUNC_HPP
 #define EMP_GEOMETRY_FUNC_HPP
+#include <cstdint>
 #include <vector>
 #include "math/types.hpp"
 #include "math_defs.hpp"
@@ -14,6 +15,30 @@ std::vector<std::vector<vec2f>> triangulateAsVector(
 std::vector<std::vector<vec2f>> mergeToConvex(
         const std::vector<std::vector<vec2f>>& polygons
 );
+// splits convex polygon by the line through point, parts in front of the line
+// (along plane_normal) go to front, the rest to back, either can end up empty
+void splitConvex(
+        const std::vector<vec2f>& polygon,
+        vec2f point,
+        vec2f plane_normal,
+        std::vector<vec2f>& front,
+        std::vector<vec2f>& back
+);
+// appends convex parts of piece lying outside of convex cutter to result,
+// returns false and appends nothing when the two do not overlap
+bool subtractConvex(
+        const std::vector<vec2f>& piece,
+        const std::vector<vec2f>& cutter,
+        std::vector<std::vector<vec2f>>& result
+);
+// smallest convex polygon around points without collinear vertices,
+// wound the same way as polygons whose winding has the sign of orientation
+std::vector<vec2f> convexHull(std::vector<vec2f> points, float orientation);
+// true if convex polygons share a part of an edge, touching corners do not count
+bool areConvexNeighbours(const std::vector<vec2f>& p1, const std::vector<vec2f>& p2);
+// merges neighbouring convex polygons whose union is convex, unlike mergeToConvex
+// it needs no shared diagonals so it also works on pieces left by clipping
+void mergeConvexNeighbours(std::vector<std::vector<vec2f>>& polygons);
 
 float calcTriangleVolume(vec2f a, vec2f b, vec2f c);
 // returns true if r1 contains the whole of r2
@@ -59,6 +84,13 @@ MIAInfo calculateMassInertiaArea(
         float thickness = 1.f,
         float density = 1.f
 );
+// closed form, MMOI is around the centroid
+MIAInfo calculateMassInertiaArea(
+        const Circle& circle, float thickness = 1.f, float density = 1.f
+);
+MIAInfo calculateMassInertiaArea(
+        const Capsule& capsule, float thickness = 1.f, float density = 1.f
+);
 
 /**
  * structure containing all info returned by Ray and AABB intersection
@@ -124,6 +156,43 @@ struct IntersectionRayPolygonResult {
 IntersectionRayPolygonResult intersectRayPolygon(
         vec2f ray_origin, vec2f ray_dir, const ConvexPolygon& poly
 );
+// returns part of ray_dir travelled before the segment from ray_origin to
+// ray_origin + ray_dir enters aabb, 0 when it starts inside, INFINITY when it misses
+float segmentEntryTimeAABB(vec2f ray_origin, vec2f ray_dir, const AABB& r);
+/**
+ * structure containing all info returned by segment and shape intersection
+ *
+ * detected - true if segment from ray_origin to ray_origin + ray_dir hits the shape
+ * time_hit - part of ray_dir travelled before the hit, 0 when it starts inside
+ * contact_normal - outward normal of the shape at contact_point, opposite to
+ * ray_dir when segment starts inside
+ */
+struct IntersectionRayShapeResult {
+    bool detected = false;
+    float time_hit = INFINITY;
+    vec2f contact_normal;
+    vec2f contact_point;
+};
+IntersectionRayShapeResult intersectRayCircle(
+        vec2f ray_origin, vec2f ray_dir, const Circle& circle
+);
+IntersectionRayShapeResult intersectRayCapsule(
+        vec2f ray_origin, vec2f ray_dir, const Capsule& capsule
+);
+/**
+ * single point of a contact manifold
+ *
+ * point1, point2 - contact points lying on r1 and r2 respectively
+ * depth - penetration measured along the contact normal
+ * feature_id - identifies reference edge, incident edge and clipped vertex,
+ * stays the same between frames as long as the same features touch
+ */
+struct ContactManifoldPoint {
+    vec2f point1;
+    vec2f point2;
+    float depth;
+    uint32_t feature_id;
+};
 /**
  * structure containing all info returned by Polygon intersection
  *
@@ -131,6 +200,8 @@ IntersectionRayPolygonResult intersectRayPolygon(
  * larger than 1, aka it 'goes out of ray' this still returns true] contact
  * normal - normal of collision overlap - max distance by which 2 shapes are
  * overlapping
+ * cp1, cp2 - deepest contact point on r1 and r2
+ * points - up to 2 contact points clipped from reference and incident edges
  */
 struct IntersectionPolygonPolygonResult {
     bool detected;
@@ -138,15 +209,69 @@ struct IntersectionPolygonPolygonResult {
     float overlap;
     vec2f cp1;
     vec2f cp2;
+    ContactManifoldPoint points[2];
+    uint8_t point_count = 0;
 };
+/**
+ * convex polygon with precomputed outward unit normals,
+ * normals[i] belongs to edge [vertices[i], vertices[i + 1]]
+ */
+struct ConvexPiece {
+    std::vector<vec2f> vertices;
+    std::vector<vec2f> normals;
+    ConvexPiece() {}
+    explicit ConvexPiece(std::vector<vec2f> verts);
+};
+// clips segment against every face of piece
+IntersectionRayShapeResult intersectRayConvex(
+        vec2f ray_origin, vec2f ray_dir, const ConvexPiece& piece
+);
+/**
+ * segments laid out by lanes so that several of them are tested at once
+ *
+ * lane i starts at (origin_x[i], origin_y[i]) and is only tested up to
+ * max_time[i] of its direction, lanes with negative max_time never hit
+ */
+struct RayPacket {
+    static constexpr size_t WIDTH = 4;
+    alignas(16) float origin_x[WIDTH];
+    alignas(16) float origin_y[WIDTH];
+    alignas(16) float dir_x[WIDTH];
+    alignas(16) float dir_y[WIDTH];
+    alignas(16) float max_time[WIDTH];
+};
+// bit i of the result is set when lane i enters r before its max_time,
+// lanes agree with segmentEntryTimeAABB
+uint32_t segmentPacketEntryMaskAABB(const RayPacket& packet, const AABB& r);
+/**
+ * intersectRayConvex of every lane at once
+ * @param time_hit, contact_normal written only for lanes of the returned mask,
+ * which hit piece before their max_time
+ */
+uint32_t intersectRayPacketConvex(
+        const RayPacket& packet,
+        const ConvexPiece& piece,
+        float time_hit[RayPacket::WIDTH],
+        vec2f contact_normal[RayPacket::WIDTH]
+);
 /**
  * Calculates all information connected to Polygon and Polygon intersection
  * @return IntersectionPolygonPolygonResult that contains: (in order)
- * [bool]detected, [vec2f]contact_normal, [float]overlap
+ * [bool]detected, [vec2f]contact_normal, [float]overlap, deepest contact
+ * points and the clipped contact manifold
  */
 IntersectionPolygonPolygonResult intersectPolygonPolygon(
         const ConvexPolygon& r1, const ConvexPolygon& r2
 );
+/**
+ * SAT over precomputed normals
+ * @param separating_axis face tested first, overwritten with the face that
+ * separated the shapes or with the reference face of the contact,
+ * encoded as (owner << 16 | face) where owner is 0 for r1 and 1 for r2
+ */
+IntersectionPolygonPolygonResult intersectPolygonPolygon(
+        const ConvexPiece& r1, const ConvexPiece& r2, uint32_t& separating_axis
+);
 IntersectionPolygonPolygonResult intersectPolygonPolygon(
         const std::vector<vec2f>& r1, const std::vector<vec2f>& r2
 );
@@ -176,5 +301,19 @@ IntersectionCircleCircleResult intersectCircleCircle(
         const Circle& c1, const Circle& c2
 );
 
+/**
+ * narrow phase routines for round shapes, they produce the same manifold as
+ * intersectPolygonPolygon with contact normal pointing from the second shape
+ * towards the first one and point1/point2 lying on the first/second shape
+ */
+typedef IntersectionPolygonPolygonResult ContactManifold;
+ContactManifold collideCircleCircle(const Circle& c1, const Circle& c2);
+ContactManifold collideCirclePolygon(const Circle& c, const ConvexPiece& poly);
+ContactManifold collideCapsuleCapsule(const Capsule& c1, const Capsule& c2);
+ContactManifold collideCapsuleCircle(const Capsule& capsule, const Circle& c);
+ContactManifold collideCapsulePolygon(const Capsule& capsule, const ConvexPiece& poly);
+// swaps roles of both shapes, so that collideAB can serve as collideBA
+ContactManifold flipped(ContactManifold manifold);
+
 } // namespace emp
 #endif
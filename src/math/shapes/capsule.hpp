@@ -0,0 +1,16 @@
+#ifndef EMP_CAPSULE_HPP
+#define EMP_CAPSULE_HPP
+#include "math/math_defs.hpp"
+namespace emp {
+
+// all points within radius of segment [a, b]
+struct Capsule {
+
+    vec2f a;
+    vec2f b;
+    float radius;
+    Capsule(vec2f a_ = vec2f(0, 0), vec2f b_ = vec2f(0, 0), float r = 1.f)
+        : a(a_), b(b_), radius(r) {}
+};
+}
+#endif
@@ -10,6 +10,7 @@
 
 #include "math/math_func.hpp"
 #include "shapes/AABB.hpp"
+#include "shapes/capsule.hpp"
 #include "shapes/circle.hpp"
 #include "shapes/concave_polygon.hpp"
 #include "shapes/convex_polygon.hpp"
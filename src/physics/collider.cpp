@@ -1,10 +1,14 @@
 #include "collider.hpp"
+#include <algorithm>
+#include <mutex>
+#include <numeric>
 #include <random>
 #include <stdexcept>
 #include "core/coordinator.hpp"
 #include "debug/debug.hpp"
 #include "debug/log.hpp"
 #include "math/geometry_func.hpp"
+#include "physics/rigidbody.hpp"
 namespace emp {
 
 void CollisionInfo::flip() {
@@ -30,46 +34,74 @@ void ColliderSystem::notifyOfCollision(Entity a, Entity b, CollisionInfo col_inf
     FitIntoOne hasher;
     hasher.a = std::min(a, b);
     hasher.b = std::max(a, b);
-    m_collisions_occured_this_frame[hasher.hash] = col_info;
+    m_collisions_occured_this_frame.push_back({hasher.hash, col_info});
 }
 
 void ColliderSystem::processCollisionNotifications() {
     auto& this_frame = m_collisions_occured_this_frame;
     auto& last_frame = m_collisions_occured_last_frame;
 
-    std::unordered_set<uint64_t> new_events;
-    std::unordered_set<uint64_t> this_frame_collisions;
-    for(auto it = this_frame.begin(); it != this_frame.end(); it++) {
-        this_frame_collisions.insert(it->first);
-        if(last_frame.contains(it->first)) {
-            //deleting all collisions that are still happening
-            last_frame.erase(it->first);
-        }else {
-            //keeping track of new collisions
-            new_events.insert(it->first);
+    // the same pair can be notified in many substeps, latest info is kept
+    std::stable_sort(this_frame.begin(), this_frame.end(), [](const ContactRecord& a, const ContactRecord& b) {
+        return a.hash < b.hash;
+    });
+    size_t unique_count = 0;
+    for(size_t i = 0; i < this_frame.size(); i++) {
+        if(i + 1 < this_frame.size() && this_frame[i + 1].hash == this_frame[i].hash) {
+            continue;
         }
+        this_frame[unique_count++] = this_frame[i];
     }
-    //by deleting all collisions that are still happening we are left with collisions that just ended
-    auto& ended_events = last_frame;
-    for(auto& ended : ended_events) {
+    this_frame.resize(unique_count);
+
+    auto areBothSleeping = [&](uint64_t hash) {
         FitIntoOne dehasher;
-        dehasher.hash = ended;
+        dehasher.hash = hash;
         auto isAsleeping = ECS().isEntityAlive(dehasher.a) &&
             getComponent<Collider>(dehasher.a).isNonMoving;
         auto isBsleeping = ECS().isEntityAlive(dehasher.b) &&
             getComponent<Collider>(dehasher.b).isNonMoving;
-        if(isAsleeping && isBsleeping) {
-            this_frame_collisions.insert(dehasher.hash);
-            continue;
+        return isAsleeping && isBsleeping;
+    };
+    // both arrays are sorted so new, ongoing and ended collisions are found in one pass
+    m_collisions_next_frame.clear();
+    m_enter_events.clear();
+    m_exit_events.clear();
+    size_t last_idx = 0;
+    size_t this_idx = 0;
+    while(last_idx < last_frame.size() || this_idx < this_frame.size()) {
+        const bool isLastDone = last_idx == last_frame.size();
+        const bool isThisDone = this_idx == this_frame.size();
+        if(!isLastDone && !isThisDone && last_frame[last_idx] == this_frame[this_idx].hash) {
+            m_collisions_next_frame.push_back(last_frame[last_idx]);
+            last_idx++;
+            this_idx++;
+        }else if(isLastDone || (!isThisDone && this_frame[this_idx].hash < last_frame[last_idx])) {
+            m_enter_events.push_back(this_idx);
+            m_collisions_next_frame.push_back(this_frame[this_idx].hash);
+            this_idx++;
+        }else {
+            const auto ended = last_frame[last_idx++];
+            //collisions between sleeping bodies are still happening
+            if(areBothSleeping(ended)) {
+                m_collisions_next_frame.push_back(ended);
+            }else {
+                m_exit_events.push_back(ended);
+            }
         }
+    }
+    std::swap(last_frame, m_collisions_next_frame);
 
+    for(auto ended : m_exit_events) {
+        FitIntoOne dehasher;
+        dehasher.hash = ended;
         callAllOnExitCallbacksFor(dehasher.a, dehasher.b);
         callAllOnExitCallbacksFor(dehasher.b, dehasher.a);
     }
-    for(auto& event : new_events) {
+    for(auto event_idx : m_enter_events) {
         FitIntoOne dehasher;
-        dehasher.hash = event;
-        auto& info = m_collisions_occured_this_frame.at(event);
+        dehasher.hash = this_frame[event_idx].hash;
+        auto& info = this_frame[event_idx].info;
         assert(info.collider_entity == dehasher.a || info.collider_entity == dehasher.b);
         assert(info.collidee_entity == dehasher.a || info.collidee_entity == dehasher.b);
 
@@ -77,14 +109,12 @@ void ColliderSystem::processCollisionNotifications() {
         info.flip();
         callAllOnEnterCallbacksFor(info.collider_entity, info);
     }
-
-    m_collisions_occured_last_frame = this_frame_collisions;
-    m_collisions_occured_this_frame.clear();
+    this_frame.clear();
 }
 void ColliderSystem::callAllOnEnterCallbacksFor(Entity e, const CollisionInfo& info) {
     if(m_enter_callbacks.contains(e)) {
         auto& callbacks = m_enter_callbacks.at(e);
-        for(auto callback : callbacks) {
+        for(const auto& callback : callbacks) {
             callback(info);
         }
     }
@@ -92,7 +122,7 @@ void ColliderSystem::callAllOnEnterCallbacksFor(Entity e, const CollisionInfo& i
 void ColliderSystem::callAllOnExitCallbacksFor(Entity e, Entity other) {
     if(m_exit_callbacks.contains(e)) {
         auto& callbacks = m_exit_callbacks.at(e);
-        for(auto callback : callbacks) {
+        for(const auto& callback : callbacks) {
             callback(e, other);
         }
     }
@@ -109,6 +139,13 @@ bool ColliderSystem::canCollide(Layer layer1, Layer layer2) const {
     auto major= std::max(layer1, layer2);
     return collision_matrix[lesser].test(major) == true; 
 }
+LayerMask ColliderSystem::collisionMask(Layer layer) const {
+    LayerMask result;
+    for(Layer other = 0; other < MAX_LAYERS; other++) {
+        result.set(other, canCollide(layer, other));
+    }
+    return result;
+}
 void ColliderSystem::disableCollision(Layer layer1, Layer layer2) {
     auto lesser = std::min(layer1, layer2);
     auto major= std::max(layer1, layer2);
@@ -167,6 +204,7 @@ std::vector<vec2f> Collider::transformed_outline(const Transform& transform) con
     }
     return result;
 }
+// model pieces are sorted once when created, transforming keeps their order
 Collider::ConvexVertexCloud Collider::transformed_convex(const Transform& transform, size_t index) const {
     if (index >= model_shape().size()) {
         throw std::out_of_range("index out of model_shape range");
@@ -175,47 +213,231 @@ Collider::ConvexVertexCloud Collider::transformed_convex(const Transform& transf
     for (auto& p : result) {
         p = transformPoint(transform.global(), p);
     }
-    auto center = std::reduce(result.begin(), result.end()) /
-                  static_cast<float>(result.size());
-    std::sort(result.begin(), result.end(), [&](vec2f a, vec2f b) {
-        return atan2(a.y - center.y, a.x - center.x) >
-               atan2(b.y - center.y, b.x - center.x);
-    });
     return result;
 }
+void Collider::transformed_piece(const Transform& transform, size_t index, ConvexPiece& result) const {
+    const auto& mat = transform.global();
+    const auto& model = m_shape->model_shape[index];
+    const auto& model_normals = m_shape->model_normals[index];
+    result.vertices.resize(model.size());
+    for (size_t i = 0; i < model.size(); i++) {
+        result.vertices[i] = transformPoint(mat, model[i]);
+    }
+    result.normals.resize(model_normals.size());
+    if (model_normals.empty()) {
+        return;
+    }
+    // normals are transformed by inverse transpose of the linear part,
+    // sign of the determinant keeps them outward for mirrored transforms
+    const vec2f origin = transformPoint(mat, vec2f(0.f, 0.f));
+    const vec2f ex = transformPoint(mat, vec2f(1.f, 0.f)) - origin;
+    const vec2f ey = transformPoint(mat, vec2f(0.f, 1.f)) - origin;
+    const float sign = perp_dot(ex, ey) < 0.f ? -1.f : 1.f;
+    for (size_t i = 0; i < model_normals.size(); i++) {
+        const vec2f n = model_normals[i];
+        result.normals[i] = normal(vec2f(ey.y * n.x - ex.y * n.y, ex.x * n.y - ey.x * n.x)) * sign;
+    }
+}
 std::vector<Collider::ConvexVertexCloud> Collider::transformed_shape(const Transform& transform) const {
     std::vector<ConvexVertexCloud> result = model_shape();
     for(auto& poly : result) {
         for(auto& p: poly) {
             p = transformPoint(transform.global(), p);
         }
-         auto center = std::reduce(poly.begin(),
-                           poly.end()) /
-                       static_cast<float>(poly.size());
-         std::sort(poly.begin(),
-             poly.end(),
-             [&](vec2f a, vec2f b) {
-                 return atan2(a.y - center.y, a.x - center.x) >
-                        atan2(b.y - center.y, b.x - center.x);
-             });
     }
     return result;
 }
-Collider::Collider(std::vector<vec2f> shape, bool correctCOM) {
-    m_model_outline = shape;
-    auto MIA = calculateMassInertiaArea(m_model_outline);
-    if (correctCOM) {
-        for (auto& p : m_model_outline) {
-            p -= MIA.centroid;
+namespace {
+// arguments a shape was created from, round shapes store their dimensions
+struct ShapeKey {
+    eShapeType type;
+    bool correctCOM;
+    std::vector<vec2f> points;
+    bool operator==(const ShapeKey& other) const {
+        return type == other.type && correctCOM == other.correctCOM && points == other.points;
+    }
+};
+struct ShapeKeyHash {
+    size_t operator()(const ShapeKey& key) const {
+        size_t result = std::hash<int>()(static_cast<int>(key.type) * 2 + key.correctCOM);
+        for (auto p : key.points) {
+            for (auto coord : {p.x, p.y}) {
+                result ^= std::hash<float>()(coord) + 0x9e3779b9 + (result << 6) + (result >> 2);
+            }
+        }
+        return result;
+    }
+};
+struct ShapeTable {
+    std::mutex mutex;
+    std::unordered_map<ShapeKey, std::weak_ptr<const ColliderShape>, ShapeKeyHash> shapes;
+};
+// never destroyed so shapes released during static destruction can still unregister
+ShapeTable& shapeTable() {
+    static auto* table = new ShapeTable();
+    return *table;
+}
+template <class CreateFunc>
+ColliderShape::Handle internShape(ShapeKey key, CreateFunc&& create) {
+    auto& table = shapeTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto [entry, isInserted] = table.shapes.try_emplace(key);
+    if (!isInserted) {
+        if (auto shape = entry->second.lock()) {
+            return shape;
+        }
+    }
+    // last collider letting go of the shape removes its entry,
+    // unless the same shape was created again in the meantime
+    ColliderShape::Handle shape(new ColliderShape(create()), [key](const ColliderShape* released) {
+        auto& table = shapeTable();
+        {
+            std::lock_guard<std::mutex> lock(table.mutex);
+            auto entry = table.shapes.find(key);
+            if (entry != table.shapes.end() && entry->second.expired()) {
+                table.shapes.erase(entry);
+            }
         }
+        delete released;
+    });
+    entry->second = shape;
+    return shape;
+}
+// outline of round shapes is only an approximation used by
+// picking and drawing, collisions use the exact shape
+std::vector<vec2f> roundOutline(vec2f a, vec2f b, float radius) {
+    static const int half_circle_segments = 12;
+    std::vector<vec2f> result;
+    // arcs of a circle share their ends
+    const int last = (a == b ? half_circle_segments - 1 : half_circle_segments);
+    // same winding as polygon outlines, around b first then around a
+    for (int i = 0; i <= last; i++) {
+        float angle = fEMP_PI / 2.f - fEMP_PI * i / half_circle_segments;
+        result.push_back(b + vec2f(cosf(angle), sinf(angle)) * radius);
     }
-    m_extent = AABB::Expandable();
-    for (auto& p : m_model_outline) {
-        m_extent.expandToContain(p);
+    for (int i = 0; i <= last; i++) {
+        float angle = -fEMP_PI / 2.f - fEMP_PI * i / half_circle_segments;
+        result.push_back(a + vec2f(cosf(angle), sinf(angle)) * radius);
     }
+    return result;
+}
+}; // namespace
+ColliderShape::Handle ColliderShape::CreatePolygon(const std::vector<vec2f>& outline, bool correctCOM) {
+    return internShape(ShapeKey{eShapeType::Polygon, correctCOM, outline}, [&]() {
+        ColliderShape result;
+        result.model_outline = outline;
+        auto MIA = calculateMassInertiaArea(result.model_outline);
+        if (correctCOM) {
+            for (auto& p : result.model_outline) {
+                p -= MIA.centroid;
+            }
+        }
+        result.extent = AABB::Expandable();
+        for (auto& p : result.model_outline) {
+            result.extent.expandToContain(p);
+        }
 
-    auto triangles = triangulateAsVector(m_model_outline);
-    m_model_shape = mergeToConvex(triangles);
+        result.mass_properties = correctCOM ? calculateMassInertiaArea(result.model_outline) : MIA;
+        auto triangles = triangulateAsVector(result.model_outline);
+        result.model_shape = mergeToConvex(triangles);
+        for (auto& poly : result.model_shape) {
+            auto center = std::reduce(poly.begin(), poly.end()) /
+                          static_cast<float>(poly.size());
+            std::sort(poly.begin(), poly.end(), [&](vec2f a, vec2f b) {
+                return atan2(a.y - center.y, a.x - center.x) >
+                       atan2(b.y - center.y, b.x - center.x);
+            });
+            result.model_normals.push_back(ConvexPiece(poly).normals);
+        }
+        return result;
+    });
+}
+ColliderShape::Handle ColliderShape::CreateCircle(float radius) {
+    return internShape(ShapeKey{eShapeType::Circle, false, {vec2f(radius, 0.f)}}, [&]() {
+        ColliderShape result;
+        result.type = eShapeType::Circle;
+        result.radius = radius;
+        result.model_shape = {{vec2f(0.f, 0.f)}};
+        result.model_normals = {{}};
+        result.model_outline = roundOutline(vec2f(0.f, 0.f), vec2f(0.f, 0.f), radius);
+        result.extent = AABB::CreateMinMax(vec2f(-radius, -radius), vec2f(radius, radius));
+        result.mass_properties = calculateMassInertiaArea(Circle(vec2f(0.f, 0.f), radius));
+        return result;
+    });
+}
+ColliderShape::Handle ColliderShape::CreateCapsule(float half_length, float radius) {
+    return internShape(ShapeKey{eShapeType::Capsule, false, {vec2f(half_length, radius)}}, [&]() {
+        ColliderShape result;
+        const vec2f a = vec2f(-half_length, 0.f);
+        const vec2f b = vec2f(half_length, 0.f);
+        result.type = eShapeType::Capsule;
+        result.radius = radius;
+        result.model_shape = {{a, b}};
+        result.model_normals = {{}};
+        result.model_outline = roundOutline(a, b, radius);
+        result.extent = AABB::CreateMinMax(
+                vec2f(-half_length - radius, -radius), vec2f(half_length + radius, radius)
+        );
+        result.mass_properties = calculateMassInertiaArea(Capsule(a, b, radius));
+        return result;
+    });
+}
+ColliderShape::Handle ColliderShape::CreateFromPieces(std::vector<ConvexVertexCloud> pieces) {
+    auto result = std::make_shared<ColliderShape>();
+    result->extent = AABB::Expandable();
+    float mass = 0.f;
+    vec2f centroid(0.f, 0.f);
+    std::vector<MIAInfo> piece_properties;
+    piece_properties.reserve(pieces.size());
+    for (const auto& piece : pieces) {
+        for (auto p : piece) {
+            result->extent.expandToContain(p);
+        }
+        piece_properties.push_back(calculateMassInertiaArea(piece));
+        mass += piece_properties.back().mass;
+        centroid += piece_properties.back().centroid * piece_properties.back().mass;
+        result->model_normals.push_back(ConvexPiece(piece).normals);
+    }
+    // pieces are combined the same way as triangles of an outline
+    auto& properties = result->mass_properties;
+    properties = MIAInfo{0.f, mass, 0.f, mass > 0.f ? centroid / mass : centroid};
+    for (const auto& piece : piece_properties) {
+        properties.area += piece.area;
+        properties.MMOI += piece.MMOI + piece.mass * qlen(piece.centroid - properties.centroid);
+    }
+    result->model_shape = std::move(pieces);
+    return result;
+}
+const ColliderShape::Handle& ColliderShape::Empty() {
+    static const Handle empty = std::make_shared<const ColliderShape>();
+    return empty;
+}
+size_t ColliderShape::countInterned() {
+    auto& table = shapeTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return table.shapes.size();
+}
+Collider::Collider(const std::vector<vec2f>& shape, bool correctCOM)
+    : m_shape(ColliderShape::CreatePolygon(shape, correctCOM)) {
+}
+Collider Collider::CreateCircle(float radius) {
+    return Collider(ColliderShape::CreateCircle(radius));
+}
+Collider Collider::CreateCapsule(float half_length, float radius) {
+    return Collider(ColliderShape::CreateCapsule(half_length, radius));
+}
+float Collider::transformed_radius(const Transform& transform) const {
+    const auto& mat = transform.global();
+    return m_shape->radius * length(
+            transformPoint(mat, vec2f(1.f, 0.f)) - transformPoint(mat, vec2f(0.f, 0.f))
+    );
+}
+void ColliderSystem::onEntityAdded(Entity entity) {
+    // mass of rigidbody added before its collider has to be recalculated
+    auto rigidbody = ECS().getComponent<Rigidbody>(entity);
+    if (rigidbody != nullptr) {
+        rigidbody->invalidateMass();
+    }
 }
 void ColliderSystem::onEntityRemoved(Entity entity) {
     m_exit_callbacks.erase(entity);
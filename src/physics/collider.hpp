@@ -1,9 +1,11 @@
 #ifndef EMP_COLLIDER_HPP
 #define EMP_COLLIDER_HPP
-#include <unordered_set>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include "core/layer.hpp"
 #include "core/system.hpp"
+#include "math/geometry_func.hpp"
 #include "math/math_defs.hpp"
 #include "math/shapes/AABB.hpp"
 #include "scene/transform.hpp"
@@ -22,34 +24,98 @@ struct CollisionInfo {
     vec2f collidee_radius;
     void flip();
 };
-struct Collider {
+// round shapes are kept as a core with radius instead of being
+// approximated with polygons
+enum class eShapeType : uint8_t {
+    Polygon = 0,
+    Circle,
+    Capsule,
+};
+static constexpr size_t SHAPE_TYPE_COUNT = 3;
+// immutable shape data, colliders created with the same arguments share one
+// instance that lives for as long as any of them refers to it
+struct ColliderShape {
     typedef std::vector<vec2f> ConvexVertexCloud;
+    typedef std::shared_ptr<const ColliderShape> Handle;
+
+    eShapeType type = eShapeType::Polygon;
+    // of round shapes, 0 for polygons
+    float radius = 0.f;
+    // potentially concave
+    AABB extent;
+    std::vector<vec2f> model_outline;
+    std::vector<ConvexVertexCloud> model_shape;
+    // outward normals of model_shape pieces, empty for round shapes
+    std::vector<std::vector<vec2f>> model_normals;
+    // of model outline with density 1
+    MIAInfo mass_properties{};
+
+    // decomposition only runs the first time an outline is seen
+    static Handle CreatePolygon(const std::vector<vec2f>& outline, bool correctCOM);
+    static Handle CreateCircle(float radius);
+    static Handle CreateCapsule(float half_length, float radius);
+    // convex polygon pieces taken as they are, shapes left by carving are
+    // unique so they are not interned and have no outline
+    static Handle CreateFromPieces(std::vector<ConvexVertexCloud> pieces);
+    // shape without pieces held by default constructed colliders
+    static const Handle& Empty();
+    // number of distinct shapes currently alive
+    static size_t countInterned();
+};
+struct Collider {
+    typedef ColliderShape::ConvexVertexCloud ConvexVertexCloud;
     typedef std::function<void(const CollisionInfo&)>  CallbackFunc;
 private:
-    // potentially concave
-    AABB m_extent;
-    std::vector<vec2f> m_model_outline;
-    std::vector<ConvexVertexCloud> m_model_shape;
+    ColliderShape::Handle m_shape = ColliderShape::Empty();
 public:
     Layer collider_layer = 0;
     bool isNonMoving = true;
 
+    inline const ColliderShape::Handle& shape() const {
+        return m_shape;
+    }
+    // mass of the rigidbody has to be invalidated afterwards
+    inline void setShape(ColliderShape::Handle shape) {
+        m_shape = std::move(shape);
+    }
     inline const std::vector<vec2f>& model_outline() const {
-        return m_model_outline;
+        return m_shape->model_outline;
     }
     inline const std::vector<ConvexVertexCloud>& model_shape() const {
-        return m_model_shape;
+        return m_shape->model_shape;
+    }
+    inline const MIAInfo& mass_properties() const {
+        return m_shape->mass_properties;
+    }
+    inline eShapeType type() const {
+        return m_shape->type;
     }
+    inline bool isRound() const {
+        return m_shape->type != eShapeType::Polygon;
+    }
+    inline float radius() const {
+        return m_shape->radius;
+    }
+    // radius scaled by transform, only uniform scale is supported
+    float transformed_radius(const Transform& transform) const;
 
     std::vector<vec2f> transformed_outline(const Transform& transform) const;
     std::vector<ConvexVertexCloud> transformed_shape(const Transform& transform) const;
     ConvexVertexCloud transformed_convex(const Transform& transform, size_t index) const;
+    // transforms piece with its normals, reuses memory of result
+    void transformed_piece(const Transform& transform, size_t index, ConvexPiece& result) const;
 
     inline AABB extent() const {
-        return m_extent;
+        return m_shape->extent;
     }
     Collider() { }
-    Collider(std::vector<vec2f> shape, bool correctCOM = false);
+    Collider(ColliderShape::Handle shape) : m_shape(std::move(shape)) { }
+    Collider(const std::vector<vec2f>& shape, bool correctCOM = false);
+    // model_shape() holds a single piece with the center
+    static Collider CreateCircle(float radius);
+    // model_shape() holds a single piece with both ends of the core segment,
+    // that lies along x axis
+    static Collider CreateCapsule(float half_length, float radius);
     friend ColliderSystem;
 };
 
@@ -69,8 +135,16 @@ private:
         };
         uint64_t hash;
     };
-    std::unordered_set<uint64_t> m_collisions_occured_last_frame;
-    std::unordered_map<uint64_t, CollisionInfo> m_collisions_occured_this_frame;
+    struct ContactRecord {
+        uint64_t hash;
+        CollisionInfo info;
+    };
+    // flat arrays reused between frames, last frame is kept sorted by hash
+    std::vector<uint64_t> m_collisions_occured_last_frame;
+    std::vector<ContactRecord> m_collisions_occured_this_frame;
+    std::vector<uint64_t> m_collisions_next_frame;
+    std::vector<size_t> m_enter_events;
+    std::vector<uint64_t> m_exit_events;
     std::unordered_map<Entity, std::vector<CollisionEnterCallback>> m_enter_callbacks;
     std::unordered_map<Entity, std::vector<CollisionExitCallback>> m_exit_callbacks;
 
@@ -91,6 +165,9 @@ public:
     void disableCollision(Layer layer1, Layer layer2);
     void eableCollision(Layer layer1, Layer layer2);
     bool canCollide(Layer layer1, Layer layer2) const;
+    // all layers that can collide with layer
+    LayerMask collisionMask(Layer layer) const;
+    void onEntityAdded(Entity entity) override final;
     void onEntityRemoved(Entity entity) override final;
     ColliderSystem();
 };
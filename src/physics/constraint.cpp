@@ -2,7 +2,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <random>
+#include <numeric>
 #include <glm/ext/quaternion_common.hpp>
 #include "core/coordinator.hpp"
 #include "debug/log.hpp"
@@ -222,18 +222,11 @@ Constraint Builder::build() {
     }
     return result;
 }
-void Constraint::m_solvePointSwivel(float delta_time, Coordinator& ECS) {
-    Entity entity1 = entity_list[0];
-    Entity entity2 = entity_list[1];
-    assert(ECS.hasComponent<Transform>(entity1));
-    assert(ECS.hasComponent<Rigidbody>(entity1));
-    assert(ECS.hasComponent<Transform>(entity2));
-    assert(ECS.hasComponent<Rigidbody>(entity2));
-
-    auto& transform1 = *ECS.getComponent<Transform>(entity1);
-    const auto& rigidbody1 = *ECS.getComponent<Rigidbody>(entity1);
-    auto& transform2 = *ECS.getComponent<Transform>(entity2);
-    const auto& rigidbody2 = *ECS.getComponent<Rigidbody>(entity2);
+void SolverConstraint::m_solvePointSwivel(float delta_time) {
+    auto& transform1 = *transforms[0];
+    const auto& rigidbody1 = *rigidbodies[0];
+    auto& transform2 = *transforms[1];
+    const auto& rigidbody2 = *rigidbodies[1];
 
     const vec2f& pos1 = transform1.position;
     const vec2f& pos2 = transform2.position;
@@ -251,10 +244,10 @@ void Constraint::m_solvePointSwivel(float delta_time, Coordinator& ECS) {
     auto correction = calcPositionalCorrection(
             PositionalCorrectionInfo(
                     norm,
-                    entity1,
+                    bodies[0],
                     dynamic_pinch1,
                     &rigidbody1,
-                    entity2,
+                    bodies[1],
                     dynamic_pinch2,
                     &rigidbody2
             ),
@@ -263,20 +256,20 @@ void Constraint::m_solvePointSwivel(float delta_time, Coordinator& ECS) {
             delta_time,
             compliance
     );
-    transform1.position += correction.pos1_correction;
-    transform1.rotation += correction.rot1_correction;
-    transform2.position += correction.pos2_correction;
-    transform2.rotation += correction.rot2_correction;
+    // static bodies can be read by other islands at the same time
+    if (!rigidbody1.isStatic) {
+        transform1.position += correction.pos1_correction;
+        transform1.rotation += correction.rot1_correction;
+    }
+    if (!rigidbody2.isStatic) {
+        transform2.position += correction.pos2_correction;
+        transform2.rotation += correction.rot2_correction;
+    }
 }
-void Constraint::m_solvePointFixedAnchor(float delta_time, Coordinator& ECS) {
-    Entity anchor_entity = entity_list[0];
-    Entity dynamic_entity = entity_list[1];
-    assert(ECS.hasComponent<Transform>(anchor_entity));
-    assert(ECS.hasComponent<Transform>(dynamic_entity));
-    assert(ECS.hasComponent<Rigidbody>(dynamic_entity));
-    const auto& anchor_trans = *ECS.getComponent<Transform>(anchor_entity);
-    auto& dynamic_trans = *ECS.getComponent<Transform>(dynamic_entity);
-    auto& rigidbody = *ECS.getComponent<Rigidbody>(dynamic_entity);
+void SolverConstraint::m_solvePointFixedAnchor(float delta_time) {
+    const auto& anchor_trans = *transforms[0];
+    auto& dynamic_trans = *transforms[1];
+    auto& rigidbody = *rigidbodies[1];
     const vec2f& pos1 = anchor_trans.position;
     const vec2f& pos2 = dynamic_trans.position;
 
@@ -313,17 +306,11 @@ void Constraint::m_solvePointFixedAnchor(float delta_time, Coordinator& ECS) {
         dynamic_trans.rotation += rot_correction;
     }
 }
-void Constraint::m_solvePointFixed(float delta_time, Coordinator& ECS) {
-    Entity entity1 = entity_list[0];
-    Entity entity2 = entity_list[1];
-    assert(ECS.hasComponent<Transform>(entity1));
-    assert(ECS.hasComponent<Rigidbody>(entity1));
-    assert(ECS.hasComponent<Transform>(entity2));
-    assert(ECS.hasComponent<Rigidbody>(entity2));
-    auto& trans1 = *ECS.getComponent<Transform>(entity1);
-    auto& trans2 = *ECS.getComponent<Transform>(entity2);
-    auto& rigidbody1 = *ECS.getComponent<Rigidbody>(entity1);
-    auto& rigidbody2 = *ECS.getComponent<Rigidbody>(entity2);
+void SolverConstraint::m_solvePointFixed(float delta_time) {
+    auto& trans1 = *transforms[0];
+    auto& trans2 = *transforms[1];
+    auto& rigidbody1 = *rigidbodies[0];
+    auto& rigidbody2 = *rigidbodies[1];
     const vec2f& pos1 = trans1.position;
     const vec2f& pos2 = trans2.position;
 
@@ -346,11 +333,11 @@ void Constraint::m_solvePointFixed(float delta_time, Coordinator& ECS) {
         auto correction = calcPositionalCorrection(
             PositionalCorrectionInfo(
                 norm,
-                entity1,
+                bodies[0],
                 ( pos2 - pos1 ) * 0.5f,
                 &rigidbody1,
 
-                entity2,
+                bodies[1],
                 ( pos1 - pos2 ) * 0.5f,
                 &rigidbody2
             ),
@@ -376,21 +363,19 @@ void Constraint::m_solvePointFixed(float delta_time, Coordinator& ECS) {
         }
     }
 
-    trans1.position += pos_corr1;
-    trans2.position += pos_corr2;
-    trans1.rotation += rot_corr1;
-    trans2.rotation += rot_corr2;
+    if (!rigidbody1.isStatic) {
+        trans1.position += pos_corr1;
+        trans1.rotation += rot_corr1;
+    }
+    if (!rigidbody2.isStatic) {
+        trans2.position += pos_corr2;
+        trans2.rotation += rot_corr2;
+    }
 }
-void Constraint::m_solvePointSwivelAnchor(float delta_time, Coordinator& ECS) {
-    Entity anchor_entity = entity_list[0];
-    Entity dynamic_entity = entity_list[1];
-    assert(ECS.hasComponent<Transform>(anchor_entity));
-    assert(ECS.hasComponent<Transform>(dynamic_entity));
-    assert(ECS.hasComponent<Rigidbody>(dynamic_entity));
-
-    const auto& anchor_trans = *ECS.getComponent<Transform>(anchor_entity);
-    auto& dynamic_trans = *ECS.getComponent<Transform>(dynamic_entity);
-    auto& rigidbody = *ECS.getComponent<Rigidbody>(dynamic_entity);
+void SolverConstraint::m_solvePointSwivelAnchor(float delta_time) {
+    const auto& anchor_trans = *transforms[0];
+    auto& dynamic_trans = *transforms[1];
+    auto& rigidbody = *rigidbodies[1];
 
     const vec2f& pos1 = anchor_trans.position;
     const vec2f& pos2 = dynamic_trans.position;
@@ -406,11 +391,11 @@ void Constraint::m_solvePointSwivelAnchor(float delta_time, Coordinator& ECS) {
     auto correction = calcPositionalCorrection(
         PositionalCorrectionInfo(
             norm,
-            dynamic_entity,
+            bodies[1],
             dynamic_pinch,
             &rigidbody,
 
-            anchor_entity,
+            bodies[0],
             vec2f(0),
             nullptr
         ),
@@ -422,39 +407,77 @@ void Constraint::m_solvePointSwivelAnchor(float delta_time, Coordinator& ECS) {
     dynamic_trans.position += correction.pos1_correction;
     dynamic_trans.rotation += correction.rot1_correction;
 }
-void Constraint::solve(float delta_time, Coordinator& ECS) {
+void SolverConstraint::solve(float delta_time) {
     switch (type) {
     case emp::eConstraintType::SwivelPointAnchored:
-        m_solvePointSwivelAnchor(delta_time, ECS);
+        m_solvePointSwivelAnchor(delta_time);
         break;
     case emp::eConstraintType::SwivelPoint:
-        m_solvePointSwivel(delta_time, ECS);
+        m_solvePointSwivel(delta_time);
         break;
     case emp::eConstraintType::FixedLock:
-        m_solvePointFixed(delta_time, ECS);
+        m_solvePointFixed(delta_time);
         break;
     case emp::eConstraintType::FixedLockAnchored:
-        m_solvePointFixedAnchor(delta_time, ECS);
+        m_solvePointFixedAnchor(delta_time);
         break;
     case emp::eConstraintType::Undefined:
         assert(false);
         break;
     }
 }
-std::vector< ConstraintSystem::EntityListRef_t> ConstraintSystem::getConstrainedGroups() const {
-    std::vector< ConstraintSystem::EntityListRef_t> result;
-    for(auto entity : entities) {
-        auto& entity_list = getComponent<Constraint>(entity).entity_list;
-        result.push_back(&entity_list);
+void ConstraintSystem::onEntityAdded(Entity) {
+    m_isLayoutDirty = true;
+}
+void ConstraintSystem::onEntityRemoved(Entity) {
+    m_isLayoutDirty = true;
+}
+void ConstraintSystem::gatherConstraints() {
+    if (m_isLayoutDirty) {
+        m_isLayoutDirty = false;
+        m_solver_constraints.clear();
+        for (auto entity : entities) {
+            const auto& constraint = getComponent<Constraint>(entity);
+            if (constraint.entity_list.size() < 2) {
+                continue;
+            }
+            SolverConstraint packed;
+            packed.constraint_entity = entity;
+            packed.type = constraint.type;
+            packed.bodies = {constraint.entity_list[0], constraint.entity_list[1]};
+            m_solver_constraints.push_back(packed);
+        }
+        std::stable_sort(
+                m_solver_constraints.begin(), m_solver_constraints.end(),
+                [](const SolverConstraint& a, const SolverConstraint& b) {
+                    return a.type < b.type;
+                }
+        );
+        m_all_slots.resize(m_solver_constraints.size());
+        std::iota(m_all_slots.begin(), m_all_slots.end(), 0U);
+    }
+    auto& coordinator = ECS();
+    for (auto& packed : m_solver_constraints) {
+        const auto& constraint = getComponent<Constraint>(packed.constraint_entity);
+        packed.type = constraint.type;
+        packed.compliance = constraint.compliance;
+        packed.data = constraint.data;
+        for (size_t i = 0; i < packed.bodies.size(); i++) {
+            packed.transforms[i] = coordinator.getComponent<Transform>(packed.bodies[i]);
+            const bool isAnchor = i == 0 && packed.isAnchored();
+            packed.rigidbodies[i] = isAnchor ? nullptr : coordinator.getComponent<Rigidbody>(packed.bodies[i]);
+            assert(packed.transforms[i] != nullptr);
+            assert(isAnchor || packed.rigidbodies[i] != nullptr);
+        }
     }
-    return result;
 }
-void ConstraintSystem::update(float delta_time) {
-    std::vector<Entity> v(entities.begin(), entities.end());
-    std::shuffle(v.begin(), v.end(), std::mt19937{std::random_device{}()});
-    for (auto e : v) {
-        getComponent<Constraint>(e).solve(delta_time, ECS());
+void ConstraintSystem::solve(std::span<const uint32_t> slots, float delta_time) {
+    for (auto slot : slots) {
+        m_solver_constraints[slot].solve(delta_time);
     }
 }
+void ConstraintSystem::update(float delta_time) {
+    gatherConstraints();
+    solve(m_all_slots, delta_time);
+}
 }; // namespace emp
-
@@ -1,8 +1,10 @@
 #ifndef EMP_CONSTRAINT_HPP
 #define EMP_CONSTRAINT_HPP
+#include <array>
 #include <cmath>
 #include <functional>
 #include <set>
+#include <span>
 #include <vector>
 #include "core/coordinator.hpp"
 #include "core/entity.hpp"
@@ -115,19 +117,51 @@ struct Constraint {
 
         Constraint build();
     };
+};
+// constraint packed for the solver, the first two entities of its list
+// become its bodies, components of bodies are resolved once per tick
+struct SolverConstraint {
+    Entity constraint_entity;
+    eConstraintType type;
+    float compliance;
+    decltype(Constraint::data) data;
+    std::array<Entity, 2> bodies;
+    std::array<Transform*, 2> transforms;
+    // nullptr for anchors, they are never moved
+    std::array<Rigidbody*, 2> rigidbodies;
 
-    void solve(float delta_time, Coordinator& ECS);
+    bool isAnchored() const {
+        return type == eConstraintType::SwivelPointAnchored ||
+               type == eConstraintType::FixedLockAnchored;
+    }
+    void solve(float delta_time);
 
 private:
-    void m_solvePointSwivelAnchor(float delta_time, Coordinator& ECS);
-    void m_solvePointSwivel(float delta_time, Coordinator& ECS);
-    void m_solvePointFixedAnchor(float delta_time, Coordinator& ECS);
-    void m_solvePointFixed(float delta_time, Coordinator& ECS);
+    void m_solvePointSwivelAnchor(float delta_time);
+    void m_solvePointSwivel(float delta_time);
+    void m_solvePointFixedAnchor(float delta_time);
+    void m_solvePointFixed(float delta_time);
 };
 struct ConstraintSystem : public System<Constraint> {
-    typedef const std::vector<Entity>* EntityListRef_t;
-    std::vector< EntityListRef_t> getConstrainedGroups() const;
+    // recompiles the solver array when constraints were added or removed,
+    // otherwise only refreshes data and bodies of every slot, pointers are
+    // invalidated when any entity is destroyed so it has to be called every tick
+    void gatherConstraints();
+    // valid after gatherConstraints, constraints of one type are adjacent
+    std::span<const SolverConstraint> solverConstraints() const {
+        return m_solver_constraints;
+    }
+    // solves only given solver slots in the order they are listed, so that
+    // the same scene always gives the same result
+    void solve(std::span<const uint32_t> slots, float delta_time);
     void update(float delta_time);
+    void onEntityAdded(Entity entity) override final;
+    void onEntityRemoved(Entity entity) override final;
+
+private:
+    std::vector<SolverConstraint> m_solver_constraints;
+    std::vector<uint32_t> m_all_slots;
+    bool m_isLayoutDirty = true;
 };
 }; // namespace emp
 #endif
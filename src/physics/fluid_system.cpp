@@ -0,0 +1,471 @@
+#include "fluid_system.hpp"
+#include <algorithm>
+#include <cmath>
+#include "core/coordinator.hpp"
+#include "physics/physics_system.hpp"
+#include "physics/tilemap_collider.hpp"
+namespace emp {
+FluidSystem::FluidSystem(ThreadPool& thread_pool) : m_thread_pool(thread_pool) {}
+void FluidParticles::resize(size_t size) {
+    for (auto* field : {&pos_x, &pos_y, &vel_x, &vel_y, &pred_x, &pred_y}) {
+        field->resize(size);
+    }
+}
+void FluidSystem::addParticle(vec2f position, vec2f velocity) {
+    m_particles.pos_x.push_back(position.x);
+    m_particles.pos_y.push_back(position.y);
+    m_particles.vel_x.push_back(velocity.x);
+    m_particles.vel_y.push_back(velocity.y);
+    m_particles.pred_x.push_back(position.x);
+    m_particles.pred_y.push_back(position.y);
+}
+void FluidSystem::addBlock(const AABB& area, vec2f velocity) {
+    const float spacing = 2.f * particle_radius;
+    for (float y = area.min.y + particle_radius; y <= area.max.y - particle_radius; y += spacing) {
+        for (float x = area.min.x + particle_radius; x <= area.max.x - particle_radius; x += spacing) {
+            addParticle(vec2f(x, y), velocity);
+        }
+    }
+}
+void FluidSystem::clear() {
+    m_particles.resize(0);
+}
+template <class Task>
+void FluidSystem::m_parallelFor(size_t count, Task&& task) {
+    // small passes are not worth waking the workers for
+    static constexpr size_t MIN_PARALLEL_COUNT = 2048U;
+    if (!useParallelSolver || m_thread_pool.threadCount() == 0 || count < MIN_PARALLEL_COUNT) {
+        task(0U, static_cast<uint32_t>(count));
+        return;
+    }
+    m_thread_pool.dispatch(static_cast<uint32_t>(count), task);
+    m_thread_pool.waitForCompletion();
+}
+template <class Visitor>
+void FluidSystem::m_forEachParticleIn(const AABB& area, Visitor&& visit) const {
+    const float h = m_kernel.radius;
+    const int min_x = std::max(m_min_cell_x, static_cast<int>(std::max(floorf(area.min.x / h), -1e9f)));
+    const int min_y = std::max(m_min_cell_y, static_cast<int>(std::max(floorf(area.min.y / h), -1e9f)));
+    const int max_x = std::min(m_max_cell_x, static_cast<int>(std::min(floorf(area.max.x / h), 1e9f)));
+    const int max_y = std::min(m_max_cell_y, static_cast<int>(std::min(floorf(area.max.y / h), 1e9f)));
+    if (min_x > max_x || min_y > max_y) {
+        return;
+    }
+    // spread out fluid is hashed and its bounds are mostly empty cells,
+    // walking them would cost the area of the query instead of the particle count
+    const int64_t cell_count = static_cast<int64_t>(max_x - min_x + 1) * (max_y - min_y + 1);
+    if (cell_count > static_cast<int64_t>(m_cell_x.size())) {
+        for (uint32_t i = 0; i < m_cell_x.size(); i++) {
+            if (m_cell_x[i] >= min_x && m_cell_x[i] <= max_x && m_cell_y[i] >= min_y && m_cell_y[i] <= max_y) {
+                visit(i);
+            }
+        }
+        return;
+    }
+    for (int cy = min_y; cy <= max_y; cy++) {
+        for (int cx = min_x; cx <= max_x; cx++) {
+            const uint32_t bucket = m_bucketOf(cx, cy);
+            for (uint32_t i = m_cell_start[bucket]; i < m_cell_start[bucket + 1]; i++) {
+                // other cells can share the bucket
+                if (m_cell_x[i] == cx && m_cell_y[i] == cy) {
+                    visit(i);
+                }
+            }
+        }
+    }
+}
+void FluidSystem::m_updateKernel() {
+    const float spacing = 2.f * particle_radius;
+    const float h = KERNEL_SCALE * spacing;
+    m_kernel.radius = h;
+    m_kernel.sq_radius = h * h;
+    m_kernel.poly6_coef = 4.f / (EMP_PI * powf(h, 8.f));
+    m_kernel.spiky_coef = 30.f / (EMP_PI * powf(h, 5.f));
+    m_particle_mass = density * spacing * spacing;
+    // density of particles resting on the lattice addBlock uses
+    const int reach = static_cast<int>(ceilf(KERNEL_SCALE));
+    m_rest_density = 0.f;
+    for (int y = -reach; y <= reach; y++) {
+        for (int x = -reach; x <= reach; x++) {
+            m_rest_density += m_kernel.poly6(static_cast<float>(x * x + y * y) * spacing * spacing);
+        }
+    }
+    m_tensile_reference = m_kernel.poly6(0.04f * h * h);
+}
+uint32_t FluidSystem::m_bucketOf(int cell_x, int cell_y) const {
+    if (m_isGridDense) {
+        if (cell_x < m_min_cell_x || cell_y < m_min_cell_y || cell_x > m_max_cell_x || cell_y > m_max_cell_y) {
+            return m_empty_bucket;
+        }
+        return static_cast<uint32_t>((cell_y - m_min_cell_y) * m_grid_width + (cell_x - m_min_cell_x));
+    }
+    return ((static_cast<uint32_t>(cell_x) * 73856093U) ^ (static_cast<uint32_t>(cell_y) * 19349663U)) &
+           m_bucket_mask;
+}
+void FluidSystem::m_sortByCell() {
+    const size_t count = m_particles.size();
+    m_cell_x.resize(count);
+    m_cell_y.resize(count);
+    m_cell_key.resize(count);
+    const float inv_h = 1.f / m_kernel.radius;
+    m_parallelFor(count, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            m_cell_x[i] = static_cast<int>(floorf(m_particles.pred_x[i] * inv_h));
+            m_cell_y[i] = static_cast<int>(floorf(m_particles.pred_y[i] * inv_h));
+        }
+    });
+    m_min_cell_x = m_min_cell_y = INT32_MAX;
+    m_max_cell_x = m_max_cell_y = INT32_MIN;
+    for (size_t i = 0; i < count; i++) {
+        m_min_cell_x = std::min(m_min_cell_x, m_cell_x[i]);
+        m_min_cell_y = std::min(m_min_cell_y, m_cell_y[i]);
+        m_max_cell_x = std::max(m_max_cell_x, m_cell_x[i]);
+        m_max_cell_y = std::max(m_max_cell_y, m_cell_y[i]);
+    }
+    m_grid_width = m_max_cell_x - m_min_cell_x + 1;
+    const int64_t cell_count = static_cast<int64_t>(m_grid_width) * (m_max_cell_y - m_min_cell_y + 1);
+    m_isGridDense = cell_count <= static_cast<int64_t>(4U * count);
+    uint32_t bucket_count = 1U;
+    if (m_isGridDense) {
+        bucket_count = static_cast<uint32_t>(cell_count);
+    } else {
+        while (bucket_count < 2U * count) {
+            bucket_count <<= 1U;
+        }
+        m_bucket_mask = bucket_count - 1U;
+    }
+    m_empty_bucket = bucket_count;
+    m_parallelFor(count, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            m_cell_key[i] = m_bucketOf(m_cell_x[i], m_cell_y[i]);
+        }
+    });
+    m_cell_start.assign(bucket_count + 2U, 0U);
+    for (size_t i = 0; i < count; i++) {
+        m_cell_start[m_cell_key[i] + 1U]++;
+    }
+    for (uint32_t k = 0; k <= bucket_count; k++) {
+        m_cell_start[k + 1U] += m_cell_start[k];
+    }
+    m_order.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        m_order[m_cell_start[m_cell_key[i]]++] = i;
+    }
+    // every start was moved to the end of its bucket while scattering
+    for (uint32_t k = bucket_count + 1U; k > 0; k--) {
+        m_cell_start[k] = m_cell_start[k - 1U];
+    }
+    m_cell_start[0] = 0U;
+
+    // particles of a cell end up next to each other in memory
+    m_sorted.resize(count);
+    m_sorted_cell_x.resize(count);
+    m_sorted_cell_y.resize(count);
+    m_parallelFor(count, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const uint32_t from = m_order[i];
+            m_sorted.pos_x[i] = m_particles.pos_x[from];
+            m_sorted.pos_y[i] = m_particles.pos_y[from];
+            m_sorted.vel_x[i] = m_particles.vel_x[from];
+            m_sorted.vel_y[i] = m_particles.vel_y[from];
+            m_sorted.pred_x[i] = m_particles.pred_x[from];
+            m_sorted.pred_y[i] = m_particles.pred_y[from];
+            m_sorted_cell_x[i] = m_cell_x[from];
+            m_sorted_cell_y[i] = m_cell_y[from];
+        }
+    });
+    std::swap(m_particles, m_sorted);
+    std::swap(m_cell_x, m_sorted_cell_x);
+    std::swap(m_cell_y, m_sorted_cell_y);
+}
+void FluidSystem::m_findNeighbours() {
+    const size_t count = m_particles.size();
+    m_neighbours.resize(count * MAX_NEIGHBOURS);
+    m_neighbour_count.resize(count);
+    const float sq_h = m_kernel.sq_radius;
+    const float* pred_x = m_particles.pred_x.data();
+    const float* pred_y = m_particles.pred_y.data();
+    const int* cell_x = m_cell_x.data();
+    const int* cell_y = m_cell_y.data();
+    const uint32_t* cell_start = m_cell_start.data();
+    m_parallelFor(count, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t* neighbours = &m_neighbours[i * MAX_NEIGHBOURS];
+            uint32_t found = 0;
+            auto visitRange = [&](uint32_t first, uint32_t last, int cx, int cy) {
+                for (uint32_t j = first; j < last && found < MAX_NEIGHBOURS; j++) {
+                    // hashed buckets can be shared by other cells
+                    if (j == i || (!m_isGridDense && (cell_x[j] != cx || cell_y[j] != cy))) {
+                        continue;
+                    }
+                    const float diff_x = pred_x[i] - pred_x[j];
+                    const float diff_y = pred_y[i] - pred_y[j];
+                    if (diff_x * diff_x + diff_y * diff_y < sq_h) {
+                        neighbours[found++] = j;
+                    }
+                }
+            };
+            for (int cy = cell_y[i] - 1; cy <= cell_y[i] + 1; cy++) {
+                if (m_isGridDense && cy >= m_min_cell_y && cy <= m_max_cell_y) {
+                    // cells of a row are consecutive buckets
+                    const int first_x = std::max(cell_x[i] - 1, m_min_cell_x);
+                    const int last_x = std::min(cell_x[i] + 1, m_max_cell_x);
+                    visitRange(cell_start[m_bucketOf(first_x, cy)], cell_start[m_bucketOf(last_x, cy) + 1U], 0, 0);
+                    continue;
+                }
+                for (int cx = cell_x[i] - 1; cx <= cell_x[i] + 1; cx++) {
+                    const uint32_t bucket = m_bucketOf(cx, cy);
+                    visitRange(cell_start[bucket], cell_start[bucket + 1U], cx, cy);
+                }
+            }
+            m_neighbour_count[i] = static_cast<uint8_t>(found);
+        }
+    });
+}
+void FluidSystem::m_gatherObstacles() {
+    m_obstacles.clear();
+    m_bodies.clear();
+    const float h = m_kernel.radius;
+    // particles can move about a kernel radius while being solved
+    const AABB fluid_area = AABB::CreateMinMax(
+            vec2f(m_min_cell_x - 1, m_min_cell_y - 1) * h, vec2f(m_max_cell_x + 2, m_max_cell_y + 2) * h
+    );
+    auto grown = [&](const AABB& aabb, float margin) {
+        return AABB::CreateMinMax(aabb.min - vec2f(margin, margin), aabb.max + vec2f(margin, margin));
+    };
+    for (auto entity : entities) {
+        const auto& col = getComponent<Collider>(entity);
+        if (col.model_shape().empty()) {
+            continue;
+        }
+        auto& trans = getComponent<Transform>(entity);
+        auto& rb = getComponent<Rigidbody>(entity);
+        if (!isOverlappingAABBAABB(fluid_area, AABB::TransformedAABB(trans.global(), col.extent()))) {
+            continue;
+        }
+        uint32_t body = ParticleObstacle::NONE;
+        if (!rb.isStatic) {
+            body = static_cast<uint32_t>(m_bodies.size());
+            m_bodies.push_back(ParticleCoupledBody{
+                    entity, &rb, &trans, transformPoint(trans.global(), vec2f(0.f, 0.f)),
+                    vec2f(0.f, 0.f), 0.f, col.isNonMoving});
+        }
+        const float radius = col.isRound() ? col.transformed_radius(trans) : 0.f;
+        for (size_t i = 0; i < col.model_shape().size(); i++) {
+            ParticleObstacle obstacle;
+            col.transformed_piece(trans, i, obstacle.piece);
+            obstacle.type = col.type();
+            obstacle.radius = radius;
+            obstacle.aabb = grown(AABB::CreateFromVerticies(obstacle.piece.vertices), radius + particle_radius + h);
+            obstacle.body = body;
+            if (isOverlappingAABBAABB(fluid_area, obstacle.aabb)) {
+                m_obstacles.push_back(std::move(obstacle));
+            }
+        }
+    }
+    auto* tilemaps = ECS().getSystem<TilemapSystem>();
+    if (tilemaps == nullptr) {
+        return;
+    }
+    tilemaps->forEachPieceIn(fluid_area, [&](Entity entity, size_t piece, const AABB& aabb) {
+        m_obstacles.push_back(ParticleObstacle{
+                ECS().getComponent<TilemapCollider>(entity)->worldPiece(piece), eShapeType::Polygon, 0.f,
+                grown(aabb, particle_radius + h), ParticleObstacle::NONE});
+    });
+}
+void FluidSystem::m_solveDensity() {
+    const Kernel kernel = m_kernel;
+    const float inv_rest_density = 1.f / m_rest_density;
+    const float epsilon = relaxation / kernel.sq_radius;
+    const float self_density = kernel.poly6(0.f);
+    const float pressure_scale = -tensile_strength;
+    const float inv_tensile_reference = 1.f / m_tensile_reference;
+    const float* pred_x = m_particles.pred_x.data();
+    const float* pred_y = m_particles.pred_y.data();
+    const uint32_t* all_neighbours = m_neighbours.data();
+    const uint8_t* neighbour_count = m_neighbour_count.data();
+    float* lambda = m_lambda.data();
+    float* delta_x = m_delta_x.data();
+    float* delta_y = m_delta_y.data();
+    m_parallelFor(m_particles.size(), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const uint32_t* neighbours = &all_neighbours[i * MAX_NEIGHBOURS];
+            float density_sum = self_density;
+            float grad_x = 0.f;
+            float grad_y = 0.f;
+            float sq_grad_sum = 0.f;
+            for (uint32_t n = 0; n < neighbour_count[i]; n++) {
+                const uint32_t j = neighbours[n];
+                const float diff_x = pred_x[i] - pred_x[j];
+                const float diff_y = pred_y[i] - pred_y[j];
+                const float sq_dist = diff_x * diff_x + diff_y * diff_y;
+                density_sum += kernel.poly6(sq_dist);
+                const float dist = sqrtf(sq_dist);
+                if (dist < 1e-6f) {
+                    continue;
+                }
+                const float grad = kernel.spikyGrad(dist) * inv_rest_density / dist;
+                grad_x += grad * diff_x;
+                grad_y += grad * diff_y;
+                sq_grad_sum += grad * grad * sq_dist;
+            }
+            sq_grad_sum += grad_x * grad_x + grad_y * grad_y;
+            // only compression is resolved, sparse particles at the surface
+            // are held together by the artificial pressure instead
+            const float constraint = std::max(density_sum * inv_rest_density - 1.f, 0.f);
+            lambda[i] = -constraint / (sq_grad_sum + epsilon);
+        }
+    });
+    m_parallelFor(m_particles.size(), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const uint32_t* neighbours = &all_neighbours[i * MAX_NEIGHBOURS];
+            float sum_x = 0.f;
+            float sum_y = 0.f;
+            for (uint32_t n = 0; n < neighbour_count[i]; n++) {
+                const uint32_t j = neighbours[n];
+                const float diff_x = pred_x[i] - pred_x[j];
+                const float diff_y = pred_y[i] - pred_y[j];
+                const float sq_dist = diff_x * diff_x + diff_y * diff_y;
+                const float dist = sqrtf(sq_dist);
+                if (dist < 1e-6f) {
+                    continue;
+                }
+                const float ratio = kernel.poly6(sq_dist) * inv_tensile_reference;
+                const float pressure = pressure_scale * ratio * ratio * ratio * ratio;
+                // gradient of the kernel points from the particle towards its neighbour
+                const float scale = -(lambda[i] + lambda[j] + pressure) * kernel.spikyGrad(dist) / dist;
+                sum_x += scale * diff_x;
+                sum_y += scale * diff_y;
+            }
+            delta_x[i] = sum_x * inv_rest_density;
+            delta_y[i] = sum_y * inv_rest_density;
+        }
+    });
+}
+void FluidSystem::m_applyDeltas() {
+    const vec2f min = bounds.min + vec2f(particle_radius, particle_radius);
+    const vec2f max = bounds.max - vec2f(particle_radius, particle_radius);
+    m_parallelFor(m_particles.size(), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            m_particles.pred_x[i] = std::clamp(m_particles.pred_x[i] + m_delta_x[i], min.x, max.x);
+            m_particles.pred_y[i] = std::clamp(m_particles.pred_y[i] + m_delta_y[i], min.y, max.y);
+        }
+    });
+}
+void FluidSystem::m_collide(float delT) {
+    for (const auto& obstacle : m_obstacles) {
+        ParticleCoupledBody* body = obstacle.body == ParticleObstacle::NONE ? nullptr : &m_bodies[obstacle.body];
+        m_forEachParticleIn(obstacle.aabb, [&](uint32_t i) {
+            vec2f point(m_particles.pred_x[i], m_particles.pred_y[i]);
+            if (body != nullptr) {
+                // contacts already solved this update moved the body
+                point -= body->delta_pos;
+            }
+            vec2f normal;
+            const vec2f start(m_particles.pos_x[i], m_particles.pos_y[i]);
+            const float depth = obstacle.penetration(start, point, particle_radius, normal);
+            if (depth <= 0.f) {
+                return;
+            }
+            const bool isMovable = body != nullptr && !body->isDormant;
+            if (!isMovable) {
+                m_particles.pred_x[i] += normal.x * depth;
+                m_particles.pred_y[i] += normal.y * depth;
+                const float speed = length(
+                        vec2f(m_particles.pred_x[i] - m_particles.pos_x[i], m_particles.pred_y[i] - m_particles.pos_y[i])
+                ) / delT;
+                // asleep bodies only start taking part from the next update
+                if (body != nullptr && speed > PhysicsSystem::SLOW_VEL) {
+                    body->rigidbody->time_resting = 0.f;
+                }
+                return;
+            }
+            const vec2f correction = body->correct(point - normal * particle_radius, normal, depth, m_particle_mass, delT);
+            m_particles.pred_x[i] += correction.x;
+            m_particles.pred_y[i] += correction.y;
+        });
+    }
+}
+void FluidSystem::m_applyViscosity() {
+    const Kernel kernel = m_kernel;
+    const float scale = viscosity / m_rest_density;
+    m_sorted.vel_x.resize(m_particles.size());
+    m_sorted.vel_y.resize(m_particles.size());
+    const float* pred_x = m_particles.pred_x.data();
+    const float* pred_y = m_particles.pred_y.data();
+    const float* vel_x = m_particles.vel_x.data();
+    const float* vel_y = m_particles.vel_y.data();
+    const uint32_t* all_neighbours = m_neighbours.data();
+    const uint8_t* neighbour_count = m_neighbour_count.data();
+    float* smoothed_x = m_sorted.vel_x.data();
+    float* smoothed_y = m_sorted.vel_y.data();
+    m_parallelFor(m_particles.size(), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const uint32_t* neighbours = &all_neighbours[i * MAX_NEIGHBOURS];
+            float sum_x = 0.f;
+            float sum_y = 0.f;
+            for (uint32_t n = 0; n < neighbour_count[i]; n++) {
+                const uint32_t j = neighbours[n];
+                const float diff_x = pred_x[i] - pred_x[j];
+                const float diff_y = pred_y[i] - pred_y[j];
+                const float weight = kernel.poly6(diff_x * diff_x + diff_y * diff_y);
+                sum_x += (vel_x[j] - vel_x[i]) * weight;
+                sum_y += (vel_y[j] - vel_y[i]) * weight;
+            }
+            smoothed_x[i] = vel_x[i] + scale * sum_x;
+            smoothed_y[i] = vel_y[i] + scale * sum_y;
+        }
+    });
+    std::swap(m_particles.vel_x, m_sorted.vel_x);
+    std::swap(m_particles.vel_y, m_sorted.vel_y);
+}
+void FluidSystem::m_applyBodyCorrections(float delT) {
+    for (auto& body : m_bodies) {
+        body.apply(delT);
+    }
+}
+void FluidSystem::update(float delT) {
+    const size_t count = m_particles.size();
+    if (count == 0 || delT <= 0.f || substep_count == 0) {
+        return;
+    }
+    m_updateKernel();
+    m_lambda.resize(count);
+    m_delta_x.resize(count);
+    m_delta_y.resize(count);
+    const float sub_dt = delT / static_cast<float>(substep_count);
+    const vec2f min = bounds.min + vec2f(particle_radius, particle_radius);
+    const vec2f max = bounds.max - vec2f(particle_radius, particle_radius);
+    for (size_t substep = 0; substep < substep_count; substep++) {
+        m_parallelFor(count, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                m_particles.vel_x[i] += gravity.x * sub_dt;
+                m_particles.vel_y[i] += gravity.y * sub_dt;
+                m_particles.pred_x[i] = std::clamp(m_particles.pos_x[i] + m_particles.vel_x[i] * sub_dt, min.x, max.x);
+                m_particles.pred_y[i] = std::clamp(m_particles.pos_y[i] + m_particles.vel_y[i] * sub_dt, min.y, max.y);
+            }
+        });
+        m_sortByCell();
+        m_findNeighbours();
+        if (substep == 0) {
+            m_gatherObstacles();
+        }
+        for (size_t iteration = 0; iteration < iteration_count; iteration++) {
+            m_solveDensity();
+            m_applyDeltas();
+            m_collide(sub_dt);
+        }
+        const float inv_dt = 1.f / sub_dt;
+        m_parallelFor(count, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                m_particles.vel_x[i] = (m_particles.pred_x[i] - m_particles.pos_x[i]) * inv_dt;
+                m_particles.vel_y[i] = (m_particles.pred_y[i] - m_particles.pos_y[i]) * inv_dt;
+            }
+        });
+        m_applyViscosity();
+        std::swap(m_particles.pos_x, m_particles.pred_x);
+        std::swap(m_particles.pos_y, m_particles.pred_y);
+    }
+    m_applyBodyCorrections(delT);
+}
+}; // namespace emp
@@ -0,0 +1,156 @@
+#ifndef EMP_FLUID_SYSTEM_HPP
+#define EMP_FLUID_SYSTEM_HPP
+#include <cstdint>
+#include <vector>
+#include "compute/multithreading/thread_pool.hpp"
+#include "core/system.hpp"
+#include "math/geometry_func.hpp"
+#include "math/math_defs.hpp"
+#include "math/shapes/AABB.hpp"
+#include "physics/collider.hpp"
+#include "physics/particle_contact.hpp"
+#include "physics/rigidbody.hpp"
+#include "scene/transform.hpp"
+namespace emp {
+// particle state laid out by fields so that every pass streams through memory,
+// particles are reordered by cell on every update so indices are not stable
+struct FluidParticles {
+    std::vector<float> pos_x, pos_y;
+    std::vector<float> vel_x, vel_y;
+    // positions predicted for the end of the tick, constraints are solved on them
+    std::vector<float> pred_x, pred_y;
+
+    size_t size() const {
+        return pos_x.size();
+    }
+    void resize(size_t size);
+};
+/**
+ * position based fluid (Macklin, Muller 2013) simulated on the cpu
+ *
+ * particles are not entities, they live in FluidParticles and are pushed out of
+ * every collider and tilemap, dynamic bodies get the opposite correction through
+ * calcPositionalCorrection so that fluid can carry and be displaced by them
+ *
+ * has to be updated after PhysicsSystem with the same delta time
+ */
+class FluidSystem : public System<Transform, Rigidbody, Collider> {
+public:
+    // particles rest 2 * particle_radius apart
+    float particle_radius = 2.f;
+    // mass per area, in the same units as density of rigidbodies
+    float density = 1.f;
+    vec2f gravity = {0.f, 1.f};
+    // every substep searches neighbours again, fast flows need more of them
+    size_t substep_count = 2U;
+    size_t iteration_count = 3U;
+    // part of the velocity difference to neighbours removed every tick (XSPH)
+    float viscosity = 0.05f;
+    // softens the density constraint, higher is more stable and more compressible
+    float relaxation = 5.f;
+    // artificial pressure keeping particles from clumping at the surface
+    float tensile_strength = 0.01f;
+    // particles are kept inside
+    AABB bounds = AABB::CreateMinMax(vec2f(-1e6f, -1e6f), vec2f(1e6f, 1e6f));
+    bool useParallelSolver = true;
+
+    // solver work is split among workers of thread_pool, usually the one of PhysicsSystem
+    FluidSystem(ThreadPool& thread_pool);
+    // particles added after an update are only sorted into cells by the next one
+    void addParticle(vec2f position, vec2f velocity = vec2f(0.f, 0.f));
+    // fills area with particles spaced at rest distance
+    void addBlock(const AABB& area, vec2f velocity = vec2f(0.f, 0.f));
+    void clear();
+    inline size_t particleCount() const {
+        return m_particles.size();
+    }
+    inline const FluidParticles& particles() const {
+        return m_particles;
+    }
+    void update(float delT);
+
+private:
+    static constexpr size_t MAX_NEIGHBOURS = 32U;
+    // kernel radius in rest distances between particles
+    static constexpr float KERNEL_SCALE = 2.f;
+    // smoothing kernels of radius h, copied into passes so that nothing
+    // has to be reloaded after every store
+    struct Kernel {
+        float radius = 1.f;
+        float sq_radius = 1.f;
+        float poly6_coef = 0.f;
+        float spiky_coef = 0.f;
+
+        inline float poly6(float sq_dist) const {
+            if (sq_dist >= sq_radius) {
+                return 0.f;
+            }
+            const float diff = sq_radius - sq_dist;
+            return poly6_coef * diff * diff * diff;
+        }
+        // magnitude of the gradient of the spiky kernel, points towards the neighbour
+        inline float spikyGrad(float dist) const {
+            if (dist >= radius) {
+                return 0.f;
+            }
+            const float diff = radius - dist;
+            return spiky_coef * diff * diff;
+        }
+    };
+
+    // constants for the current particle_radius
+    Kernel m_kernel;
+    float m_rest_density = 1.f;
+    float m_particle_mass = 1.f;
+    // kernel value at which artificial pressure is measured
+    float m_tensile_reference = 1.f;
+
+    FluidParticles m_particles;
+    FluidParticles m_sorted;
+    std::vector<float> m_lambda;
+    std::vector<float> m_delta_x, m_delta_y;
+    // cell each particle was sorted into
+    std::vector<int> m_cell_x, m_cell_y;
+    std::vector<int> m_sorted_cell_x, m_sorted_cell_y;
+    std::vector<uint32_t> m_cell_key;
+    // particles of bucket k are in [m_cell_start[k], m_cell_start[k + 1])
+    std::vector<uint32_t> m_cell_start;
+    std::vector<uint32_t> m_order;
+    std::vector<uint32_t> m_neighbours;
+    std::vector<uint8_t> m_neighbour_count;
+    // bounds of predicted positions in cells, obstacles are clamped to them
+    int m_min_cell_x = 0, m_min_cell_y = 0, m_max_cell_x = 0, m_max_cell_y = 0;
+    // compact fluid gets a bucket for every cell of its bounds in row order so
+    // that neighbouring cells stay close in memory, spread out one is hashed
+    bool m_isGridDense = false;
+    int m_grid_width = 0;
+    uint32_t m_bucket_mask = 0;
+    // always empty, cells outside of a dense grid map to it
+    uint32_t m_empty_bucket = 0;
+
+    std::vector<ParticleObstacle> m_obstacles;
+    std::vector<ParticleCoupledBody> m_bodies;
+
+    void m_updateKernel();
+    uint32_t m_bucketOf(int cell_x, int cell_y) const;
+    // counting sort of particles by the bucket of their predicted position
+    void m_sortByCell();
+    void m_findNeighbours();
+    void m_gatherObstacles();
+    void m_solveDensity();
+    void m_applyDeltas();
+    // pushes particles out of obstacles, bodies are corrected one contact at a time
+    void m_collide(float delT);
+    void m_applyViscosity();
+    void m_applyBodyCorrections(float delT);
+    // calls visit with every particle sorted into a cell overlapping area
+    template <class Visitor>
+    void m_forEachParticleIn(const AABB& area, Visitor&& visit) const;
+    // runs task(begin, end) over ranges of [0, count) and waits for all of them
+    template <class Task>
+    void m_parallelFor(size_t count, Task&& task);
+
+    ThreadPool& m_thread_pool;
+};
+}; // namespace emp
+#endif
@@ -0,0 +1,23 @@
+#include "force_field.hpp"
+#include "math/math_func.hpp"
+namespace emp {
+ForceField ForceField::Directional(AABB area, vec2f force) {
+    ForceField result;
+    result.area = area;
+    result.force = [force](vec2f, vec2f, float) { return force; };
+    return result;
+}
+ForceField ForceField::Radial(vec2f center, float radius, float strength) {
+    ForceField result;
+    result.area = AABB::CreateCenterSize(center, vec2f(radius * 2.f));
+    result.force = [=](vec2f position, vec2f, float) {
+        const auto diff = position - center;
+        const auto dist = length(diff);
+        if (dist >= radius || dist == 0.f) {
+            return vec2f(0.f);
+        }
+        return diff / dist * strength * (1.f - dist / radius);
+    };
+    return result;
+}
+}; // namespace emp
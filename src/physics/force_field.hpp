@@ -0,0 +1,21 @@
+#ifndef EMP_FORCE_FIELD_HPP
+#define EMP_FORCE_FIELD_HPP
+#include <functional>
+#include "math/math_defs.hpp"
+#include "math/shapes/AABB.hpp"
+namespace emp {
+// analytic force acting on every awake body whose center lies inside of area
+struct ForceField {
+    typedef std::function<vec2f(vec2f position, vec2f velocity, float mass)> ForceFunc;
+    AABB area;
+    ForceFunc force;
+    bool enabled = true;
+
+    // same force everywhere inside of area (wind zones)
+    static ForceField Directional(AABB area, vec2f force);
+    // pushes away from center falling off linearly to 0 at radius,
+    // negative strength pulls towards it instead (explosions, attractors)
+    static ForceField Radial(vec2f center, float radius, float strength);
+};
+}; // namespace emp
+#endif
@@ -0,0 +1,58 @@
+#include "particle_contact.hpp"
+#include <algorithm>
+#include <cmath>
+#include "physics/constraint.hpp"
+namespace emp {
+float ParticleObstacle::penetration(vec2f start, vec2f point, float particle_radius, vec2f& normal) const {
+    const auto& verts = piece.vertices;
+    if (type != eShapeType::Polygon) {
+        const vec2f closest = type == eShapeType::Circle
+                ? verts[0]
+                : findClosestPointOnRay(verts[0], verts[1] - verts[0], point);
+        const float dist = length(point - closest);
+        normal = dist > 1e-6f ? (point - closest) / dist : vec2f(0.f, -1.f);
+        return radius + particle_radius - dist;
+    }
+    // pushed out through the face it came from, so that fast
+    // particles do not end up on the other side of thin pieces
+    float max_separation = -INFINITY;
+    float max_dist = -INFINITY;
+    float depth = 0.f;
+    for (size_t e = 0; e < verts.size(); e++) {
+        const float separation = dot(piece.normals[e], start - verts[e]);
+        max_dist = std::max(max_dist, dot(piece.normals[e], point - verts[e]));
+        if (separation > max_separation) {
+            max_separation = separation;
+            normal = piece.normals[e];
+            depth = particle_radius - dot(normal, point - verts[e]);
+        }
+    }
+    // already separated by another face
+    if (max_dist >= particle_radius) {
+        return 0.f;
+    }
+    return depth;
+}
+vec2f ParticleCoupledBody::correct(vec2f contact, vec2f normal, float depth, float particle_mass, float delT) {
+    PositionalCorrectionInfo info(normal, entity, contact - center, rigidbody, entity, vec2f(0.f, 0.f));
+    // second body is the particle itself
+    info.isStatic2 = false;
+    info.mass2 = particle_mass;
+    info.inertia2 = INFINITY;
+    info.generalized_inverse_mass2 = 1.f / particle_mass;
+    const auto correction = calcPositionalCorrection(info, depth, normal, delT);
+    delta_pos += correction.pos1_correction;
+    delta_rot += correction.rot1_correction;
+    return correction.pos2_correction;
+}
+void ParticleCoupledBody::apply(float delT) {
+    if (delta_pos == vec2f(0.f, 0.f) && delta_rot == 0.f) {
+        return;
+    }
+    transform->position += delta_pos;
+    transform->rotation += delta_rot;
+    transform->syncWithChange();
+    rigidbody->velocity += delta_pos / delT;
+    rigidbody->angular_velocity += delta_rot / delT;
+}
+}; // namespace emp
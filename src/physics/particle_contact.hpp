@@ -0,0 +1,46 @@
+#ifndef EMP_PARTICLE_CONTACT_HPP
+#define EMP_PARTICLE_CONTACT_HPP
+#include <cstdint>
+#include "core/entity.hpp"
+#include "math/geometry_func.hpp"
+#include "math/math_defs.hpp"
+#include "math/shapes/AABB.hpp"
+#include "physics/collider.hpp"
+#include "physics/rigidbody.hpp"
+#include "scene/transform.hpp"
+namespace emp {
+// piece of a collider or tilemap baked into world space for one update of
+// particles, shared by fluids and soft bodies
+struct ParticleObstacle {
+    static constexpr uint32_t NONE = UINT32_MAX;
+    ConvexPiece piece;
+    eShapeType type;
+    float radius;
+    AABB aabb;
+    // index of the ParticleCoupledBody, NONE for bodies that do not move
+    uint32_t body;
+
+    // how deep a particle of particle_radius that moved from start to point
+    // overlaps the piece, normal points out of it, not touching if <= 0
+    float penetration(vec2f start, vec2f point, float particle_radius, vec2f& normal) const;
+};
+// dynamic body touched by particles, corrections are gathered over a whole
+// update and applied at its end
+struct ParticleCoupledBody {
+    Entity entity;
+    Rigidbody* rigidbody;
+    Transform* transform;
+    vec2f center;
+    vec2f delta_pos = vec2f(0.f, 0.f);
+    float delta_rot = 0.f;
+    // sleeping bodies are treated as static until the next update
+    bool isDormant;
+
+    // splits the correction of a particle of particle_mass overlapping the body
+    // by depth along normal at contact, returns the part of the particle
+    vec2f correct(vec2f contact, vec2f normal, float depth, float particle_mass, float delT);
+    // velocities are derived from the correction like in the rigidbody solver
+    void apply(float delT);
+};
+}; // namespace emp
+#endif
@@ -1,6 +1,8 @@
 #include "physics_system.hpp"
+#include <algorithm>
 #include <glm/vector_relational.hpp>
 #include <memory>
+#include <numeric>
 #include "core/coordinator.hpp"
 #include "debug/log.hpp"
 #include "math/geometry_func.hpp"
@@ -11,6 +13,199 @@
 
 #include "templates/sweep_line.hpp"
 namespace emp {
+// world space piece of a collider, round shapes are described by their core
+struct WorldPiece {
+    const ConvexPiece& piece;
+    float radius;
+};
+// separating_axis is the per pair axis hint, only polygon pairs make use of it
+typedef ContactManifold (*CollideFunc)(const WorldPiece&, const WorldPiece&, uint32_t& separating_axis);
+static Circle toCircle(const WorldPiece& piece) {
+    return Circle(piece.piece.vertices.front(), piece.radius);
+}
+static Capsule toCapsule(const WorldPiece& piece) {
+    return Capsule(piece.piece.vertices.front(), piece.piece.vertices.back(), piece.radius);
+}
+static ContactManifold collidePolygonPieces(const WorldPiece& p1, const WorldPiece& p2, uint32_t& separating_axis) {
+    return intersectPolygonPolygon(p1.piece, p2.piece, separating_axis);
+}
+static ContactManifold collideCirclePieces(const WorldPiece& p1, const WorldPiece& p2, uint32_t&) {
+    return collideCircleCircle(toCircle(p1), toCircle(p2));
+}
+static ContactManifold collideCirclePolygonPieces(const WorldPiece& p1, const WorldPiece& p2, uint32_t&) {
+    return collideCirclePolygon(toCircle(p1), p2.piece);
+}
+static ContactManifold collideCapsulePieces(const WorldPiece& p1, const WorldPiece& p2, uint32_t&) {
+    return collideCapsuleCapsule(toCapsule(p1), toCapsule(p2));
+}
+static ContactManifold collideCapsuleCirclePieces(const WorldPiece& p1, const WorldPiece& p2, uint32_t&) {
+    return collideCapsuleCircle(toCapsule(p1), toCircle(p2));
+}
+static ContactManifold collideCapsulePolygonPieces(const WorldPiece& p1, const WorldPiece& p2, uint32_t&) {
+    return collideCapsulePolygon(toCapsule(p1), p2.piece);
+}
+template <CollideFunc Func>
+static ContactManifold collideFlipped(const WorldPiece& p1, const WorldPiece& p2, uint32_t& separating_axis) {
+    return flipped(Func(p2, p1, separating_axis));
+}
+static ColliderShape::Handle translatedShape(const ColliderShape& shape, vec2f offset) {
+    std::vector<Collider::ConvexVertexCloud> pieces = shape.model_shape;
+    for(auto& piece : pieces) {
+        for(auto& p : piece) {
+            p += offset;
+        }
+    }
+    return ColliderShape::CreateFromPieces(std::move(pieces));
+}
+static const ConvexPiece& translated(const ConvexPiece& piece, vec2f offset, ConvexPiece& storage) {
+    storage.vertices.resize(piece.vertices.size());
+    for (size_t i = 0; i < piece.vertices.size(); i++) {
+        storage.vertices[i] = piece.vertices[i] + offset;
+    }
+    storage.normals = piece.normals;
+    return storage;
+}
+static AABB pieceAABB(const WorldPiece& piece) {
+    const auto core = AABB::CreateFromVerticies(piece.piece.vertices);
+    const vec2f reach(piece.radius, piece.radius);
+    return AABB::CreateMinMax(core.min - reach, core.max + reach);
+}
+static float smallestExtent(const WorldPiece& piece) {
+    const auto size = pieceAABB(piece).size();
+    return std::min(size.x, size.y);
+}
+static constexpr size_t MAX_SWEEP_SAMPLES = 32U;
+static constexpr int IMPACT_REFINE_ITERATIONS = 4;
+// conservative advancement along translations of both pieces made during a substep,
+// pieces are at the end of their motion, returns the part of the motion after
+// which they start touching or 1 when they do not need to be moved back
+static float timeOfImpact(
+        CollideFunc collide,
+        const WorldPiece& p1,
+        vec2f motion1,
+        const WorldPiece& p2,
+        vec2f motion2,
+        uint32_t& separating_axis
+) {
+    // sampling with steps of half the smaller piece can not skip over it
+    const float step = 0.5f * std::min(smallestExtent(p1), smallestExtent(p2));
+    const vec2f relative_motion = motion1 - motion2;
+    const float distance = length(relative_motion);
+    if (distance <= step) {
+        return 1.f;
+    }
+    static thread_local ConvexPiece moved1;
+    static thread_local ConvexPiece moved2;
+    auto collideAt = [&](float t) {
+        const WorldPiece at1{translated(p1.piece, (t - 1.f) * motion1, moved1), p1.radius};
+        const WorldPiece at2{translated(p2.piece, (t - 1.f) * motion2, moved2), p2.radius};
+        return collide(at1, at2, separating_axis);
+    };
+    const auto at_start = collideAt(0.f);
+    if (at_start.detected) {
+        // touching already, sliding is left to the regular narrow phase but
+        // moving deep into the other piece could carry it through
+        const float approach = -dot(relative_motion, at_start.contact_normal);
+        return approach > step ? 0.f : 1.f;
+    }
+    const size_t sample_count = std::min(MAX_SWEEP_SAMPLES, static_cast<size_t>(std::ceil(distance / step)));
+    float separated = 0.f;
+    for (size_t k = 1; k < sample_count; k++) {
+        const float t = static_cast<float>(k) / static_cast<float>(sample_count);
+        if (!collideAt(t).detected) {
+            separated = t;
+            continue;
+        }
+        float touching = t;
+        for (int i = 0; i < IMPACT_REFINE_ITERATIONS; i++) {
+            const float middle = 0.5f * (separated + touching);
+            (collideAt(middle).detected ? touching : separated) = middle;
+        }
+        return touching;
+    }
+    return 1.f;
+}
+// indexed by eShapeType of the first and the second piece
+static const CollideFunc COLLIDE_DISPATCH[SHAPE_TYPE_COUNT][SHAPE_TYPE_COUNT] = {
+        {
+                collidePolygonPieces,
+                collideFlipped<collideCirclePolygonPieces>,
+                collideFlipped<collideCapsulePolygonPieces>,
+        },
+        {
+                collideCirclePolygonPieces,
+                collideCirclePieces,
+                collideFlipped<collideCapsuleCirclePieces>,
+        },
+        {
+                collideCapsulePolygonPieces,
+                collideCapsuleCirclePieces,
+                collideCapsulePieces,
+        },
+};
+static IntersectionRayShapeResult intersectRayPiece(
+        vec2f origin, vec2f direction, const WorldPiece& piece, eShapeType type
+) {
+    switch (type) {
+        case eShapeType::Circle:
+            return intersectRayCircle(origin, direction, toCircle(piece));
+        case eShapeType::Capsule:
+            return intersectRayCapsule(origin, direction, toCapsule(piece));
+        default:
+            return intersectRayConvex(origin, direction, piece.piece);
+    }
+}
+// last part of motion the moving piece travels before touching target, INFINITY
+// when it never does, contact is taken at the first touching sample
+static float sweepTime(
+        CollideFunc collide,
+        const WorldPiece& moving,
+        vec2f motion,
+        const WorldPiece& target,
+        ContactManifold& contact
+) {
+    static thread_local ConvexPiece moved;
+    uint32_t separating_axis = 0;
+    auto collideAt = [&](float t) {
+        const WorldPiece at{translated(moving.piece, t * motion, moved), moving.radius};
+        return collide(at, target, separating_axis);
+    };
+    // only the part of motion along which bounding boxes overlap is sampled
+    const auto moving_box = pieceAABB(moving);
+    const auto target_box = pieceAABB(target);
+    const vec2f half_size = moving_box.size() * 0.5f;
+    const auto reach = AABB::CreateMinMax(target_box.min - half_size, target_box.max + half_size);
+    const float begin = segmentEntryTimeAABB(moving_box.center(), motion, reach);
+    if (begin == INFINITY) {
+        return INFINITY;
+    }
+    const float end = 1.f - segmentEntryTimeAABB(moving_box.center() + motion, -motion, reach);
+    contact = collideAt(begin);
+    if (contact.detected) {
+        return begin;
+    }
+    const float step = 0.5f * std::min(smallestExtent(moving), smallestExtent(target));
+    const float distance = (end - begin) * length(motion);
+    const size_t sample_count = distance <= step
+            ? 1U
+            : static_cast<size_t>(std::fmin(std::ceil(distance / step), MAX_SWEEP_SAMPLES));
+    float separated = begin;
+    for (size_t k = 1; k <= sample_count; k++) {
+        const float t = begin + (end - begin) * static_cast<float>(k) / static_cast<float>(sample_count);
+        if (!collideAt(t).detected) {
+            separated = t;
+            continue;
+        }
+        float touching = t;
+        for (int i = 0; i < IMPACT_REFINE_ITERATIONS; i++) {
+            const float middle = 0.5f * (separated + touching);
+            (collideAt(middle).detected ? touching : separated) = middle;
+        }
+        contact = collideAt(touching);
+        return separated;
+    }
+    return INFINITY;
+}
 float PhysicsSystem::m_calcRestitution(
         float coef,
         float normal_speed,
@@ -39,11 +234,28 @@ float PhysicsSystem::m_calcDynamicFriction(
 vec2f PhysicsSystem::m_calcContactVel(vec2f vel, float ang_vel, vec2f r) {
     return vel + ang_vel * vec2f(-r.y, r.x);
 }
+float PhysicsSystem::CachedManifold::warmLagrange(uint32_t feature_id, float delT) const {
+    for (uint8_t i = 0; i < point_count; i++) {
+        if (feature_ids[i] == feature_id) {
+            // a resting contact corrects about gravity * delT^2 every step
+            const float step_ratio = delT / delta_time;
+            return normal_lagrange[i] * step_ratio * step_ratio;
+        }
+    }
+    return 0.f;
+}
+PhysicsSystem::PairKey PhysicsSystem::m_pairKey(const CollidingPair& pair) {
+    return std::make_tuple(
+            std::get<Entity>(pair.first), std::get<Entity>(pair.second),
+            std::get<size_t>(pair.first), std::get<size_t>(pair.second)
+    );
+}
 PhysicsSystem::PenetrationConstraint PhysicsSystem::m_handleCollision(
         Entity e1,
         const int convexIdx1,
         Entity e2,
         const int convexIdx2,
+        CachedManifold& manifold,
         float delT,
         float compliance
 ) {
@@ -65,10 +277,6 @@ PhysicsSystem::PenetrationConstraint PhysicsSystem::m_handleCollision(
     vec2f& pos2 = trans2.position;
     float& rot1 = trans1.rotation;
     float& rot2 = trans2.rotation;
-    const float mass1 = rb1.mass();
-    const float mass2 = rb2.mass();
-    const float inertia1 = rb1.inertia();
-    const float inertia2 = rb2.inertia();
 
     //should not pass broad phase
     assert(!(rb1.isStatic && rb2.isStatic));
@@ -85,63 +293,74 @@ PhysicsSystem::PenetrationConstraint PhysicsSystem::m_handleCollision(
     result.dfriction = dfriction;
     result.restitution = restitution;
 
-    auto intersectingShape1 = col1.transformed_shape(trans1)[convexIdx1];
-    auto intersectingShape2 = col2.transformed_shape(trans2)[convexIdx2];
-    auto intersection =
-            intersectPolygonPolygon(intersectingShape1, intersectingShape2);
+    // reused between calls so that narrow phase does not allocate
+    static thread_local ConvexPiece transformed1;
+    static thread_local ConvexPiece transformed2;
+    const auto& intersectingShape1 = m_worldConvex(e1, convexIdx1, transformed1);
+    const auto& intersectingShape2 = m_worldConvex(e2, convexIdx2, transformed2);
+    const WorldPiece piece1{
+            intersectingShape1, col1.isRound() ? col1.transformed_radius(trans1) : 0.f};
+    const WorldPiece piece2{
+            intersectingShape2, col2.isRound() ? col2.transformed_radius(trans2) : 0.f};
+    const auto collide = COLLIDE_DISPATCH[static_cast<size_t>(col1.type())]
+                                         [static_cast<size_t>(col2.type())];
+
+    // fast bodies are moved back to where the pieces first touched,
+    // otherwise they could pass through each other within one substep
+    vec2f rewound1(0.f, 0.f);
+    vec2f rewound2(0.f, 0.f);
+    if (m_is_fast.test(e1) || m_is_fast.test(e2)) {
+        const vec2f motion1 = rb1.isStatic ? vec2f(0.f, 0.f) : pos1 - rb1.previous_position();
+        const vec2f motion2 = rb2.isStatic ? vec2f(0.f, 0.f) : pos2 - rb2.previous_position();
+        const float impact = timeOfImpact(
+                collide, piece1, motion1, piece2, motion2, manifold.separating_axis
+        );
+        if (impact < 1.f) {
+            rewound1 = (1.f - impact) * motion1;
+            rewound2 = (1.f - impact) * motion2;
+            // static transforms are shared between islands solved in parallel
+            if (!rb1.isStatic) {
+                pos1 -= rewound1;
+                trans1.syncWithChange();
+                m_worldConvex(e1, convexIdx1, transformed1);
+            }
+            if (!rb2.isStatic) {
+                pos2 -= rewound2;
+                trans2.syncWithChange();
+                m_worldConvex(e2, convexIdx2, transformed2);
+            }
+        }
+    }
+    auto intersection = collide(piece1, piece2, manifold.separating_axis);
     result.detected = intersection.detected;
     if (!intersection.detected) {
+        manifold.point_count = 0;
         return result;
     }
-    float vn = 0.f;
     auto normal = -intersection.contact_normal;
 
-    const auto penetration = intersection.overlap;
-    auto p1 = intersection.cp1;
-    auto p2 = intersection.cp2;
-    // TODO fix contact points
-    //  if(d > penetration * 2.f) {
-    //      EMP_LOG_DEBUG << "fixed";
-    //      return {false};
-    //  }
-
     result.info.collision_normal = intersection.contact_normal;
-    result.info.penetration = penetration;
-
-    // result.vel1_pre_solve = b1.vel;
-    // result.vel2_pre_solve = b2.vel;
-    // result.ang_vel1_pre_solve = b1.ang_vel;
-    // result.ang_vel2_pre_solve = b2.ang_vel;
-
-    const auto center_to_col_point1 = p1 - pos1;
-    const auto center_to_col_point2 = p2 - pos2;
-    const auto radius1 = rotateVec(center_to_col_point1, -rot1);
-    const auto radius2 = rotateVec(center_to_col_point2, -rot2);
-    result.info.collider_radius = radius1;
-    result.info.collidee_radius = radius2;
-
-    auto penetration_correction = calcPositionalCorrection(
-            PositionalCorrectionInfo(
-                    normal,
-                    e1,
-                    center_to_col_point1,
-                    &rb1,
-                    e2,
-                    center_to_col_point2,
-                    &rb2
-            ),
-            penetration,
-            normal,
-            delT
-    );
-    pos1 += penetration_correction.pos1_correction;
-    rot1 += penetration_correction.rot1_correction;
-    pos2 += penetration_correction.pos2_correction;
-    rot2 += penetration_correction.rot2_correction;
-
-    float delta_lagrange = penetration_correction.delta_lagrange;
+    result.info.penetration = intersection.overlap;
 
-    result.info.normal_lagrange = delta_lagrange;
+    // radii are fixed in model space so that every point sees
+    // corrections made by the previous one
+    result.point_count = intersection.point_count;
+    for (uint8_t i = 0; i < result.point_count; i++) {
+        const auto& manifold_point = intersection.points[i];
+        auto& point = result.points[i];
+        point.radius1 = rotateVec(manifold_point.point1 - pos1, -rot1);
+        point.radius2 = rotateVec(manifold_point.point2 - pos2, -rot2);
+        point.feature_id = manifold_point.feature_id;
+    }
+    result.info.collider_radius = rotateVec(intersection.cp1 - pos1, -rot1);
+    result.info.collidee_radius = rotateVec(intersection.cp2 - pos2, -rot2);
+    // only motion into the contact is taken away, sliding along it is given back
+    if (rewound1 != vec2f(0.f, 0.f)) {
+        pos1 += rewound1 - dot(rewound1, normal) * normal;
+    }
+    if (rewound2 != vec2f(0.f, 0.f)) {
+        pos2 += rewound2 - dot(rewound2, normal) * normal;
+    }
 
     auto displacementOfPoint = [](vec2f pos, float rot, vec2f radius, Rigidbody& rb) {
         if(rb.isStatic)
@@ -151,90 +370,239 @@ PhysicsSystem::PenetrationConstraint PhysicsSystem::m_handleCollision(
                    : rotateVec(radius, rot) -rotateVec(radius, rb.previous_rotation()));
     };
 
-    auto delta_p1 = displacementOfPoint(pos1, rot1, radius1, rb1);
-    auto delta_p2 = displacementOfPoint(pos2, rot2, radius2, rb2);
-    auto delta_p = delta_p1 - delta_p2;
-    auto delta_p_tangent = delta_p - dot(delta_p, normal) * normal;
-    auto sliding_len = length(delta_p_tangent);
-    
-    if (sliding_len <= 0.f) {
-        trans1.syncWithChange();
-        trans2.syncWithChange();
-        return result;
-    }
-    auto tangent = delta_p_tangent / sliding_len;
-
-    static const float sliding_tolerance = 0.1f;
-    if (sliding_len <= sfriction * penetration ||
-        nearlyEqual(sfriction * penetration - sliding_len, 0.f, sliding_tolerance * delT)) 
-    {
-        auto friction_correction = calcPositionalCorrection(
-                PositionalCorrectionInfo(
-                        tangent,
-                        e1,
-                        center_to_col_point1,
-                        &rb1,
-                        e2,
-                        center_to_col_point2,
-                        &rb2
-                ),
-                sliding_len,
-                tangent,
-                delT,
-                0.f
+    auto penetrationOf = [&](const ContactPoint& point) {
+        return dot(
+                (pos1 + rotateVec(point.radius1, rot1)) -
+                        (pos2 + rotateVec(point.radius2, rot2)),
+                normal
         );
-        pos1 += friction_correction.pos1_correction;
-        rot1 += friction_correction.rot1_correction;
-        pos2 += friction_correction.pos2_correction;
-        rot2 += friction_correction.rot2_correction;
+    };
+    // static bodies are shared between islands solved in parallel, so they
+    // must not be written to even though their corrections are zero
+    auto applyCorrection = [&](const PositionalCorrResult& correction) {
+        if (!rb1.isStatic) {
+            pos1 += correction.pos1_correction;
+            rot1 += correction.rot1_correction;
+        }
+        if (!rb2.isStatic) {
+            pos2 += correction.pos2_correction;
+            rot2 += correction.rot2_correction;
+        }
+    };
+
+    // both points are solved at once when possible, solving them one after
+    // another always in the same order leaves a rotation bias that makes
+    // stacks lean
+    bool isBlockSolved = false;
+    if (result.point_count == 2 && compliance == 0.f) {
+        const vec2f r1[2] = {
+                rotateVec(result.points[0].radius1, rot1),
+                rotateVec(result.points[1].radius1, rot1)
+        };
+        const vec2f r2[2] = {
+                rotateVec(result.points[0].radius2, rot2),
+                rotateVec(result.points[1].radius2, rot2)
+        };
+        const float c[2] = {
+                penetrationOf(result.points[0]), penetrationOf(result.points[1])
+        };
+        auto coupling = [&](int i, int j) {
+            return 1.f / rb1.mass() +
+                   perp_dot(r1[i], normal) * perp_dot(r1[j], normal) / rb1.inertia() +
+                   1.f / rb2.mass() +
+                   perp_dot(r2[i], normal) * perp_dot(r2[j], normal) / rb2.inertia();
+        };
+        const float k11 = coupling(0, 0);
+        const float k22 = coupling(1, 1);
+        const float k12 = coupling(0, 1);
+        const float det = k11 * k22 - k12 * k12;
+        // points too close to each other make the system ill conditioned
+        static const float max_condition_number = 1000.f;
+        if (c[0] > 0.f && c[1] > 0.f &&
+            k11 * k11 < max_condition_number * det) {
+            const float lagrange1 = -(k22 * c[0] - k12 * c[1]) / det;
+            const float lagrange2 = -(k11 * c[1] - k12 * c[0]) / det;
+            // both points have to push, otherwise one of them separates
+            if (lagrange1 <= 0.f && lagrange2 <= 0.f) {
+                const vec2f p1 = lagrange1 * normal;
+                const vec2f p2 = lagrange2 * normal;
+                PositionalCorrResult correction;
+                if (!rb1.isStatic) {
+                    correction.pos1_correction = (p1 + p2) / rb1.mass();
+                    correction.rot1_correction =
+                            (perp_dot(r1[0], p1) + perp_dot(r1[1], p2)) /
+                            rb1.inertia();
+                }
+                if (!rb2.isStatic) {
+                    correction.pos2_correction = -(p1 + p2) / rb2.mass();
+                    correction.rot2_correction =
+                            -(perp_dot(r2[0], p1) + perp_dot(r2[1], p2)) /
+                            rb2.inertia();
+                }
+                applyCorrection(correction);
+                result.points[0].normal_lagrange = lagrange1;
+                result.points[1].normal_lagrange = lagrange2;
+                isBlockSolved = true;
+            }
+        }
+    }
+
+    float total_lagrange = 0.f;
+    std::array<bool, 2> isWarmStarted{};
+    for (uint8_t i = 0; i < result.point_count; i++) {
+        auto& point = result.points[i];
+        float penetration = penetrationOf(point);
+        if (!isBlockSolved) {
+            // resolved by the other point of the manifold, the warm multiplier
+            // keeps friction acting on this point while it still carries load
+            if (penetration <= 0.f) {
+                point.normal_lagrange = manifold.warmLagrange(point.feature_id, delT);
+                isWarmStarted[i] = true;
+                continue;
+            }
+            auto penetration_correction = calcPositionalCorrection(
+                    PositionalCorrectionInfo(
+                            normal,
+                            e1,
+                            rotateVec(point.radius1, rot1),
+                            &rb1,
+                            e2,
+                            rotateVec(point.radius2, rot2),
+                            &rb2
+                    ),
+                    penetration,
+                    normal,
+                    delT,
+                    compliance
+            );
+            applyCorrection(penetration_correction);
+            point.normal_lagrange = penetration_correction.delta_lagrange;
+        } else {
+            // block solve moves the points onto each other,
+            // friction budget comes from what was corrected
+            penetration = -point.normal_lagrange *
+                          (rb1.generalizedInverseMass(rotateVec(point.radius1, rot1), normal) +
+                           rb2.generalizedInverseMass(rotateVec(point.radius2, rot2), normal));
+        }
+        total_lagrange += point.normal_lagrange;
+
+        auto delta_p1 = displacementOfPoint(pos1, rot1, point.radius1, rb1);
+        auto delta_p2 = displacementOfPoint(pos2, rot2, point.radius2, rb2);
+        auto delta_p = delta_p1 - delta_p2;
+        auto delta_p_tangent = delta_p - dot(delta_p, normal) * normal;
+        auto sliding_len = length(delta_p_tangent);
+        if (sliding_len <= 0.f) {
+            continue;
+        }
+        auto tangent = delta_p_tangent / sliding_len;
+
+        static const float sliding_tolerance = 0.1f;
+        if (sliding_len <= sfriction * penetration ||
+            nearlyEqual(sfriction * penetration - sliding_len, 0.f, sliding_tolerance * delT))
+        {
+            auto friction_correction = calcPositionalCorrection(
+                    PositionalCorrectionInfo(
+                            tangent,
+                            e1,
+                            rotateVec(point.radius1, rot1),
+                            &rb1,
+                            e2,
+                            rotateVec(point.radius2, rot2),
+                            &rb2
+                    ),
+                    sliding_len,
+                    tangent,
+                    delT,
+                    0.f
+            );
+            applyCorrection(friction_correction);
+        }
+    }
+    result.info.normal_lagrange = total_lagrange;
+
+    // warm multipliers are used only for the step after they were solved,
+    // carrying them further would keep a load the point no longer has
+    manifold.point_count = result.point_count;
+    manifold.delta_time = delT;
+    for (uint8_t i = 0; i < result.point_count; i++) {
+        manifold.feature_ids[i] = result.points[i].feature_id;
+        manifold.normal_lagrange[i] = isWarmStarted[i] ? 0.f : result.points[i].normal_lagrange;
+    }
 
-        delta_lagrange = friction_correction.delta_lagrange;
+    // static transforms are shared between islands solved in parallel
+    if (!rb1.isStatic) {
+        trans1.syncWithChange();
+    }
+    if (!rb2.isStatic) {
+        trans2.syncWithChange();
     }
-    trans1.syncWithChange();
-    trans2.syncWithChange();
     return result;
 }
-bool PhysicsSystem::m_isCollisionAllowed(
-    const CollidingPair& pair, const ColliderSystem& col_sys) const {
-    auto e1 = std::get<Entity>(pair.first);
-    auto e2 = std::get<Entity>(pair.second);
-    auto s1i = std::get<size_t>(pair.first);
-    auto s2i = std::get<size_t>(pair.second);
-    const auto& col1 = getComponent<Collider>(e1);
-    const auto& col2 = getComponent<Collider>(e2);
-    const auto& rb1 = getComponent<Rigidbody>(e1);
-    const auto& rb2 = getComponent<Rigidbody>(e2);
-    if(e1 == e2)
-        return false;
-    if(col1.isNonMoving && col2.isNonMoving)
+bool PhysicsSystem::m_isCollisionAllowed(const CollidingPoly& first, const CollidingPoly& second) {
+    const auto& filter1 = std::get<ProxyFilter>(first);
+    const auto& filter2 = std::get<ProxyFilter>(second);
+    if(std::get<Entity>(first) == std::get<Entity>(second))
         return false;
-    if(rb1.isStatic && rb2.isStatic)
+    if(filter1.isNonMoving && filter2.isNonMoving)
         return false;
-    if(!col_sys.canCollide(col1.collider_layer, col2.collider_layer))
+    if(filter1.isStatic && filter2.isStatic)
         return false;
-    return true;
-}
-void PhysicsSystem::m_filterPotentialCollisions(
-    std::vector<CollidingPair>& pairs, const ColliderSystem& col_sys) {
-    for(int i = 0; i < pairs.size(); i++) {
-        if(!m_isCollisionAllowed(pairs[i], col_sys)) {
-            pairs.erase(pairs.begin() + i);
-            i--;
-            continue;
-        }
+    return (filter1.mask >> filter2.layer) & 1U;
+}
+ProxyFilter PhysicsSystem::m_proxyFilter(const Collider& col, const Rigidbody& rb) const {
+    ProxyFilter result;
+    result.mask = m_layer_masks[col.collider_layer];
+    result.layer = col.collider_layer;
+    result.isStatic = rb.isStatic;
+    result.isNonMoving = col.isNonMoving;
+    return result;
+}
+void PhysicsSystem::m_appendProxies(Entity e, std::vector<CollidingPoly>& proxies, float sweep_time) {
+    const auto& col = getComponent<Collider>(e);
+    const auto& trans = getComponent<Transform>(e);
+    const auto& rb = getComponent<Rigidbody>(e);
+    const auto filter = m_proxyFilter(col, rb);
+    auto shape = col.transformed_shape(trans);
+    const size_t first = proxies.size();
+    float smallest_extent = INFINITY;
+    for(int i = 0; i < shape.size(); i++) {
+        const auto aabb = m_proxyAABB(col, trans, shape[i]);
+        smallest_extent = std::min({smallest_extent, aabb.size().x, aabb.size().y});
+        proxies.push_back({e, i, aabb, filter});
+    }
+    if(sweep_time <= 0.f || rb.isStatic) {
+        return;
+    }
+    // forces are not applied yet, gravity is the only one known up front
+    const vec2f motion = (rb.velocity + gravity * sweep_time) * sweep_time;
+    const bool isFast = rb.useContinuousCollision ||
+                        length(motion) > FAST_MOTION_FRACTION * smallest_extent;
+    m_is_fast.set(e, isFast);
+    if(!isFast) {
+        return;
+    }
+    for(size_t i = first; i < proxies.size(); i++) {
+        auto& aabb = std::get<AABB>(proxies[i]);
+        aabb.expandToContain(aabb.min + motion);
+        aabb.expandToContain(aabb.max + motion);
+    }
+}
+AABB PhysicsSystem::m_proxyAABB(
+        const Collider& col, const Transform& trans, const Collider::ConvexVertexCloud& piece
+) const {
+    auto aabb = AABB::CreateFromVerticies(piece);
+    if(col.isRound()) {
+        const float radius = col.transformed_radius(trans);
+        aabb = AABB::CreateMinMax(aabb.min - vec2f(radius, radius), aabb.max + vec2f(radius, radius));
     }
+    aabb.setSize(aabb.size() * 1.5f);
+    return aabb;
 }
 void PhysicsSystem::m_updateQuadTree() {
     AABB current_minimal = AABB::Expandable();
-    for(auto e : entities) {
-        const auto& col = getComponent<Collider>(e);
-        const auto& trans = getComponent<Transform>(e);
-
-        auto aabb = col.extent();
-        aabb = AABB::TransformedAABB(trans.global(), aabb);
-
-        current_minimal.expandToContain(aabb.min);
-        current_minimal.expandToContain(aabb.max);
+    for(const auto& proxy : m_awake_proxies) {
+        current_minimal.expandToContain(std::get<AABB>(proxy).min);
+        current_minimal.expandToContain(std::get<AABB>(proxy).max);
     }
     if(m_quad_tree == nullptr || !AABBcontainsAABB(m_quad_tree->getAABB(), current_minimal)) {
         if(m_quad_tree){
@@ -245,61 +613,1112 @@ void PhysicsSystem::m_updateQuadTree() {
         m_quad_tree = std::unique_ptr<QuadTree_t>(new QuadTree_t(current_minimal, m_aabb_extracter));
     }
     m_quad_tree->clear();
+    for(const auto& proxy : m_awake_proxies) {
+        m_quad_tree->add(proxy);
+    }
+    m_quad_tree->updateLeafes();
+}
+void PhysicsSystem::m_updateStaticWorld() {
+    if(!m_isStaticWorldDirty) {
+        return;
+    }
+    m_isStaticWorldDirty = false;
+    m_static_shapes.clear();
+    m_static_tree.reset();
+    if(m_static_bodies.empty()) {
+        return;
+    }
+    std::vector<CollidingPoly> proxies;
+    AABB bounds = AABB::Expandable();
+    for(auto e : m_static_bodies) {
+        const auto& col = getComponent<Collider>(e);
+        // tilemaps have their pieces baked by TilemapSystem
+        if(col.model_shape().empty()) {
+            continue;
+        }
+        const auto& trans = getComponent<Transform>(e);
+        const auto filter = m_proxyFilter(col, getComponent<Rigidbody>(e));
+        auto& shape = m_static_shapes[e];
+        shape.resize(col.model_shape().size());
+        for(size_t i = 0; i < shape.size(); i++) {
+            col.transformed_piece(trans, i, shape[i]);
+            auto aabb = m_proxyAABB(col, trans, shape[i].vertices);
+            proxies.push_back({e, i, aabb, filter});
+            bounds.expandToContain(aabb.min);
+            bounds.expandToContain(aabb.max);
+        }
+    }
+    bounds.setSize(bounds.size() * 2.f);
+    m_static_tree = std::unique_ptr<QuadTree_t>(new QuadTree_t(bounds, m_aabb_extracter));
+    for(const auto& proxy : proxies) {
+        m_static_tree->add(proxy);
+    }
+    m_static_tree->updateLeafes();
+}
+const ConvexPiece& PhysicsSystem::m_worldConvex(
+        Entity entity, size_t index, ConvexPiece& storage
+) const {
+    auto baked = m_static_shapes.find(entity);
+    if(baked != m_static_shapes.end()) {
+        return baked->second[index];
+    }
+    if(m_is_tilemap.test(entity)) {
+        return ECS().getComponent<TilemapCollider>(entity)->worldPiece(index);
+    }
+    const auto& col = getComponent<Collider>(entity);
+    const auto& trans = getComponent<Transform>(entity);
+    col.transformed_piece(trans, index, storage);
+    return storage;
+}
+void PhysicsSystem::m_updateTilemaps() {
+    m_tilemaps = ECS().getSystem<TilemapSystem>();
+    m_is_tilemap.reset();
+    if(m_tilemaps == nullptr) {
+        return;
+    }
+    for(auto e : m_tilemaps->getEntities()) {
+        assert(entities.contains(e) && "tilemap needs a static Rigidbody, a Material and a Collider");
+        m_is_tilemap.set(e);
+    }
+    m_changed_tile_areas.clear();
+    m_tilemaps->update(m_changed_tile_areas);
+    if(m_sleeping_tree == nullptr) {
+        return;
+    }
+    for(const auto& area : m_changed_tile_areas) {
+        m_query_result.clear();
+        m_sleeping_tree->query(area, m_query_result);
+        for(const auto& proxy : m_query_result) {
+            if(m_is_sleeping.test(std::get<Entity>(proxy))) {
+                m_wakeIsland(std::get<Entity>(proxy));
+            }
+        }
+    }
+    std::erase_if(m_sleeping_bodies, [&](Entity e) { return !m_is_sleeping.test(e); });
+}
+void PhysicsSystem::invalidateStaticWorld() {
+    m_isStaticWorldDirty = true;
+}
+void PhysicsSystem::m_queryProxies(
+        const TreeQuery& query, const AABB& area, LayerMask mask, std::vector<CollidingPoly>& result
+) const {
+    result.clear();
+    for(const auto* tree : {m_quad_tree.get(), m_sleeping_tree.get(), m_static_tree.get()}) {
+        if(tree != nullptr) {
+            query(*tree, result);
+        }
+    }
+    // trees are only refreshed by update, entities removed since are skipped,
+    // so are pieces carved away and bodies that moved between trees are reported once
+    std::erase_if(result, [&](const CollidingPoly& proxy) {
+        const auto entity = std::get<Entity>(proxy);
+        if(!mask.test(std::get<ProxyFilter>(proxy).layer) || !entities.contains(entity)) {
+            return true;
+        }
+        auto baked = m_static_shapes.find(entity);
+        const size_t piece_count = baked != m_static_shapes.end()
+                ? baked->second.size()
+                : getComponent<Collider>(entity).model_shape().size();
+        return std::get<size_t>(proxy) >= piece_count;
+    });
+    // tilemaps are in no tree, their rects are always up to date
+    m_appendTilemapProxies(area, mask, result);
+    auto key = [](const CollidingPoly& proxy) {
+        return std::make_pair(std::get<Entity>(proxy), std::get<size_t>(proxy));
+    };
+    std::sort(result.begin(), result.end(), [&](const CollidingPoly& a, const CollidingPoly& b) {
+        return key(a) < key(b);
+    });
+    auto duplicates = std::unique(result.begin(), result.end(), [&](const CollidingPoly& a, const CollidingPoly& b) {
+        return key(a) == key(b);
+    });
+    result.erase(duplicates, result.end());
+}
+void PhysicsSystem::m_appendTilemapProxies(
+        const AABB& area, LayerMask mask, std::vector<CollidingPoly>& result
+) const {
+    if(m_tilemaps == nullptr) {
+        return;
+    }
+    m_tilemaps->forEachPieceIn(area, [&](Entity tilemap, size_t piece, const AABB& aabb) {
+        if(!entities.contains(tilemap)) {
+            return;
+        }
+        const auto filter = m_proxyFilter(getComponent<Collider>(tilemap), getComponent<Rigidbody>(tilemap));
+        if(mask.test(filter.layer)) {
+            result.push_back({tilemap, piece, aabb, filter});
+        }
+    });
+}
+static AABB segmentBounds(vec2f origin, vec2f direction) {
+    AABB result = AABB::Expandable();
+    result.expandToContain(origin);
+    result.expandToContain(origin + direction);
+    return result;
+}
+std::optional<PhysicsSystem::RaycastHit> PhysicsSystem::m_raycastProxy(
+        const CollidingPoly& proxy, vec2f origin, vec2f direction
+) const {
+    static thread_local ConvexPiece storage;
+    const auto entity = std::get<Entity>(proxy);
+    const auto index = std::get<size_t>(proxy);
+    const auto& col = getComponent<Collider>(entity);
+    const auto& trans = getComponent<Transform>(entity);
+    const WorldPiece piece{
+            m_worldConvex(entity, index, storage), col.isRound() ? col.transformed_radius(trans) : 0.f};
+    const auto intersection = intersectRayPiece(origin, direction, piece, col.type());
+    if(!intersection.detected) {
+        return std::nullopt;
+    }
+    return RaycastHit{
+            entity, index, intersection.contact_point, intersection.contact_normal, intersection.time_hit};
+}
+std::optional<PhysicsSystem::RaycastHit> PhysicsSystem::raycast(
+        vec2f origin, vec2f direction, LayerMask mask
+) const {
+    static thread_local std::vector<CollidingPoly> candidates;
+    static thread_local std::vector<std::pair<float, size_t>> entry_order;
+    m_queryProxies([&](const QuadTree_t& tree, std::vector<CollidingPoly>& found) {
+        tree.queryRay(origin, direction, found);
+    }, segmentBounds(origin, direction), mask, candidates);
+    // proxies are tried nearest first, none entered after the closest hit can beat it
+    entry_order.clear();
+    for(size_t i = 0; i < candidates.size(); i++) {
+        entry_order.push_back({segmentEntryTimeAABB(origin, direction, std::get<AABB>(candidates[i])), i});
+    }
+    std::sort(entry_order.begin(), entry_order.end());
+    std::optional<RaycastHit> closest;
+    for(const auto& [entry_time, i] : entry_order) {
+        if(closest.has_value() && entry_time > closest->time) {
+            break;
+        }
+        auto hit = m_raycastProxy(candidates[i], origin, direction);
+        if(hit.has_value() && (!closest.has_value() || hit->time < closest->time)) {
+            closest = hit;
+        }
+    }
+    return closest;
+}
+void PhysicsSystem::raycastAll(
+        vec2f origin, vec2f direction, std::vector<RaycastHit>& hits, LayerMask mask
+) const {
+    static thread_local std::vector<CollidingPoly> candidates;
+    m_queryProxies([&](const QuadTree_t& tree, std::vector<CollidingPoly>& found) {
+        tree.queryRay(origin, direction, found);
+    }, segmentBounds(origin, direction), mask, candidates);
+    const size_t first = hits.size();
+    for(const auto& proxy : candidates) {
+        if(auto hit = m_raycastProxy(proxy, origin, direction)) {
+            hits.push_back(*hit);
+        }
+    }
+    std::sort(hits.begin() + first, hits.end(), [](const RaycastHit& a, const RaycastHit& b) {
+        return a.time < b.time;
+    });
+}
+void PhysicsSystem::raycastBatch(
+        std::span<const Ray> rays, std::span<std::optional<RaycastHit>> hits, LayerMask mask
+) const {
+    assert(hits.size() >= rays.size());
+    static thread_local ConvexPiece storage;
+    static thread_local std::vector<CollidingPoly> tilemap_proxies;
+    constexpr size_t width = RayPacket::WIDTH;
+    for(size_t first = 0; first < rays.size(); first += width) {
+        // lanes past the last ray are disabled with negative max_time
+        RayPacket packet;
+        AABB packet_bounds = AABB::Expandable();
+        for(size_t lane = 0; lane < width; lane++) {
+            const bool isUsed = first + lane < rays.size();
+            const Ray ray = isUsed ? rays[first + lane] : Ray::CreatePositionDirection({}, {});
+            packet.origin_x[lane] = ray.pos.x;
+            packet.origin_y[lane] = ray.pos.y;
+            packet.dir_x[lane] = ray.dir.x;
+            packet.dir_y[lane] = ray.dir.y;
+            packet.max_time[lane] = isUsed ? 1.f : -1.f;
+            if(isUsed) {
+                hits[first + lane].reset();
+                packet_bounds.expandToContain(ray.pos);
+                packet_bounds.expandToContain(ray.pos + ray.dir);
+            }
+        }
+        // every hit shortens its lane so that further boxes are culled by it
+        auto record = [&](size_t lane, Entity entity, size_t index, float time, vec2f normal) {
+            if(time >= packet.max_time[lane]) {
+                return;
+            }
+            packet.max_time[lane] = time;
+            const vec2f point = vec2f(packet.origin_x[lane], packet.origin_y[lane]) +
+                                vec2f(packet.dir_x[lane], packet.dir_y[lane]) * time;
+            hits[first + lane] = RaycastHit{entity, index, point, normal, time};
+        };
+        auto overlaps = [&](const AABB& box) {
+            return segmentPacketEntryMaskAABB(packet, box) != 0;
+        };
+        auto visit = [&](const CollidingPoly& proxy) {
+            const auto entity = std::get<Entity>(proxy);
+            if(!mask.test(std::get<ProxyFilter>(proxy).layer) || !entities.contains(entity)) {
+                return;
+            }
+            const uint32_t lanes = segmentPacketEntryMaskAABB(packet, std::get<AABB>(proxy));
+            if(lanes == 0) {
+                return;
+            }
+            const auto index = std::get<size_t>(proxy);
+            const auto& col = getComponent<Collider>(entity);
+            const auto& piece = m_worldConvex(entity, index, storage);
+            if(!col.isRound()) {
+                float times[width];
+                vec2f normals[width];
+                const uint32_t hit_lanes = intersectRayPacketConvex(packet, piece, times, normals);
+                for(size_t lane = 0; lane < width; lane++) {
+                    if((hit_lanes >> lane) & 1U) {
+                        record(lane, entity, index, times[lane], normals[lane]);
+                    }
+                }
+                return;
+            }
+            // round pieces are rare enough to be tested one lane at a time
+            const WorldPiece round{piece, col.transformed_radius(getComponent<Transform>(entity))};
+            for(size_t lane = 0; lane < width; lane++) {
+                if(((lanes >> lane) & 1U) == 0) {
+                    continue;
+                }
+                const auto intersection = intersectRayPiece(
+                        vec2f(packet.origin_x[lane], packet.origin_y[lane]),
+                        vec2f(packet.dir_x[lane], packet.dir_y[lane]),
+                        round,
+                        col.type()
+                );
+                if(intersection.detected) {
+                    record(lane, entity, index, intersection.time_hit, intersection.contact_normal);
+                }
+            }
+        };
+        for(const auto* tree : {m_quad_tree.get(), m_sleeping_tree.get(), m_static_tree.get()}) {
+            if(tree != nullptr) {
+                tree->traverse(overlaps, visit);
+            }
+        }
+        tilemap_proxies.clear();
+        m_appendTilemapProxies(packet_bounds, mask, tilemap_proxies);
+        for(const auto& proxy : tilemap_proxies) {
+            visit(proxy);
+        }
+    }
+}
+void PhysicsSystem::overlapPoint(vec2f point, std::vector<Entity>& result, LayerMask mask) const {
+    static thread_local std::vector<CollidingPoly> candidates;
+    m_queryProxies([&](const QuadTree_t& tree, std::vector<CollidingPoly>& found) {
+        tree.queryRay(point, vec2f(0.f, 0.f), found);
+    }, AABB::CreateMinMax(point, point), mask, candidates);
+    // candidates are sorted by entity so each one is appended once
+    Entity last = -1;
+    for(const auto& proxy : candidates) {
+        const auto entity = std::get<Entity>(proxy);
+        // segment of zero length only hits shapes containing its origin
+        if(entity == last || !m_raycastProxy(proxy, point, vec2f(0.f, 0.f)).has_value()) {
+            continue;
+        }
+        result.push_back(entity);
+        last = entity;
+    }
+}
+void PhysicsSystem::overlapAABB(const AABB& box, std::vector<Entity>& result, LayerMask mask) const {
+    static thread_local std::vector<CollidingPoly> candidates;
+    static thread_local ConvexPiece storage;
+    m_queryProxies([&](const QuadTree_t& tree, std::vector<CollidingPoly>& found) {
+        tree.query(box, found);
+    }, box, mask, candidates);
+    const ConvexPiece box_piece({box.min, vec2f(box.max.x, box.min.y), box.max, vec2f(box.min.x, box.max.y)});
+    const WorldPiece box_world{box_piece, 0.f};
+    Entity last = -1;
+    for(const auto& proxy : candidates) {
+        const auto entity = std::get<Entity>(proxy);
+        if(entity == last) {
+            continue;
+        }
+        const auto& col = getComponent<Collider>(entity);
+        const auto& trans = getComponent<Transform>(entity);
+        const WorldPiece piece{
+                m_worldConvex(entity, std::get<size_t>(proxy), storage),
+                col.isRound() ? col.transformed_radius(trans) : 0.f};
+        uint32_t separating_axis = 0;
+        const auto collide = COLLIDE_DISPATCH[static_cast<size_t>(col.type())]
+                                             [static_cast<size_t>(eShapeType::Polygon)];
+        if(collide(piece, box_world, separating_axis).detected) {
+            result.push_back(entity);
+            last = entity;
+        }
+    }
+}
+void PhysicsSystem::overlapProxies(const AABB& box, std::vector<CollidingPoly>& result, LayerMask mask) const {
+    static thread_local std::vector<CollidingPoly> candidates;
+    m_queryProxies([&](const QuadTree_t& tree, std::vector<CollidingPoly>& found) {
+        tree.query(box, found);
+    }, box, mask, candidates);
+    result.insert(result.end(), candidates.begin(), candidates.end());
+}
+std::optional<PhysicsSystem::RaycastHit> PhysicsSystem::shapeCast(
+        const Collider& shape, const Transform& transform, vec2f motion, LayerMask mask
+) const {
+    static thread_local std::vector<CollidingPoly> candidates;
+    static thread_local ConvexPiece moving;
+    static thread_local ConvexPiece storage;
+    // transform does not have to belong to an entity, its global matrix is refreshed here
+    Transform start = transform;
+    start.syncWithChange();
+    const float radius = shape.isRound() ? shape.transformed_radius(start) : 0.f;
+    std::optional<RaycastHit> closest;
+    for(size_t i = 0; i < shape.model_shape().size(); i++) {
+        shape.transformed_piece(start, i, moving);
+        auto swept = m_proxyAABB(shape, start, moving.vertices);
+        swept.expandToContain(swept.min + motion);
+        swept.expandToContain(swept.max + motion);
+        m_queryProxies([&](const QuadTree_t& tree, std::vector<CollidingPoly>& found) {
+            tree.query(swept, found);
+        }, swept, mask, candidates);
+        const WorldPiece moving_piece{moving, radius};
+        for(const auto& proxy : candidates) {
+            const auto entity = std::get<Entity>(proxy);
+            const auto index = std::get<size_t>(proxy);
+            const auto& col = getComponent<Collider>(entity);
+            const auto& trans = getComponent<Transform>(entity);
+            const WorldPiece target{
+                    m_worldConvex(entity, index, storage), col.isRound() ? col.transformed_radius(trans) : 0.f};
+            const auto collide = COLLIDE_DISPATCH[static_cast<size_t>(shape.type())]
+                                                 [static_cast<size_t>(col.type())];
+            ContactManifold contact;
+            const float time = sweepTime(collide, moving_piece, motion, target, contact);
+            if(time == INFINITY || (closest.has_value() && time >= closest->time)) {
+                continue;
+            }
+            // contact normal points from target towards the moving piece
+            closest = RaycastHit{entity, index, contact.cp2, contact.contact_normal, time};
+        }
+    }
+    return closest;
+}
+void PhysicsSystem::carve(
+        const std::vector<vec2f>& cutter, std::vector<Entity>& fragments, LayerMask mask
+) {
+    const auto cutter_aabb = AABB::CreateFromVerticies(cutter);
+    // fragments become entities of this system, candidates are gathered first
+    m_carved.clear();
     for(auto e : entities) {
         const auto& col = getComponent<Collider>(e);
-        const auto& trans= getComponent<Transform>(e);
-        auto shape = col.transformed_shape(trans);
-        for(int i = 0; i < shape.size(); i++) {
-            auto aabb = AABB::CreateFromVerticies(shape[i]);
-            aabb.setSize(aabb.size() * 1.5f);
-            m_quad_tree->add({e, i, aabb});
+        if(col.isRound() || col.model_shape().empty() || !mask.test(col.collider_layer)) {
+            continue;
+        }
+        const auto& trans = getComponent<Transform>(e);
+        if(isOverlappingAABBAABB(cutter_aabb, AABB::TransformedAABB(trans.global(), col.extent()))) {
+            m_carved.push_back(e);
         }
     }
-    m_quad_tree->updateLeafes();
+    for(auto e : m_carved) {
+        m_carveEntity(e, cutter, fragments);
+    }
 }
-std::vector<CollidingPair> PhysicsSystem::m_broadPhase(const ColliderSystem& collider_system, const TransformSystem& transform_system) {
-    // m_updateQuadTree();
-    auto all_pairs = m_quad_tree->findAllIntersections();
-    m_filterPotentialCollisions(all_pairs, collider_system);
-    // std::vector<CollidingPoly> objs;
-    // for(auto e : entities) {
-    //     const auto& collider = collider_system.getComponent<Collider>(e);
-    //     const auto& transform = transform_system.getComponent<Transform>(e);
-    //     auto shape = collider.transformed_shape(transform);
-    //     for(int i = 0; i < shape.size(); i++) {
-    //         objs.push_back({e, i, AABB::CreateFromVerticies(shape[i])});
-    //     }
-    // }
-    // auto all_pairs = sweepBroadPhase<CollidingPoly>(objs.begin(), objs.end(), [](const CollidingPoly& poly)->AABB {
-    //     return std::get<AABB>(poly);
-    // });
-    return all_pairs;
-}
-std::vector<PhysicsSystem::PenetrationConstraint> PhysicsSystem::m_narrowPhase(
-        ColliderSystem& col_sys,
+void PhysicsSystem::m_carveEntity(
+        Entity entity, const std::vector<vec2f>& cutter, std::vector<Entity>& fragments
+) {
+    auto& col = getComponent<Collider>(entity);
+    auto& rb = getComponent<Rigidbody>(entity);
+    const auto& mat = getComponent<Transform>(entity).global();
+    // cutter is brought into model space so that pieces stay untransformed
+    const vec2f origin = transformPoint(mat, vec2f(0.f, 0.f));
+    const vec2f axis_x = transformPoint(mat, vec2f(1.f, 0.f)) - origin;
+    const vec2f axis_y = transformPoint(mat, vec2f(0.f, 1.f)) - origin;
+    const float det = perp_dot(axis_x, axis_y);
+    if(det == 0.f) {
+        return;
+    }
+    auto& model_cutter = m_carve_cutter;
+    model_cutter.clear();
+    for(auto p : cutter) {
+        const vec2f offset = p - origin;
+        model_cutter.push_back(vec2f(perp_dot(offset, axis_y), perp_dot(axis_x, offset)) / det);
+    }
+    m_carve_kept.clear();
+    m_carve_cut.clear();
+    bool isChanged = false;
+    for(const auto& piece : col.model_shape()) {
+        if(subtractConvex(piece, model_cutter, m_carve_cut)) {
+            isChanged = true;
+        }else {
+            m_carve_kept.push_back(piece);
+        }
+    }
+    if(!isChanged) {
+        return;
+    }
+    // only what was cut is decomposed again
+    mergeConvexNeighbours(m_carve_cut);
+    m_carve_kept.insert(m_carve_kept.end(), m_carve_cut.begin(), m_carve_cut.end());
+
+    if(rb.isStatic) {
+        m_isStaticWorldDirty = true;
+        // bodies resting on static ones are not in their islands
+        const auto cutter_aabb = AABB::CreateFromVerticies(cutter);
+        for(auto e : m_sleeping_bodies) {
+            if(!entities.contains(e)) {
+                continue;
+            }
+            const auto& sleeping_col = getComponent<Collider>(e);
+            const auto& sleeping_mat = getComponent<Transform>(e).global();
+            if(isOverlappingAABBAABB(cutter_aabb, AABB::TransformedAABB(sleeping_mat, sleeping_col.extent()))) {
+                getComponent<Rigidbody>(e).time_resting = 0.f;
+            }
+        }
+    }else {
+        // woken up as if from outside by the next update
+        rb.time_resting = 0.f;
+    }
+    if(m_carve_kept.empty()) {
+        ECS().destroyEntity(entity);
+        return;
+    }
+
+    // pieces sharing a part of an edge stay together
+    auto& group = m_carve_group;
+    group.resize(m_carve_kept.size());
+    std::iota(group.begin(), group.end(), 0U);
+    auto find = [&](size_t i) {
+        while(group[i] != i) {
+            group[i] = group[group[i]];
+            i = group[i];
+        }
+        return i;
+    };
+    auto& bounds = m_carve_bounds;
+    bounds.clear();
+    m_carve_sweep.clear();
+    for(const auto& piece : m_carve_kept) {
+        bounds.push_back(AABB::CreateFromVerticies(piece));
+        m_carve_sweep.emplace_back(bounds.back().min.x, m_carve_sweep.size());
+    }
+    std::sort(m_carve_sweep.begin(), m_carve_sweep.end());
+    for(size_t a = 0; a < m_carve_sweep.size(); a++) {
+        const size_t i = m_carve_sweep[a].second;
+        for(size_t b = a + 1; b < m_carve_sweep.size() && m_carve_sweep[b].first <= bounds[i].max.x; b++) {
+            const size_t j = m_carve_sweep[b].second;
+            if(find(i) != find(j) && isOverlappingAABBAABB(bounds[i], bounds[j]) &&
+               areConvexNeighbours(m_carve_kept[i], m_carve_kept[j])) {
+                group[find(j)] = find(i);
+            }
+        }
+    }
+    auto& part_of_group = m_carve_part_of_group;
+    part_of_group.assign(m_carve_kept.size(), SIZE_MAX);
+    size_t part_count = 0;
+    for(size_t i = 0; i < m_carve_kept.size(); i++) {
+        auto& part = part_of_group[find(i)];
+        if(part == SIZE_MAX) {
+            part = part_count++;
+            if(part == m_carve_parts.size()) {
+                m_carve_parts.emplace_back();
+            }
+            m_carve_parts[part].clear();
+        }
+        m_carve_parts[part].push_back(std::move(m_carve_kept[i]));
+    }
+    auto& shapes = m_carve_shapes;
+    shapes.clear();
+    size_t biggest = 0;
+    for(size_t part = 0; part < part_count; part++) {
+        shapes.push_back(ColliderShape::CreateFromPieces(std::move(m_carve_parts[part])));
+        if(shapes.back()->mass_properties.area > shapes[biggest]->mass_properties.area) {
+            biggest = shapes.size() - 1;
+        }
+    }
+    // manual mass and inertia are split in proportion to what each part
+    // had of the whole body before the carve, what was cut away is lost
+    const auto old_mass_properties = col.mass_properties();
+    auto scaleManualMass = [&](Rigidbody& part_rb, const ColliderShape& part) {
+        if(part_rb.useAutomaticMass) {
+            return;
+        }
+        part_rb.real_mass *= part.mass_properties.area / old_mass_properties.area;
+        part_rb.real_inertia *= part.mass_properties.MMOI / old_mass_properties.MMOI;
+    };
+    for(size_t i = 0; i < shapes.size(); i++) {
+        if(i == biggest) {
+            continue;
+        }
+        const auto fragment = m_createFragment(entity, *shapes[i]);
+        scaleManualMass(*ECS().getComponent<Rigidbody>(fragment), *shapes[i]);
+        fragments.push_back(fragment);
+    }
+    // components may have moved while fragments were added
+    auto& carved_col = *ECS().getComponent<Collider>(entity);
+    auto& carved_rb = *ECS().getComponent<Rigidbody>(entity);
+    auto& carved_trans = *ECS().getComponent<Transform>(entity);
+    auto kept = shapes[biggest];
+    // dynamic bodies turn around their origin, it follows the centroid of what is left
+    const vec2f offset = kept->mass_properties.centroid - old_mass_properties.centroid;
+    if(!carved_rb.isStatic && offset != vec2f(0.f, 0.f)) {
+        kept = translatedShape(*kept, -offset);
+        const vec2f world_origin = transformPoint(carved_trans.global(), vec2f(0.f, 0.f));
+        const vec2f world_offset = transformPoint(carved_trans.global(), offset) - world_origin;
+        carved_rb.velocity = m_calcContactVel(carved_rb.velocity, carved_rb.angular_velocity, world_offset);
+        carved_trans.setPositionNow(transformPoint(carved_trans.local(), offset));
+    }
+    carved_col.setShape(std::move(kept));
+    carved_rb.invalidateMass();
+    scaleManualMass(carved_rb, *shapes[biggest]);
+    // shapes no longer used by any collider are released
+    shapes.clear();
+}
+Entity PhysicsSystem::m_createFragment(Entity entity, const ColliderShape& shape) {
+    const vec2f centroid = shape.mass_properties.centroid;
+    // copies are taken before adding components can move the originals
+    const Transform trans = getComponent<Transform>(entity);
+    const Rigidbody rb = getComponent<Rigidbody>(entity);
+    const Material material = getComponent<Material>(entity);
+    const Layer layer = getComponent<Collider>(entity).collider_layer;
+
+    Rigidbody fragment_rb(rb.isStatic, rb.isRotationLocked, rb.useAutomaticMass, rb.density());
+    fragment_rb.real_mass = rb.real_mass;
+    fragment_rb.real_inertia = rb.real_inertia;
+    fragment_rb.useContinuousCollision = rb.useContinuousCollision;
+    // keeps moving with the velocity its piece had as a part of the whole body
+    const vec2f world_centroid = transformPoint(trans.global(), centroid);
+    fragment_rb.velocity = m_calcContactVel(
+            rb.velocity, rb.angular_velocity, world_centroid - transformPoint(trans.global(), vec2f(0.f, 0.f))
+    );
+    fragment_rb.angular_velocity = rb.angular_velocity;
+
+    // origin of a new body is its centroid
+    Collider fragment_col(translatedShape(shape, -centroid));
+    fragment_col.collider_layer = layer;
+
+    auto fragment = ECS().createEntity();
+    ECS().addComponent(fragment, Transform(
+            trans.parent(), transformPoint(trans.local(), centroid), trans.rotation, trans.scale
+    ));
+    ECS().addComponent(fragment, fragment_col);
+    ECS().addComponent(fragment, fragment_rb);
+    ECS().addComponent(fragment, material);
+    return fragment;
+}
+bool PhysicsSystem::m_isWakeRequested(const Rigidbody& rb) const {
+    return rb.force != vec2f(0.f, 0.f) || rb.torque != 0.f ||
+           length(rb.velocity) > SLOW_VEL;
+}
+void PhysicsSystem::m_updateBodySets() {
+    m_static_bodies.clear();
+    m_awake_bodies.clear();
+    m_sleeping_bodies.clear();
+    std::vector<Entity> to_wake;
+    for(auto e : entities) {
+        auto& rb = getComponent<Rigidbody>(e);
+        const bool wasSleeping = m_is_sleeping.test(e);
+        if(rb.isStatic != m_is_baked_static.test(e)) {
+            m_is_baked_static.set(e, rb.isStatic);
+            m_isStaticWorldDirty = true;
+        }
+        if(rb.isStatic || !m_isDormant(rb)) {
+            if(wasSleeping) {
+                // woken up from outside of the physics system
+                m_is_sleeping.reset(e);
+                m_isSleepingTreeDirty = true;
+                getComponent<Collider>(e).isNonMoving = false;
+                to_wake.push_back(e);
+            }
+            if(!rb.isStatic) {
+                // bodies added since the last tick are not filtered out as dormant
+                getComponent<Collider>(e).isNonMoving = false;
+            } else {
+                // static bodies are never integrated, so nothing else consumes it
+                rb.force = {0, 0};
+                rb.torque = 0.f;
+            }
+            (rb.isStatic ? m_static_bodies : m_awake_bodies).push_back(e);
+            continue;
+        }
+        if(!wasSleeping) {
+            m_is_sleeping.set(e);
+            m_isSleepingTreeDirty = true;
+        }
+        m_sleeping_bodies.push_back(e);
+        if(m_isWakeRequested(rb)) {
+            to_wake.push_back(e);
+        }
+    }
+    for(auto e : to_wake) {
+        m_wakeIsland(e);
+    }
+    std::erase_if(m_sleeping_bodies, [&](Entity e) { return !m_is_sleeping.test(e); });
+}
+void PhysicsSystem::m_wakeIsland(Entity entity) {
+    m_contact_islands.forEachInIsland(entity, [&](int member) {
+        const auto e = static_cast<Entity>(member);
+        if(!m_is_sleeping.test(e)) {
+            return;
+        }
+        m_is_sleeping.reset(e);
+        m_isSleepingTreeDirty = true;
+        getComponent<Rigidbody>(e).time_resting = 0.f;
+        getComponent<Collider>(e).isNonMoving = false;
+        m_awake_bodies.push_back(e);
+    });
+}
+void PhysicsSystem::m_updateSleepingTree() {
+    if(!m_isSleepingTreeDirty) {
+        return;
+    }
+    m_isSleepingTreeDirty = false;
+    m_sleeping_tree.reset();
+    if(m_sleeping_bodies.empty()) {
+        return;
+    }
+    std::vector<CollidingPoly> proxies;
+    for(auto e : m_sleeping_bodies) {
+        m_appendProxies(e, proxies);
+    }
+    AABB bounds = AABB::Expandable();
+    for(const auto& proxy : proxies) {
+        bounds.expandToContain(std::get<AABB>(proxy).min);
+        bounds.expandToContain(std::get<AABB>(proxy).max);
+    }
+    bounds.setSize(bounds.size() * 2.f);
+    m_sleeping_tree = std::unique_ptr<QuadTree_t>(new QuadTree_t(bounds, m_aabb_extracter));
+    for(const auto& proxy : proxies) {
+        m_sleeping_tree->add(proxy);
+    }
+    m_sleeping_tree->updateLeafes();
+}
+void PhysicsSystem::m_wakeTouchedIslands(float delT) {
+    m_awake_proxies.clear();
+    m_is_fast.reset();
+    for(auto e : m_awake_bodies) {
+        m_appendProxies(e, m_awake_proxies, delT);
+    }
+    if(m_sleeping_tree == nullptr) {
+        return;
+    }
+    // woken bodies are appended to awake ones so they can wake others too
+    size_t proxied_count = m_awake_bodies.size();
+    for(size_t i = 0; i < m_awake_proxies.size(); i++) {
+        const auto proxy = m_awake_proxies[i];
+        m_query_result.clear();
+        m_sleeping_tree->query(std::get<AABB>(proxy), m_query_result);
+        for(const auto& other : m_query_result) {
+            const auto other_entity = std::get<Entity>(other);
+            if(!m_is_sleeping.test(other_entity) ||
+               !m_isCollisionAllowed(proxy, other)) {
+                continue;
+            }
+            m_wakeIsland(other_entity);
+        }
+        for(; proxied_count < m_awake_bodies.size(); proxied_count++) {
+            m_appendProxies(m_awake_bodies[proxied_count], m_awake_proxies, delT);
+        }
+    }
+    std::erase_if(m_sleeping_bodies, [&](Entity e) { return !m_is_sleeping.test(e); });
+}
+const std::vector<CollidingPair>& PhysicsSystem::m_broadPhase() {
+    m_pairs.clear();
+    m_quad_tree->findAllIntersections(m_pairs, m_isCollisionAllowed);
+    if(m_static_tree != nullptr) {
+        for(const auto& proxy : m_awake_proxies) {
+            m_query_result.clear();
+            m_static_tree->query(std::get<AABB>(proxy), m_query_result);
+            for(const auto& static_proxy : m_query_result) {
+                if(m_isCollisionAllowed(proxy, static_proxy)) {
+                    m_pairs.push_back({proxy, static_proxy});
+                }
+            }
+        }
+    }
+    if(m_tilemaps != nullptr) {
+        for(const auto& proxy : m_awake_proxies) {
+            m_tilemaps->forEachPieceIn(std::get<AABB>(proxy), [&](Entity tilemap, size_t piece, const AABB& aabb) {
+                const CollidingPoly tile{
+                        tilemap, piece, aabb,
+                        m_proxyFilter(getComponent<Collider>(tilemap), getComponent<Rigidbody>(tilemap))};
+                if(m_isCollisionAllowed(proxy, tile)) {
+                    m_pairs.push_back({proxy, tile});
+                }
+            });
+        }
+    }
+    // pieces of the same two entities end up next to each other,
+    // order no longer depends on tree layout
+    for(auto& pair : m_pairs) {
+        if(std::get<Entity>(pair.first) > std::get<Entity>(pair.second)) {
+            std::swap(pair.first, pair.second);
+        }
+    }
+    std::sort(m_pairs.begin(), m_pairs.end(), [&](const CollidingPair& a, const CollidingPair& b) {
+        return m_pairKey(a) < m_pairKey(b);
+    });
+    auto duplicates = std::unique(m_pairs.begin(), m_pairs.end(), [&](const CollidingPair& a, const CollidingPair& b) {
+        return m_pairKey(a) == m_pairKey(b);
+    });
+    m_pairs.erase(duplicates, m_pairs.end());
+    return m_pairs;
+}
+void PhysicsSystem::m_updateManifoldCache() {
+    // both key lists are sorted so persisting pairs are found with one merge
+    m_previous_manifolds.swap(m_manifolds);
+    m_manifolds.assign(m_pairs.size(), CachedManifold{});
+    size_t previous = 0;
+    for (size_t i = 0; i < m_pairs.size(); i++) {
+        const auto key = m_pairKey(m_pairs[i]);
+        while (previous < m_manifold_keys.size() && m_manifold_keys[previous] < key) {
+            previous++;
+        }
+        if (previous < m_manifold_keys.size() && m_manifold_keys[previous] == key) {
+            m_manifolds[i] = m_previous_manifolds[previous];
+        }
+    }
+    m_manifold_keys.clear();
+    for (const auto& pair : m_pairs) {
+        m_manifold_keys.push_back(m_pairKey(pair));
+    }
+}
+void PhysicsSystem::m_narrowPhase(
         const std::vector<CollidingPair>& pairs,
+        std::vector<PenetrationConstraint>& result,
         float delT
 ) {
-    std::vector<PenetrationConstraint> result;
-    for (const auto pair : pairs) {
-        auto e1 = std::get<Entity>(pair.first);
-        auto e2 = std::get<Entity>(pair.second);
-        auto s1i = std::get<size_t>(pair.first);
-        auto s2i = std::get<size_t>(pair.second);
-        auto res = m_handleCollision(e1, s1i, e2, s2i, delT);
+    result.clear();
+    for (const auto& pair : pairs) {
+        auto res = m_handleCollision(pair, delT);
         if (!res.detected) {
             continue;
         }
-        col_sys.notifyOfCollision(e1, e2, res.info);
+        result.push_back(res);
+    }
+}
+// pairs of one color never share a dynamic body so they can be handled at once,
+// results are compacted afterwards keeping the color order
+void PhysicsSystem::m_narrowPhaseColored(Island& island, float delT) {
+    island.penetrations.resize(island.pairs.size());
+    m_forEachColor(island.pair_batches, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            island.penetrations[i] = m_handleCollision(island.pairs[i], delT);
+        }
+    });
+    auto& batches = island.penetration_batches;
+    batches.resize(island.pair_batches.size());
+    size_t detected_count = 0;
+    for (size_t c = 0; c + 1 < island.pair_batches.size(); c++) {
+        batches[c] = detected_count;
+        for (size_t i = island.pair_batches[c]; i < island.pair_batches[c + 1]; i++) {
+            if (island.penetrations[i].detected) {
+                island.penetrations[detected_count++] = island.penetrations[i];
+            }
+        }
+    }
+    batches.back() = detected_count;
+    island.penetrations.resize(detected_count);
+}
+PhysicsSystem::PenetrationConstraint PhysicsSystem::m_handleCollision(
+        const CollidingPair& pair, float delT
+) {
+    auto e1 = std::get<Entity>(pair.first);
+    auto e2 = std::get<Entity>(pair.second);
+    auto s1i = std::get<size_t>(pair.first);
+    auto s2i = std::get<size_t>(pair.second);
+    // pairs of islands come from m_pairs so their slot can be found
+    // without writing to any shared state
+    auto slot = std::lower_bound(
+            m_pairs.begin(), m_pairs.end(), m_pairKey(pair),
+            [](const CollidingPair& a, const PairKey& key) {
+                return m_pairKey(a) < key;
+            }
+    );
+    assert(slot != m_pairs.end() && m_pairKey(*slot) == m_pairKey(pair));
+    auto& manifold = m_manifolds[slot - m_pairs.begin()];
+    return m_handleCollision(e1, s1i, e2, s2i, manifold, delT);
+}
+void PhysicsSystem::m_mergeIslandResults(ColliderSystem& col_sys, size_t substep) {
+    for (size_t i = 0; i < m_island_count; i++) {
+        if (!m_islands[i].isSteppedAt(substep)) {
+            continue;
+        }
+        for (const auto& res : m_islands[i].penetrations) {
+            auto e1 = res.info.collider_entity;
+            auto e2 = res.info.collidee_entity;
+            col_sys.notifyOfCollision(e1, e2, res.info);
 
-        if(!res.isStatic1 && !res.isStatic2) {
-            m_have_collided.set(e1);
-            m_have_collided.set(e2);
-            m_collision_islands.merge(e1, e2);
+            if(!res.isStatic1 && !res.isStatic2) {
+                m_touching.push_back(std::minmax(e1, e2));
+            }
         }
-        result.push_back(res);
     }
-    return result;
+}
+void PhysicsSystem::m_buildSolverIslands(
+        const std::vector<CollidingPair>& pairs, ConstraintSystem& const_sys, float delT
+) {
+    auto isDynamic = [&](Entity e) {
+        const auto rb = ECS().getComponent<Rigidbody>(e);
+        return rb != nullptr && !rb->isStatic;
+    };
+    m_solver_islands.reset();
+    for (const auto& pair : pairs) {
+        auto e1 = std::get<Entity>(pair.first);
+        auto e2 = std::get<Entity>(pair.second);
+        if (isDynamic(e1) && isDynamic(e2)) {
+            m_solver_islands.merge(e1, e2);
+        }
+    }
+    // anchors are never moved by constraints so they do not join islands
+    const auto solver_constraints = const_sys.solverConstraints();
+    for (const auto& constraint : solver_constraints) {
+        if (!constraint.isAnchored()) {
+            m_solver_islands.merge(constraint.bodies[0], constraint.bodies[1]);
+        }
+    }
+
+    for (size_t i = 0; i < m_island_count; i++) {
+        auto& island = m_islands[i];
+        m_island_of_head[island.head] = -1;
+        island.bodies.clear();
+        island.constraints.clear();
+        island.pairs.clear();
+        island.penetrations.clear();
+        island.constraint_batches.clear();
+        island.pair_batches.clear();
+        island.penetration_batches.clear();
+    }
+    m_island_count = 0;
+    auto islandOf = [&](Entity entity) -> Island& {
+        auto head = m_solver_islands.group(entity);
+        if (m_island_of_head[head] == -1) {
+            m_island_of_head[head] = m_island_count++;
+            if (m_islands.size() < m_island_count) {
+                m_islands.emplace_back();
+            }
+            m_islands[m_island_of_head[head]].head = head;
+        }
+        return m_islands[m_island_of_head[head]];
+    };
+    for (const auto& pair : pairs) {
+        auto e1 = std::get<Entity>(pair.first);
+        auto e2 = std::get<Entity>(pair.second);
+        auto& island = islandOf(isDynamic(e1) ? e1 : e2);
+        island.pairs.push_back(pair);
+        for (auto e : {e1, e2}) {
+            if (!std::get<ProxyFilter>(e == e1 ? pair.first : pair.second).isStatic) {
+                island.bodies.push_back(e);
+            }
+        }
+    }
+    for (uint32_t slot = 0; slot < solver_constraints.size(); slot++) {
+        const auto& constraint = solver_constraints[slot];
+        auto& island = islandOf(constraint.bodies[1]);
+        island.constraints.push_back(slot);
+        for (size_t i = 0; i < constraint.bodies.size(); i++) {
+            const auto* rb = constraint.rigidbodies[i];
+            if (rb != nullptr && !rb->isStatic) {
+                island.bodies.push_back(constraint.bodies[i]);
+            }
+        }
+    }
+
+    // bodies outside of islands touch nothing and get the fewest substeps
+    const size_t isolated_stride =
+            useAdaptiveSubstepping ? substep_count / m_substepCountFor(min_substep_count) : 1U;
+    for (auto e : m_awake_bodies) {
+        getComponent<Rigidbody>(e).substep_stride = isolated_stride;
+    }
+    m_common_substep_stride = isolated_stride;
+    for (size_t i = 0; i < m_island_count; i++) {
+        auto& island = m_islands[i];
+        std::sort(island.bodies.begin(), island.bodies.end());
+        island.bodies.erase(std::unique(island.bodies.begin(), island.bodies.end()), island.bodies.end());
+        m_chooseSubsteps(island, delT);
+        for (auto e : island.bodies) {
+            getComponent<Rigidbody>(e).substep_stride = island.substep_stride;
+        }
+        m_common_substep_stride = std::gcd(m_common_substep_stride, island.substep_stride);
+    }
+
+    const bool canColor = useParallelSolver && m_thread_pool.threadCount() > 0;
+    auto islands_end = m_islands.begin() + m_island_count;
+    auto colored_begin = std::partition(m_islands.begin(), islands_end, [&](const Island& island) {
+        return !canColor || island.work() < MIN_COLORED_ISLAND_WORK;
+    });
+    m_colored_island_begin = colored_begin - m_islands.begin();
+    for (auto itr = colored_begin; itr != islands_end; itr++) {
+        m_colorIsland(*itr, const_sys);
+    }
+}
+size_t PhysicsSystem::m_substepCountFor(size_t needed) const {
+    const size_t max_count = std::max<size_t>(substep_count, 1U);
+    for (size_t count = std::max<size_t>(needed, 1U); count < max_count; count++) {
+        if (max_count % count == 0) {
+            return count;
+        }
+    }
+    return max_count;
+}
+void PhysicsSystem::m_chooseSubsteps(Island& island, float delT) {
+    auto& stats = island.stats;
+    stats = IslandStats{};
+    stats.body_count = island.bodies.size();
+    stats.pair_count = island.pairs.size();
+    stats.constraint_count = island.constraints.size();
+
+    float min_mass = INFINITY;
+    float max_mass = 0.f;
+    for (auto e : island.bodies) {
+        const float mass = getComponent<Rigidbody>(e).mass();
+        min_mass = std::fmin(min_mass, mass);
+        max_mass = std::fmax(max_mass, mass);
+        m_stack_depth[e] = MAX_STACK_DEPTH;
+    }
+    if (!island.bodies.empty()) {
+        stats.mass_ratio = max_mass / min_mass;
+    }
+    for (const auto& pair : island.pairs) {
+        const auto& rb1 = getComponent<Rigidbody>(std::get<Entity>(pair.first));
+        const auto& rb2 = getComponent<Rigidbody>(std::get<Entity>(pair.second));
+        const vec2f vel1 = rb1.isStatic ? vec2f(0.f, 0.f) : rb1.velocity;
+        const vec2f vel2 = rb2.isStatic ? vec2f(0.f, 0.f) : rb2.velocity;
+        stats.max_relative_speed = std::fmax(stats.max_relative_speed, length(vel1 - vel2));
+    }
+    // depth spreads from static bodies one layer per pass over the pairs
+    auto depthOf = [&](const CollidingPoly& proxy) -> uint16_t {
+        return std::get<ProxyFilter>(proxy).isStatic ? 0U : m_stack_depth[std::get<Entity>(proxy)];
+    };
+    bool changed = true;
+    for (uint16_t pass = 0; changed && pass < MAX_STACK_DEPTH; pass++) {
+        changed = false;
+        for (const auto& pair : island.pairs) {
+            const uint16_t depth1 = depthOf(pair.first);
+            const uint16_t depth2 = depthOf(pair.second);
+            auto relax = [&](const CollidingPoly& proxy, uint16_t depth, uint16_t other_depth) {
+                if (std::get<ProxyFilter>(proxy).isStatic || other_depth + 1 >= depth) {
+                    return;
+                }
+                m_stack_depth[std::get<Entity>(proxy)] = other_depth + 1;
+                changed = true;
+            };
+            relax(pair.first, depth1, depth2);
+            relax(pair.second, depth2, depth1);
+        }
+    }
+    for (auto e : island.bodies) {
+        if (m_stack_depth[e] < MAX_STACK_DEPTH) {
+            stats.stack_depth = std::max<size_t>(stats.stack_depth, m_stack_depth[e]);
+        }
+    }
+
+    if (!useAdaptiveSubstepping) {
+        stats.substep_count = std::max<size_t>(substep_count, 1U);
+        island.substep_stride = 1;
+        return;
+    }
+    const float needed = std::fmax(
+            std::fmax(
+                    static_cast<float>(stats.stack_depth) / STACK_LAYERS_PER_SUBSTEP,
+                    static_cast<float>(stats.constraint_count) / CONSTRAINTS_PER_SUBSTEP
+            ),
+            std::fmax(
+                    std::log2(stats.mass_ratio) * SUBSTEPS_PER_MASS_RATIO_DOUBLING,
+                    stats.max_relative_speed * delT / MAX_SUBSTEP_TRAVEL
+            )
+    );
+    stats.substep_count = m_substepCountFor(std::max(
+            min_substep_count, static_cast<size_t>(std::ceil(std::fmin(needed, static_cast<float>(substep_count))))
+    ));
+    island.substep_stride = std::max<size_t>(substep_count, 1U) / stats.substep_count;
+}
+void PhysicsSystem::m_colorIsland(Island& island, ConstraintSystem& const_sys) {
+    // static bodies are only read so they never cause conflicts
+    auto forEachDynamic = [&](Entity entity, auto&& visit) {
+        const auto rb = ECS().getComponent<Rigidbody>(entity);
+        if (rb != nullptr && !rb->isStatic) {
+            visit(entity);
+        }
+    };
+    m_coloring.color(
+            island.pairs,
+            island.pair_batches,
+            [&](const CollidingPair& pair, auto&& visit) {
+                forEachDynamic(std::get<Entity>(pair.first), visit);
+                forEachDynamic(std::get<Entity>(pair.second), visit);
+            }
+    );
+    m_coloring.color(
+            island.constraints,
+            island.constraint_batches,
+            [&](uint32_t slot, auto&& visit) {
+                for (auto entity : const_sys.solverConstraints()[slot].bodies) {
+                    forEachDynamic(entity, visit);
+                }
+            }
+    );
+}
+// only visits islands that are not colored
+void PhysicsSystem::m_forEachIsland(const std::function<void(Island&)>& func) {
+    const size_t island_count = m_colored_island_begin;
+    if (!useParallelSolver || m_thread_pool.threadCount() == 0 ||
+        island_count < 2) {
+        for (size_t i = 0; i < island_count; i++) {
+            func(m_islands[i]);
+        }
+        return;
+    }
+    // small islands are batched together so that a task is worth scheduling,
+    // last batch is solved on the calling thread
+    size_t batch_begin = 0;
+    size_t batch_work = 0;
+    for (size_t i = 0; i < island_count; i++) {
+        batch_work += m_islands[i].work();
+        const bool isLast = i + 1 == island_count;
+        if (batch_work < MIN_ISLAND_BATCH_WORK && !isLast) {
+            continue;
+        }
+        auto solveBatch = [this, &func, begin = batch_begin, end = i + 1]() {
+            for (size_t j = begin; j < end; j++) {
+                func(m_islands[j]);
+            }
+        };
+        if (isLast) {
+            solveBatch();
+        } else {
+            m_thread_pool.addTask(solveBatch);
+        }
+        batch_begin = i + 1;
+        batch_work = 0;
+    }
+    m_thread_pool.waitForCompletion();
+}
+// colors are processed one after another, items inside of a color in parallel
+void PhysicsSystem::m_forEachColor(
+        const std::vector<size_t>& offsets,
+        const std::function<void(size_t, size_t)>& func
+) {
+    for (size_t c = 0; c + 1 < offsets.size(); c++) {
+        const size_t begin = offsets[c];
+        const size_t end = offsets[c + 1];
+        const bool isOverflow = c == decltype(m_coloring)::OVERFLOW_COLOR;
+        if (isOverflow || end - begin < MIN_COLOR_BATCH_SIZE) {
+            func(begin, end);
+            continue;
+        }
+        // has to outlive the tasks
+        auto solveRange = [&](uint32_t start, uint32_t finish) {
+            func(begin + start, begin + finish);
+        };
+        m_thread_pool.dispatch(end - begin, solveRange);
+        m_thread_pool.waitForCompletion();
+    }
+}
+void PhysicsSystem::m_solveColoredIsland(
+        Island& island, ConstraintSystem& const_sys, float delT
+) {
+    m_forEachColor(island.constraint_batches, [&](size_t begin, size_t end) {
+        const_sys.solve(
+                std::span<const uint32_t>(island.constraints).subspan(begin, end - begin),
+                delT
+        );
+    });
+    m_narrowPhaseColored(island, delT);
 }
 void PhysicsSystem::m_broadcastCollisionMessages(
         const std::vector<PenetrationConstraint>& constraints
@@ -319,7 +1738,7 @@ void PhysicsSystem::m_broadcastCollisionMessages(
 }
 // need to update colliders after
 void PhysicsSystem::m_solveVelocities(
-        std::vector<PenetrationConstraint>& constraints, float delT
+        std::span<PenetrationConstraint> constraints, float delT
 ) {
     for (auto& constraint : constraints) {
         const auto e1 = constraint.info.collider_entity;
@@ -332,154 +1751,166 @@ void PhysicsSystem::m_solveVelocities(
         auto& rb2 = getComponent<Rigidbody>(e2);
 
         const auto restitution = constraint.restitution;
+        const auto normal = constraint.info.collision_normal;
+        const auto point_count = constraint.point_count;
 
-        const auto r1model = rotateVec(constraint.info.collider_radius, trans1.rotation);
-        const auto r2model = rotateVec(constraint.info.collidee_radius, trans2.rotation);
-
-        const auto pre_solve_contact_vel1 = m_calcContactVel(
-                rb1.previous_velocity() , rb1.previous_angular_velocity(), r1model
-        );
-        const auto pre_solve_contact_vel2 = m_calcContactVel(
-                rb2.previous_velocity(), rb2.previous_angular_velocity(), r2model
-        );
-        const auto pre_solve_relative_vel =
-                pre_solve_contact_vel1 - pre_solve_contact_vel2;
-        const auto pre_solve_normal_speed =
-                dot(pre_solve_relative_vel, constraint.info.collision_normal);
-
-        const auto contact_vel1 =
-                m_calcContactVel(rb1.velocity, rb1.angular_velocity, r1model);
-        const auto contact_vel2 =
-                m_calcContactVel(rb2.velocity, rb2.angular_velocity, r2model);
-        const auto relative_vel = contact_vel1 - contact_vel2;
-        constraint.info.relative_velocity = relative_vel;
-        const auto normal_speed = dot(relative_vel, constraint.info.collision_normal);
-
-        const auto tangent_vel =
-                relative_vel - constraint.info.collision_normal * normal_speed;
-        const auto tangent_speed = length(tangent_vel);
-
-        vec2f p = {0, 0};
-        auto restitution_speed = m_calcRestitution(
-                restitution,
-                normal_speed,
-                pre_solve_normal_speed,
-                gravity,
-                delT
-        );
-        if (abs(restitution_speed) > 0.f) {
-            const auto w1 =
-                    rb1.generalizedInverseMass(r1model, constraint.info.collision_normal);
-            const auto w2 =
-                    rb2.generalizedInverseMass(r2model, constraint.info.collision_normal);
-            const auto restitution_impulse = restitution_speed / (w1 + w2);
-            p += restitution_impulse * constraint.info.collision_normal;
+        std::array<vec2f, 2> r1model;
+        std::array<vec2f, 2> r2model;
+        std::array<float, 2> restitution_speed{};
+        for (uint8_t i = 0; i < point_count; i++) {
+            const auto& point = constraint.points[i];
+            r1model[i] = rotateVec(point.radius1, trans1.rotation);
+            r2model[i] = rotateVec(point.radius2, trans2.rotation);
         }
-
-        const float sfriction = constraint.sfriction;
-        const float dfriction = constraint.dfriction;
-        // Compute dynamic friction
-        if (abs(tangent_speed) > 0.f ) {
-            const auto tangent_normal = tangent_vel / tangent_speed;
-            const auto w1 = rb1.generalizedInverseMass(r1model, tangent_normal);
-            const auto w2 = rb2.generalizedInverseMass(r2model, tangent_normal);
-            auto friction_impulse = m_calcDynamicFriction(
-                    dfriction,
-                    tangent_speed,
-                    w1 + w2,
-                    constraint.info.normal_lagrange,
+        auto relativeVelocity = [&](uint8_t i) {
+            return m_calcContactVel(rb1.velocity, rb1.angular_velocity, r1model[i]) -
+                   m_calcContactVel(rb2.velocity, rb2.angular_velocity, r2model[i]);
+        };
+        auto applyImpulse = [&](vec2f p, uint8_t i) {
+            if (!rb1.isStatic) {
+                rb1.velocity += p / rb1.mass();
+                rb1.angular_velocity += perp_dot(r1model[i], p) / rb1.inertia();
+            }
+            if (!rb2.isStatic) {
+                rb2.velocity -= p / rb2.mass();
+                rb2.angular_velocity -= perp_dot(r2model[i], p) / rb2.inertia();
+            }
+        };
+        for (uint8_t i = 0; i < point_count; i++) {
+            const auto pre_solve_relative_vel =
+                    m_calcContactVel(
+                            rb1.previous_velocity(),
+                            rb1.previous_angular_velocity(),
+                            r1model[i]
+                    ) -
+                    m_calcContactVel(
+                            rb2.previous_velocity(),
+                            rb2.previous_angular_velocity(),
+                            r2model[i]
+                    );
+            const auto pre_solve_normal_speed = dot(pre_solve_relative_vel, normal);
+            const auto normal_speed = dot(relativeVelocity(i), normal);
+            restitution_speed[i] = m_calcRestitution(
+                    restitution,
+                    normal_speed,
+                    pre_solve_normal_speed,
+                    gravity,
                     delT
             );
-            p -= tangent_normal * friction_impulse;
-        }
-        if (!rb1.isStatic) {
-            const auto delta_lin_vel = p / rb1.mass();
-            const auto delta_ang_vel = perp_dot(r1model, p) / rb1.inertia();
-            rb1.velocity += delta_lin_vel;
-            rb1.angular_velocity += delta_ang_vel;
         }
-        if (!rb2.isStatic) {
-            const auto delta_lin_vel = p / rb2.mass();
-            const auto delta_ang_vel = perp_dot(r2model, p) / rb2.inertia();
-            rb2.velocity -= delta_lin_vel;
-            rb2.angular_velocity -= delta_ang_vel;
+
+        // same reasoning as in the positional solve, impulse of one point
+        // would otherwise spin the body and show up as sliding of the other
+        bool isBlockSolved = false;
+        if (point_count == 2 && abs(restitution_speed[0]) > 0.f &&
+            abs(restitution_speed[1]) > 0.f) {
+            auto coupling = [&](int i, int j) {
+                return 1.f / rb1.mass() +
+                       perp_dot(r1model[i], normal) * perp_dot(r1model[j], normal) /
+                               rb1.inertia() +
+                       1.f / rb2.mass() +
+                       perp_dot(r2model[i], normal) * perp_dot(r2model[j], normal) /
+                               rb2.inertia();
+            };
+            const float k11 = coupling(0, 0);
+            const float k22 = coupling(1, 1);
+            const float k12 = coupling(0, 1);
+            const float det = k11 * k22 - k12 * k12;
+            static const float max_condition_number = 1000.f;
+            if (k11 * k11 < max_condition_number * det) {
+                const float impulse1 =
+                        (k22 * restitution_speed[0] - k12 * restitution_speed[1]) / det;
+                const float impulse2 =
+                        (k11 * restitution_speed[1] - k12 * restitution_speed[0]) / det;
+                if (impulse1 <= 0.f && impulse2 <= 0.f) {
+                    applyImpulse(impulse1 * normal, 0);
+                    applyImpulse(impulse2 * normal, 1);
+                    isBlockSolved = true;
+                }
+            }
         }
-    }
-}
-void PhysicsSystem::m_applyGravity(float delta_time) {
-    for (const auto e : entities) {
-        auto& rb = getComponent<Rigidbody>(e);
-        if(m_isDormant(rb)) {
-            continue;
+        if (!isBlockSolved) {
+            for (uint8_t i = 0; i < point_count; i++) {
+                if (abs(restitution_speed[i]) > 0.f) {
+                    const auto w1 = rb1.generalizedInverseMass(r1model[i], normal);
+                    const auto w2 = rb2.generalizedInverseMass(r2model[i], normal);
+                    applyImpulse(restitution_speed[i] / (w1 + w2) * normal, i);
+                }
+            }
         }
-        if (!rb.isStatic) {
-            rb.force += gravity * rb.mass();
+
+        const float dfriction = constraint.dfriction;
+        for (uint8_t i = 0; i < point_count; i++) {
+            const auto relative_vel = relativeVelocity(i);
+            constraint.info.relative_velocity = relative_vel;
+            const auto normal_speed = dot(relative_vel, normal);
+            const auto tangent_vel = relative_vel - normal * normal_speed;
+            const auto tangent_speed = length(tangent_vel);
+            // Compute dynamic friction
+            if (abs(tangent_speed) > 0.f ) {
+                const auto tangent_normal = tangent_vel / tangent_speed;
+                const auto w1 = rb1.generalizedInverseMass(r1model[i], tangent_normal);
+                const auto w2 = rb2.generalizedInverseMass(r2model[i], tangent_normal);
+                auto friction_impulse = m_calcDynamicFriction(
+                        dfriction,
+                        tangent_speed,
+                        w1 + w2,
+                        constraint.points[i].normal_lagrange,
+                        delT
+                );
+                applyImpulse(-tangent_normal * friction_impulse, i);
+            }
         }
     }
 }
-void PhysicsSystem::m_applyAirDrag(float delta_time) {
-    for (const auto e : entities) {
+void PhysicsSystem::m_applyForces(float delta_time) {
+    for (const auto e : m_awake_bodies) {
         auto& rb = getComponent<Rigidbody>(e);
         if(m_isDormant(rb)) {
             continue;
         }
+        const float mass = rb.mass();
+        rb.force += gravity * mass;
+
         auto& material = getComponent<Material>(e);
         auto magnitude = dot(rb.velocity, rb.velocity);
-        if(magnitude == 0.f) {
+        if(magnitude != 0.f) {
+            auto direction = -normal(rb.velocity);
+            rb.force += direction * magnitude * material.air_friction * delta_time;
+        }
+
+        if (force_fields.empty()) {
             continue;
         }
-        auto direction = -normal(rb.velocity);
-        if (!rb.isStatic) {
-            rb.force += direction * magnitude * material.air_friction * delta_time;
+        const auto position = getComponent<Transform>(e).position;
+        for (const auto& field : force_fields) {
+            if (field.enabled && isOverlappingPointAABB(position, field.area)) {
+                rb.force += field.force(position, rb.velocity, mass);
+            }
         }
     }
 }
+// one moving body keeps its whole island awake
 void PhysicsSystem::m_processSleepingGroups(float delta_time) {
-    for (const auto e : entities) {
-        auto& rb = getComponent<Rigidbody>(e);
-        if(rb.isStatic)
-            continue;
-        auto head = m_collision_islands.group(e);
-        auto& head_rb = getComponent<Rigidbody>(head);
-        if(length(rb.velocity) > SLOW_VEL) {
-            head_rb.time_resting = 0.f;
+    m_is_restless.reset();
+    for (const auto e : m_awake_bodies) {
+        if(length(getComponent<Rigidbody>(e).velocity) > SLOW_VEL) {
+            m_is_restless.set(m_contact_islands.find(e));
         }
     }
-    for(const auto e : entities) {
+    for(const auto e : m_awake_bodies) {
         auto& rb = getComponent<Rigidbody>(e);
-        if(rb.isStatic)
-            continue;
-        auto head = m_collision_islands.group(e);
-        auto& head_rb = getComponent<Rigidbody>(head);
-        if(head_rb.time_resting == 0.f) {
+        if(m_is_restless.test(m_contact_islands.find(e))) {
             rb.time_resting = 0.f;
-            m_collision_islands.isolate(e);
         }
-    }
-    for(const auto e : entities) {
-        auto& rb = getComponent<Rigidbody>(e);
-        if(rb.isStatic)
-            continue;
         rb.time_resting += delta_time;
     }
 }
-void PhysicsSystem::m_mergeConstrainedSleepingGroups(ConstraintSystem& constr_sys) {
-    auto all_groups = constr_sys.getConstrainedGroups();
-    for(const auto& group : all_groups) {
-        auto prev = group->back();
-        for(auto entity : *group) {
-            m_collision_islands.merge(entity, prev);
-        }
-    }
-}
-void PhysicsSystem::m_processSleep(float delta_time, ConstraintSystem& constr_sys) {
-    m_mergeConstrainedSleepingGroups(constr_sys);
+void PhysicsSystem::m_processSleep(float delta_time) {
     m_processSleepingGroups(delta_time);
-    for (const auto e : entities) {
+    for (const auto e : m_awake_bodies) {
         auto& rb = getComponent<Rigidbody>(e);
         auto& col = getComponent<Collider>(e);
-        if(rb.isStatic)
-            continue;
         col.isNonMoving = m_isDormant(rb);
     }
 }
@@ -491,19 +1922,71 @@ void PhysicsSystem::m_step(
         ColliderSystem& col_sys,
         RigidbodySystem& rb_sys,
         ConstraintSystem& const_sys,
+        size_t substep,
         float delta_time
 ) {
-    m_processSleep(delta_time, const_sys);
-    rb_sys.integrate(delta_time, DORMANT_TIME_THRESHOLD);
+    auto islandDeltaTime = [&](const Island& island) {
+        return delta_time * static_cast<float>(island.substep_stride);
+    };
+    m_processSleep(delta_time * static_cast<float>(m_common_substep_stride));
+    rb_sys.integrate(delta_time, DORMANT_TIME_THRESHOLD, substep);
     trans_sys.update();
-    const_sys.update(delta_time);
-    auto potential_pairs = m_broadPhase(col_sys, trans_sys);
-    auto penetrations = m_narrowPhase(col_sys, potential_pairs, delta_time);
-    
+    m_forEachIsland([&](Island& island) {
+        if (!island.isSteppedAt(substep)) {
+            return;
+        }
+        const_sys.solve(island.constraints, islandDeltaTime(island));
+        m_narrowPhase(island.pairs, island.penetrations, islandDeltaTime(island));
+    });
+    for (size_t i = m_colored_island_begin; i < m_island_count; i++) {
+        if (m_islands[i].isSteppedAt(substep)) {
+            m_solveColoredIsland(m_islands[i], const_sys, islandDeltaTime(m_islands[i]));
+        }
+    }
+    m_mergeIslandResults(col_sys, substep);
+
     trans_sys.update();
-    rb_sys.deriveVelocities(delta_time, DORMANT_TIME_THRESHOLD);
-    m_solveVelocities(penetrations, delta_time);
-    m_broadcastCollisionMessages(penetrations);
+    rb_sys.deriveVelocities(delta_time);
+    m_forEachIsland([&](Island& island) {
+        if (island.isSteppedAt(substep)) {
+            m_solveVelocities(island.penetrations, islandDeltaTime(island));
+        }
+    });
+    for (size_t i = m_colored_island_begin; i < m_island_count; i++) {
+        auto& island = m_islands[i];
+        if (!island.isSteppedAt(substep)) {
+            continue;
+        }
+        m_forEachColor(island.penetration_batches, [&](size_t begin, size_t end) {
+            m_solveVelocities(
+                    std::span(island.penetrations).subspan(begin, end - begin),
+                    islandDeltaTime(island)
+            );
+        });
+    }
+    for (size_t i = 0; i < m_island_count; i++) {
+        if (m_islands[i].isSteppedAt(substep)) {
+            m_broadcastCollisionMessages(m_islands[i].penetrations);
+        }
+    }
+}
+PhysicsSystem::PhysicsSystem() {
+    m_island_of_head.fill(-1);
+}
+void PhysicsSystem::onEntityRemoved(Entity entity) {
+    // the id can be reused right away so its edges must not outlive it
+    m_contact_islands.removeNode(entity);
+    std::erase_if(m_contact_edges, [&](const EdgeKey& key) {
+        return key.first == entity || key.second == entity;
+    });
+    if(m_is_sleeping.test(entity)) {
+        m_is_sleeping.reset(entity);
+        m_isSleepingTreeDirty = true;
+    }
+    if(m_is_baked_static.test(entity)) {
+        m_is_baked_static.reset(entity);
+        m_isStaticWorldDirty = true;
+    }
 }
 void PhysicsSystem::update(
         TransformSystem& trans_sys,
@@ -512,33 +1995,70 @@ void PhysicsSystem::update(
         ConstraintSystem& const_sys,
         float delT
 ) {
-    m_have_collided.reset();
+    m_touching.clear();
     trans_sys.update();
+    for(Layer layer = 0; layer < MAX_LAYERS; layer++) {
+        m_layer_masks[layer] = col_sys.collisionMask(layer).to_ulong();
+    }
+    m_updateBodySets();
+    m_updateSleepingTree();
+    m_updateTilemaps();
+    m_wakeTouchedIslands(delT);
+    m_updateStaticWorld();
+    rb_sys.gatherBodies(DORMANT_TIME_THRESHOLD);
+    const_sys.gatherConstraints();
     m_updateQuadTree();
-    m_applyGravity(delT);
-    m_applyAirDrag(delT);
-    for (int i = 0; i < substep_count; i++) {
+    // quad tree is only rebuilt once per tick so are the pairs and islands
+    const auto& potential_pairs = m_broadPhase();
+    m_updateManifoldCache();
+    m_buildSolverIslands(potential_pairs, const_sys, delT);
+    m_applyForces(delT);
+    // forces are consumed by integration of the first substep
+    for (size_t i = 0; i < substep_count; i += m_common_substep_stride) {
         m_step(trans_sys,
                col_sys,
                rb_sys,
                const_sys,
+               i,
                delT / static_cast<float>(substep_count));
-        for (const auto e : entities) {
-            auto& rb = getComponent<Rigidbody>(e);
-            rb.force = {0, 0};
-            rb.torque = 0.f;
-        }
     }
     col_sys.processCollisionNotifications();
-    m_separateNonColliding();
+    m_updateContactGraph(const_sys);
 }
-void PhysicsSystem::m_separateNonColliding() {
-    for(auto e : entities) {
-        auto& rb = getComponent<Rigidbody>(e);
-        if(!m_have_collided.test(e) && !m_isDormant(rb)) {
-            m_collision_islands.isolate(e);
+void PhysicsSystem::m_updateContactGraph(ConstraintSystem& const_sys) {
+    for(const auto& constraint : const_sys.solverConstraints()) {
+        const auto& rbs = constraint.rigidbodies;
+        if(rbs[0] != nullptr && !rbs[0]->isStatic && rbs[1] != nullptr && !rbs[1]->isStatic) {
+            m_touching.push_back(std::minmax(constraint.bodies[0], constraint.bodies[1]));
+        }
+    }
+    // sleeping bodies generate no pairs, their contacts last until they wake
+    for(const auto& key : m_contact_edges) {
+        if(m_is_sleeping.test(key.first) && m_is_sleeping.test(key.second)) {
+            m_touching.push_back(key);
+        }
+    }
+    std::sort(m_touching.begin(), m_touching.end());
+    m_touching.erase(std::unique(m_touching.begin(), m_touching.end()), m_touching.end());
+
+    // both edge lists are sorted so events are found with one merge
+    size_t previous = 0;
+    size_t current = 0;
+    while(previous < m_contact_edges.size() || current < m_touching.size()) {
+        if(current == m_touching.size() ||
+           (previous < m_contact_edges.size() && m_contact_edges[previous] < m_touching[current])) {
+            const auto& key = m_contact_edges[previous++];
+            m_contact_islands.removeEdge(key.first, key.second);
+        } else if(previous == m_contact_edges.size() || m_touching[current] < m_contact_edges[previous]) {
+            const auto& key = m_touching[current++];
+            m_contact_islands.addEdge(key.first, key.second);
+        } else {
+            previous++;
+            current++;
         }
     }
+    m_contact_edges.swap(m_touching);
+    m_contact_islands.split();
 }
 }; // namespace emp
 
@@ -1,5 +1,6 @@
 #ifndef EMP_PHYSICS_SYSTEM_HPP
 #define EMP_PHYSICS_SYSTEM_HPP
+#include "compute/multithreading/thread_pool.hpp"
 #include "core/coordinator.hpp"
 #include "core/entity.hpp"
 #include "debug/debug.hpp"
@@ -8,34 +9,129 @@
 #include "math/math_func.hpp"
 #include "physics/collider.hpp"
 #include "physics/constraint.hpp"
+#include "physics/force_field.hpp"
 #include "physics/material.hpp"
 #include "physics/rigidbody.hpp"
+#include "physics/tilemap_collider.hpp"
 #include "scene/transform.hpp"
 #include "templates/disjoint_set.hpp"
+#include "templates/island_graph.hpp"
+#include "templates/graph_coloring.hpp"
 #include "templates/quad_tree.hpp"
 
 #include <memory>
+#include <optional>
+#include <span>
 #include <unordered_map>
 namespace emp {
 struct Constraint;
-typedef std::tuple<Entity, size_t, AABB> CollidingPoly;
+// collision filtering data of a proxy, lets pairs be rejected
+// when emitted without fetching any components
+struct ProxyFilter {
+    // layers this proxy can collide with
+    uint32_t mask;
+    Layer layer;
+    uint8_t isStatic : 1;
+    uint8_t isNonMoving : 1;
+    bool operator==(const ProxyFilter&) const = default;
+};
+typedef std::tuple<Entity, size_t, AABB, ProxyFilter> CollidingPoly;
 typedef std::pair<CollidingPoly, CollidingPoly> CollidingPair;
 class PhysicsSystem : public System<Transform, Collider, Rigidbody, Material> {
+public:
+    // what an island looked like when its substep count was picked
+    struct IslandStats {
+        size_t body_count = 0;
+        size_t pair_count = 0;
+        size_t constraint_count = 0;
+        // longest chain of pairs leading to a static body
+        size_t stack_depth = 0;
+        float mass_ratio = 1.f;
+        float max_relative_speed = 0.f;
+        size_t substep_count = 1;
+    };
+    // hit of a ray or of a swept shape
+    struct RaycastHit {
+        Entity entity;
+        // convex piece of the entity's collider that was hit
+        size_t piece;
+        vec2f point;
+        // outward normal of the hit shape
+        vec2f normal;
+        // part of the ray or motion travelled before the hit
+        float time;
+    };
+private:
     struct AABBextracter {
-        AABB operator()(std::tuple<Entity, size_t, AABB> v) {
+        AABB operator()(const CollidingPoly& v) {
             return std::get<AABB>(v);
         }
     };
+    // single point of a contact manifold
+    struct ContactPoint {
+        // not rotated not translated (model space)
+        vec2f radius1;
+        vec2f radius2;
+        float normal_lagrange = 0.f;
+        uint32_t feature_id = 0;
+    };
+    // manifold of a pair kept between steps, points are matched by feature id
+    // so that their multipliers can warm start the next step
+    struct CachedManifold {
+        std::array<uint32_t, 2> feature_ids{};
+        // only multipliers solved in the last step, reused ones are not kept
+        std::array<float, 2> normal_lagrange{};
+        // length of the step the multipliers were solved with
+        float delta_time = 0.f;
+        uint8_t point_count = 0;
+        // last axis found by SAT, tested first on the next step
+        uint32_t separating_axis = 0;
+        // multiplier of the point rescaled to a step of length delT
+        float warmLagrange(uint32_t feature_id, float delT) const;
+    };
+    typedef QuadTree<CollidingPoly, AABBextracter&> QuadTree_t;
+    typedef std::tuple<Entity, Entity, size_t, size_t> PairKey;
+    static PairKey m_pairKey(const CollidingPair& pair);
     struct PenetrationConstraint {
         bool detected = false;
+        // describes the deepest point, used for notifications
         CollisionInfo info;
-        // not rotated not translated (model space)
+        std::array<ContactPoint, 2> points;
+        uint8_t point_count = 0;
         bool isStatic1;
         bool isStatic2;
         float sfriction;
         float dfriction;
         float restitution;
     };
+    // set of bodies that can only affect each other during a tick,
+    // can be solved independently of other islands
+    struct Island {
+        Entity head;
+        // dynamic bodies of pairs and constraints
+        std::vector<Entity> bodies;
+        // slots of ConstraintSystem::solverConstraints
+        std::vector<uint32_t> constraints;
+        std::vector<CollidingPair> pairs;
+        std::vector<PenetrationConstraint> penetrations;
+        // color offsets, empty unless island is big enough to be colored
+        std::vector<size_t> constraint_batches;
+        std::vector<size_t> pair_batches;
+        std::vector<size_t> penetration_batches;
+        IslandStats stats;
+        // island is stepped on every substep_stride-th substep only,
+        // covering that many substeps at once
+        size_t substep_stride = 1;
+        bool isSteppedAt(size_t substep) const {
+            return substep % substep_stride == 0;
+        }
+        size_t work() const {
+            return constraints.size() + pairs.size();
+        }
+        bool isColored() const {
+            return !pair_batches.empty() || !constraint_batches.empty();
+        }
+    };
     float m_calcRestitution(
             float coef,
             float normal_speed,
@@ -57,59 +153,291 @@ class PhysicsSystem : public System<Transform, Collider, Rigidbody, Material> {
             const int convexIdx1,
             Entity b2,
             const int convexIdx2,
+            CachedManifold& manifold,
             float delT,
             float compliance = 0.f
     );
 
-    std::vector<CollidingPair> m_broadPhase(const ColliderSystem& collider_system, const TransformSystem& transform_system);
+    // pairs sorted by entities, valid until next call
+    const std::vector<CollidingPair>& m_broadPhase();
+    // carries manifolds of pairs that persisted since the last tick,
+    // after the call m_manifolds is aligned with m_pairs
+    void m_updateManifoldCache();
 
-    bool m_isCollisionAllowed(const CollidingPair&, const ColliderSystem& col_sys) const;
-    void m_filterPotentialCollisions(std::vector<CollidingPair>&, const ColliderSystem& col_sys);
+    // only uses mask of the first proxy so static ones baked with
+    // an outdated mask should be passed second
+    static bool m_isCollisionAllowed(const CollidingPoly& first, const CollidingPoly& second);
+    ProxyFilter m_proxyFilter(const Collider& col, const Rigidbody& rb) const;
+    // proxies of bodies found fast over sweep_time are grown along their motion
+    void m_appendProxies(Entity entity, std::vector<CollidingPoly>& proxies, float sweep_time = 0.f);
+    // round pieces are grown by their radius
+    AABB m_proxyAABB(
+            const Collider& col, const Transform& trans, const Collider::ConvexVertexCloud& piece
+    ) const;
     void m_updateQuadTree();
+    void m_updateStaticWorld();
+    // rebuilds changed tilemap chunks and wakes bodies sleeping on them
+    void m_updateTilemaps();
+    void m_carveEntity(Entity entity, const std::vector<vec2f>& cutter, std::vector<Entity>& fragments);
+    // new body made of pieces of entity, moved so that its origin is the centroid
+    Entity m_createFragment(Entity entity, const ColliderShape& shape);
+    // returns baked shape of static bodies, otherwise transforms into storage
+    const ConvexPiece& m_worldConvex(
+            Entity entity, size_t index, ConvexPiece& storage
+    ) const;
 
-    std::vector<PenetrationConstraint> m_narrowPhase(
-            ColliderSystem& col_sys,
+    typedef std::function<void(const QuadTree_t&, std::vector<CollidingPoly>&)> TreeQuery;
+    // runs query on every tree and adds tilemap rects overlapping area, which has
+    // to bound everything the query can find, result holds each piece once
+    // and only proxies of live entities with layers in mask
+    void m_queryProxies(
+            const TreeQuery& query, const AABB& area, LayerMask mask, std::vector<CollidingPoly>& result
+    ) const;
+    // appends tilemap rects with layers in mask whose bounds overlap area
+    void m_appendTilemapProxies(const AABB& area, LayerMask mask, std::vector<CollidingPoly>& result) const;
+    std::optional<RaycastHit> m_raycastProxy(
+            const CollidingPoly& proxy, vec2f origin, vec2f direction
+    ) const;
+
+    // sorts bodies into static, awake and sleeping ones
+    void m_updateBodySets();
+    bool m_isWakeRequested(const Rigidbody& rb) const;
+    void m_wakeIsland(Entity entity);
+    void m_updateSleepingTree();
+    // wakes sleeping islands overlapped by awake proxies
+    void m_wakeTouchedIslands(float delT);
+
+    PenetrationConstraint m_handleCollision(const CollidingPair& pair, float delT);
+    void m_narrowPhase(
             const std::vector<CollidingPair>& pairs,
+            std::vector<PenetrationConstraint>& result,
             float delT
     );
+    void m_narrowPhaseColored(Island& island, float delT);
     // need to update colliders after
     void m_solveVelocities(
-            std::vector<PenetrationConstraint>& constraints, float delT
+            std::span<PenetrationConstraint> constraints, float delT
     );
     void m_broadcastCollisionMessages(
             const std::vector<PenetrationConstraint>& constraints
     );
-    void m_applyGravity(float delta_time);
-    void m_applyAirDrag(float delta_time);
+    // gravity, air drag and force fields in one pass over bodies
+    void m_applyForces(float delta_time);
 
-    void m_processSleep(float delta_time, ConstraintSystem& constr_sys);
+    void m_processSleep(float delta_time);
     void m_processSleepingGroups(float delta_time);
-    void m_mergeConstrainedSleepingGroups(ConstraintSystem& constr_sys);
 
-    void m_separateNonColliding();
+    // turns contacts and joints that appeared or vanished this tick into
+    // edge events of the contact graph and splits islands that lost edges
+    void m_updateContactGraph(ConstraintSystem& const_sys);
+
+    void m_buildSolverIslands(
+            const std::vector<CollidingPair>& pairs,
+            ConstraintSystem& const_sys,
+            float delT
+    );
+    // fills stats of the island and picks its substep stride from them
+    void m_chooseSubsteps(Island& island, float delT);
+    // smallest divisor of substep_count that is at least needed
+    size_t m_substepCountFor(size_t needed) const;
+    void m_colorIsland(Island& island, ConstraintSystem& const_sys);
+    void m_forEachIsland(const std::function<void(Island&)>& func);
+    void m_forEachColor(
+            const std::vector<size_t>& offsets,
+            const std::function<void(size_t, size_t)>& func
+    );
+    void m_solveColoredIsland(Island& island, ConstraintSystem& const_sys, float delT);
+    void m_mergeIslandResults(ColliderSystem& col_sys, size_t substep);
+    // deltaTime is the length of a single substep, islands with longer
+    // strides are stepped by a multiple of it
     void m_step(
             TransformSystem& trans_sys,
             ColliderSystem& col_sys,
             RigidbodySystem& rb_sys,
             ConstraintSystem& const_sys,
+            size_t substep,
             float deltaTime
     );
 
-    typedef QuadTree<std::tuple<Entity, size_t, AABB>, AABBextracter&> QuadTree_t;
     std::unique_ptr<QuadTree_t> m_quad_tree;
     AABBextracter m_aabb_extracter;
+    std::array<uint32_t, MAX_LAYERS> m_layer_masks;
+    std::vector<CollidingPair> m_pairs;
+    std::vector<CachedManifold> m_manifolds;
+    std::vector<PairKey> m_manifold_keys;
+    std::vector<CachedManifold> m_previous_manifolds;
+    std::vector<CollidingPoly> m_query_result;
+
+    // sleeping bodies are kept out of the quad tree and generate no pairs,
+    // their own tree is only rebuilt when the set of sleeping bodies changes
+    std::unique_ptr<QuadTree_t> m_sleeping_tree;
+    bool m_isSleepingTreeDirty = true;
+    std::bitset<MAX_ENTITIES> m_is_sleeping;
+    std::vector<Entity> m_static_bodies;
+    std::vector<Entity> m_awake_bodies;
+    std::vector<Entity> m_sleeping_bodies;
+    std::vector<CollidingPoly> m_awake_proxies;
+    // bodies with swept proxies, their pairs are advanced to the time of impact
+    std::bitset<MAX_ENTITIES> m_is_fast;
+
+    // static bodies baked into world space with their own tree, rebuilt only
+    // when a static body is added, removed or the world is invalidated
+    std::unique_ptr<QuadTree_t> m_static_tree;
+    std::unordered_map<Entity, std::vector<ConvexPiece>> m_static_shapes;
+    std::bitset<MAX_ENTITIES> m_is_baked_static;
+    bool m_isStaticWorldDirty = true;
+
+    // tilemaps are not put into any tree, awake proxies look up
+    // their rects by grid coordinates instead
+    TilemapSystem* m_tilemaps = nullptr;
+    std::bitset<MAX_ENTITIES> m_is_tilemap;
+    std::vector<AABB> m_changed_tile_areas;
 
-    DisjointSet<MAX_ENTITIES> m_collision_islands;
-    std::bitset<MAX_ENTITIES> m_have_collided;
+    // reused by carving
+    std::vector<Entity> m_carved;
+    std::vector<Collider::ConvexVertexCloud> m_carve_kept;
+    std::vector<Collider::ConvexVertexCloud> m_carve_cut;
+    std::vector<vec2f> m_carve_cutter;
+    std::vector<AABB> m_carve_bounds;
+    // pieces ordered by left edge of their bounds, only overlapping ones are paired
+    std::vector<std::pair<float, size_t>> m_carve_sweep;
+    std::vector<size_t> m_carve_group;
+    std::vector<size_t> m_carve_part_of_group;
+    std::vector<std::vector<Collider::ConvexVertexCloud>> m_carve_parts;
+    std::vector<ColliderShape::Handle> m_carve_shapes;
+
+    // dynamic bodies connected by touching contacts and joints, kept between
+    // ticks so islands fall asleep and wake up as a whole
+    typedef std::pair<Entity, Entity> EdgeKey;
+    IslandGraph<MAX_ENTITIES> m_contact_islands;
+    // sorted edges of the graph and the ones found during the current tick
+    std::vector<EdgeKey> m_contact_edges;
+    std::vector<EdgeKey> m_touching;
+    std::bitset<MAX_ENTITIES> m_is_restless;
+
+    // islands rebuilt every tick from broad phase pairs and constraints
+    static constexpr size_t MIN_ISLAND_BATCH_WORK = 32U;
+    DisjointSet<MAX_ENTITIES> m_solver_islands;
+    std::array<int, MAX_ENTITIES> m_island_of_head;
+    std::vector<Island> m_islands;
+    size_t m_island_count = 0;
+
+    // islands at least this big are split into colors and solved in parallel,
+    // they are kept after the small islands in m_islands
+    static constexpr size_t MIN_COLORED_ISLAND_WORK = 128U;
+    static constexpr size_t MIN_COLOR_BATCH_SIZE = 16U;
+    GreedyColoring<MAX_ENTITIES> m_coloring;
+    size_t m_colored_island_begin = 0;
+
+    // heuristics of adaptive substepping, each term asks for a substep count
+    // and the biggest one wins
+    static constexpr float STACK_LAYERS_PER_SUBSTEP = 2.f;
+    static constexpr float CONSTRAINTS_PER_SUBSTEP = 1.f;
+    static constexpr float SUBSTEPS_PER_MASS_RATIO_DOUBLING = 2.f;
+    static constexpr float MAX_SUBSTEP_TRAVEL = 4.f;
+    static constexpr uint16_t MAX_STACK_DEPTH = 64U;
+    std::array<uint16_t, MAX_ENTITIES> m_stack_depth;
+    // substeps on which nothing is stepped are skipped
+    size_t m_common_substep_stride = 1;
+    ThreadPool m_thread_pool{std::max(std::thread::hardware_concurrency(), 1U) - 1U};
 public:
     bool useDeactivation = true;
+    bool useParallelSolver = true;
     static constexpr float SLOW_VEL = 15.f;
     static constexpr float DORMANT_TIME_THRESHOLD = 3.f;
+    // bodies moving further than this part of their smallest extent in a tick
+    // use continuous collision
+    static constexpr float FAST_MOTION_FRACTION = 0.25f;
     vec2f gravity = {0.f, 1.f};
+    std::vector<ForceField> force_fields;
+    // with adaptive substepping it is the most an island can get
     size_t substep_count = 8U;
+    // every island picks a substep count between min_substep_count and
+    // substep_count based on how hard it is to solve
+    bool useAdaptiveSubstepping = true;
+    size_t min_substep_count = 1U;
 
     bool m_isDormant(const Rigidbody& rb) const;
+    // sleeping bodies are kept out of the quad tree until their island wakes up
+    bool isSleeping(Entity entity) const {
+        return m_is_sleeping.test(entity);
+    }
+
+    // has to be called after moving, reshaping or changing layer of a static body
+    void invalidateStaticWorld();
+
+    // islands solved during the last tick
+    size_t islandCount() const {
+        return m_island_count;
+    }
+    const IslandStats& islandStats(size_t island) const {
+        return m_islands[island].stats;
+    }
+
+    // queries see broad phase of the last update, only layers in mask are reported,
+    // ray and motion are given as the full offset from their start
+    std::optional<RaycastHit> raycast(
+            vec2f origin, vec2f direction, LayerMask mask = LayerMask().set()
+    ) const;
+    // appends hits of every piece crossed by the ray, ordered by time
+    void raycastAll(
+            vec2f origin,
+            vec2f direction,
+            std::vector<RaycastHit>& hits,
+            LayerMask mask = LayerMask().set()
+    ) const;
+    // closest hit of every ray written to hits at the same index, hits has to be
+    // at least as long as rays, rays are traced in packets and nothing is allocated
+    void raycastBatch(
+            std::span<const Ray> rays,
+            std::span<std::optional<RaycastHit>> hits,
+            LayerMask mask = LayerMask().set()
+    ) const;
+    // appends every entity whose collider contains point
+    void overlapPoint(
+            vec2f point, std::vector<Entity>& result, LayerMask mask = LayerMask().set()
+    ) const;
+    // appends every entity whose collider overlaps box
+    void overlapAABB(
+            const AABB& box, std::vector<Entity>& result, LayerMask mask = LayerMask().set()
+    ) const;
+    // appends proxies of every piece, tilemap rects included, whose bounds overlap
+    // box, lets a body made of many particles reach the broad phase with one query
+    void overlapProxies(
+            const AABB& box, std::vector<CollidingPoly>& result, LayerMask mask = LayerMask().set()
+    ) const;
+    // world space shape of a piece reported by a query, storage is used for pieces
+    // that are not baked
+    const ConvexPiece& worldPiece(Entity entity, size_t piece, ConvexPiece& storage) const {
+        return m_worldConvex(entity, piece, storage);
+    }
+    // sweeps shape placed by transform along motion, returns the first hit
+    std::optional<RaycastHit> shapeCast(
+            const Collider& shape,
+            const Transform& transform,
+            vec2f motion,
+            LayerMask mask = LayerMask().set()
+    ) const;
+    /**
+     * removes convex cutter (world space) from every polygon collider it overlaps,
+     * only pieces touched by cutter are decomposed again
+     *
+     * pieces that are no longer connected to the biggest part are split off into
+     * new entities appended to fragments, bodies carved away completely are
+     * destroyed, round colliders and tilemaps are left untouched
+     */
+    void carve(
+            const std::vector<vec2f>& cutter,
+            std::vector<Entity>& fragments,
+            LayerMask mask = LayerMask().set()
+    );
 
+    PhysicsSystem();
+    // shared with systems updated after physics instead of each starting its own workers
+    inline ThreadPool& threadPool() {
+        return m_thread_pool;
+    }
+    void onEntityRemoved(Entity entity) override final;
     void update(
             TransformSystem& trans_sys,
             ColliderSystem& col_sys,
@@ -3,7 +3,12 @@
 #include "math/geometry_func.hpp"
 #include "math/math_func.hpp"
 #include "physics/collider.hpp"
+#include <algorithm>
+#include <cassert>
 #include <numeric>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 namespace emp {
 #define SQ(x) ((x) * (x))
 Rigidbody::Rigidbody(
@@ -18,47 +23,271 @@ float Rigidbody::generalizedInverseMass(vec2f radius, vec2f normal) const {
         return 0.f;
     return 1.f / mass() + (SQ(perp_dot(radius, normal)) / inertia());
 }
-void RigidbodySystem::updateMasses() {
-    for (auto entity : entities) {
-        auto& rigidobdy = getComponent<Rigidbody>(entity);
-        const auto collider = ECS().getComponent<Collider>(entity);
-        if (rigidobdy.useAutomaticMass && collider != nullptr) {
-
-            // auto model =  collider->transformed_outline();
-            // vec2f avg = std::reduce(model.begin(), model.end()) / static_cast<float>(model.size());
-            // for(auto& p : model) { p -= avg; }
-
-            auto MIA = calculateMassInertiaArea(collider->model_outline());
-            rigidobdy.real_mass = MIA.area * rigidobdy.real_density;
-            rigidobdy.real_inertia = MIA.MMOI * rigidobdy.real_density;
-        }
+void RigidbodySystem::m_updateMass(Entity entity, Rigidbody& rigidbody) {
+    // adding collider or enabling automatic mass invalidates it again
+    rigidbody.m_isMassDirty = false;
+    const auto collider = ECS().getComponent<Collider>(entity);
+    if (!rigidbody.useAutomaticMass || collider == nullptr) {
+        return;
+    }
+    const auto& MIA = collider->mass_properties();
+    rigidbody.real_mass = MIA.area * rigidbody.real_density;
+    rigidbody.real_inertia = MIA.MMOI * rigidbody.real_density;
+}
+void RigidbodySoA::resize(size_t size) {
+    for (auto* arr : {&pos_x, &pos_y, &rot, &prev_pos_x, &prev_pos_y, &prev_rot,
+                      &vel_x, &vel_y, &ang_vel, &force_x, &force_y, &torque,
+                      &inv_mass, &inv_inertia}) {
+        arr->resize(size);
+    }
+    step_scale.resize(size, 1.f);
+}
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// avx kernels are built for every x86 target and only run when the cpu has it
+#define EMP_AVX_KERNELS
+#define EMP_TARGET_AVX __attribute__((target("avx")))
+#endif
+eSimdLevel supportedSimdLevel() {
+#if defined(EMP_AVX_KERNELS)
+    static const bool hasAVX = __builtin_cpu_supports("avx");
+    if (hasAVX) {
+        return eSimdLevel::AVX;
+    }
+#endif
+#if defined(__SSE__)
+    return eSimdLevel::SSE;
+#else
+    return eSimdLevel::Scalar;
+#endif
+}
+static eSimdLevel usableSimdLevel(eSimdLevel level) {
+    return std::min(level, supportedSimdLevel());
+}
+// every kernel advances from i while whole vectors fit before end and returns
+// the first index it did not process,
+// forces act over delT while positions advance by delT * step_scale
+#if defined(EMP_AVX_KERNELS)
+EMP_TARGET_AVX static size_t integrateAxisAVX(
+        float* pos, float* prev, float* vel, const float* force, const float* inv_mass,
+        const float* step_scale, size_t i, size_t end, float delT
+) {
+    const __m256 dt8 = _mm256_set1_ps(delT);
+    for (; i + 8 <= end; i += 8) {
+        __m256 p = _mm256_loadu_ps(pos + i);
+        __m256 v = _mm256_loadu_ps(vel + i);
+        const __m256 acc = _mm256_mul_ps(_mm256_loadu_ps(force + i), _mm256_loadu_ps(inv_mass + i));
+        const __m256 step = _mm256_mul_ps(dt8, _mm256_loadu_ps(step_scale + i));
+        v = _mm256_add_ps(v, _mm256_mul_ps(dt8, acc));
+        _mm256_storeu_ps(prev + i, p);
+        p = _mm256_add_ps(p, _mm256_mul_ps(v, step));
+        _mm256_storeu_ps(vel + i, v);
+        _mm256_storeu_ps(pos + i, p);
+    }
+    return i;
+}
+EMP_TARGET_AVX static size_t deriveAxisAVX(
+        float* vel, const float* pos, const float* prev, const float* step_scale, size_t i, size_t end, float delT
+) {
+    const __m256 dt8 = _mm256_set1_ps(delT);
+    for (; i + 8 <= end; i += 8) {
+        const __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(pos + i), _mm256_loadu_ps(prev + i));
+        const __m256 step = _mm256_mul_ps(dt8, _mm256_loadu_ps(step_scale + i));
+        _mm256_storeu_ps(vel + i, _mm256_div_ps(diff, step));
+    }
+    return i;
+}
+#endif
+#if defined(__SSE__)
+static size_t integrateAxisSSE(
+        float* pos, float* prev, float* vel, const float* force, const float* inv_mass,
+        const float* step_scale, size_t i, size_t end, float delT
+) {
+    const __m128 dt4 = _mm_set1_ps(delT);
+    for (; i + 4 <= end; i += 4) {
+        __m128 p = _mm_loadu_ps(pos + i);
+        __m128 v = _mm_loadu_ps(vel + i);
+        const __m128 acc = _mm_mul_ps(_mm_loadu_ps(force + i), _mm_loadu_ps(inv_mass + i));
+        const __m128 step = _mm_mul_ps(dt4, _mm_loadu_ps(step_scale + i));
+        v = _mm_add_ps(v, _mm_mul_ps(dt4, acc));
+        _mm_storeu_ps(prev + i, p);
+        p = _mm_add_ps(p, _mm_mul_ps(v, step));
+        _mm_storeu_ps(vel + i, v);
+        _mm_storeu_ps(pos + i, p);
+    }
+    return i;
+}
+static size_t deriveAxisSSE(
+        float* vel, const float* pos, const float* prev, const float* step_scale, size_t i, size_t end, float delT
+) {
+    const __m128 dt4 = _mm_set1_ps(delT);
+    for (; i + 4 <= end; i += 4) {
+        const __m128 diff = _mm_sub_ps(_mm_loadu_ps(pos + i), _mm_loadu_ps(prev + i));
+        const __m128 step = _mm_mul_ps(dt4, _mm_loadu_ps(step_scale + i));
+        _mm_storeu_ps(vel + i, _mm_div_ps(diff, step));
+    }
+    return i;
+}
+#endif
+static void integrateAxis(
+        float* pos, float* prev, float* vel, const float* force, const float* inv_mass,
+        const float* step_scale, size_t begin, size_t end, float delT, eSimdLevel level
+) {
+    size_t i = begin;
+#if defined(EMP_AVX_KERNELS)
+    if (level >= eSimdLevel::AVX) {
+        i = integrateAxisAVX(pos, prev, vel, force, inv_mass, step_scale, i, end, delT);
+    }
+#endif
+#if defined(__SSE__)
+    if (level >= eSimdLevel::SSE) {
+        i = integrateAxisSSE(pos, prev, vel, force, inv_mass, step_scale, i, end, delT);
+    }
+#endif
+    for (; i < end; i++) {
+        vel[i] += delT * (force[i] * inv_mass[i]);
+        prev[i] = pos[i];
+        pos[i] += vel[i] * (delT * step_scale[i]);
+    }
+}
+static void deriveAxis(
+        float* vel, const float* pos, const float* prev, const float* step_scale,
+        size_t begin, size_t end, float delT, eSimdLevel level
+) {
+    size_t i = begin;
+#if defined(EMP_AVX_KERNELS)
+    if (level >= eSimdLevel::AVX) {
+        i = deriveAxisAVX(vel, pos, prev, step_scale, i, end, delT);
+    }
+#endif
+#if defined(__SSE__)
+    if (level >= eSimdLevel::SSE) {
+        i = deriveAxisSSE(vel, pos, prev, step_scale, i, end, delT);
     }
+#endif
+    for (; i < end; i++) {
+        vel[i] = (pos[i] - prev[i]) / (delT * step_scale[i]);
+    }
+}
+void integrateSoA(RigidbodySoA& b, float delT, size_t begin, size_t end, eSimdLevel level) {
+    assert(begin <= end && end <= b.size());
+    level = usableSimdLevel(level);
+    const float* scale = b.step_scale.data();
+    integrateAxis(b.pos_x.data(), b.prev_pos_x.data(), b.vel_x.data(), b.force_x.data(), b.inv_mass.data(), scale, begin, end, delT, level);
+    integrateAxis(b.pos_y.data(), b.prev_pos_y.data(), b.vel_y.data(), b.force_y.data(), b.inv_mass.data(), scale, begin, end, delT, level);
+    integrateAxis(b.rot.data(), b.prev_rot.data(), b.ang_vel.data(), b.torque.data(), b.inv_inertia.data(), scale, begin, end, delT, level);
+}
+void deriveVelocitiesSoA(RigidbodySoA& b, float delT, size_t begin, size_t end, eSimdLevel level) {
+    assert(begin <= end && end <= b.size());
+    level = usableSimdLevel(level);
+    const float* scale = b.step_scale.data();
+    deriveAxis(b.vel_x.data(), b.pos_x.data(), b.prev_pos_x.data(), scale, begin, end, delT, level);
+    deriveAxis(b.vel_y.data(), b.pos_y.data(), b.prev_pos_y.data(), scale, begin, end, delT, level);
+    deriveAxis(b.ang_vel.data(), b.rot.data(), b.prev_rot.data(), scale, begin, end, delT, level);
 }
-void RigidbodySystem::integrate(float delT, float resting_time_threshold) {
+void RigidbodySystem::gatherBodies(float resting_time_threshold) {
+    m_movable_bodies.clear();
     for (auto entity : entities) {
         auto& rigidbody = getComponent<Rigidbody>(entity);
-        if(rigidbody.time_resting > resting_time_threshold || rigidbody.isStatic)
+        if (rigidbody.isStatic || rigidbody.time_resting > resting_time_threshold) {
             continue;
-        auto& transform = getComponent<Transform>(entity);
-        rigidbody.prev_pos = transform.position;
-        rigidbody.velocity += delT * rigidbody.force / rigidbody.mass();
-        transform.position += rigidbody.velocity * delT;
-
-        rigidbody.prev_rot = transform.rotation;
-        rigidbody.angular_velocity += delT * rigidbody.torque / rigidbody.inertia();
-        transform.rotation += rigidbody.angular_velocity * delT;
+        }
+        if (rigidbody.m_isMassDirty) {
+            m_updateMass(entity, rigidbody);
+        }
+        m_movable_bodies.push_back({&rigidbody, &getComponent<Transform>(entity)});
     }
+    m_isTickLoaded = false;
 }
-void RigidbodySystem::deriveVelocities(float delT, float resting_time_threshold) {
-    for (auto entity : entities) {
-        auto& rigidbody = getComponent<Rigidbody>(entity);
-        if(rigidbody.time_resting > resting_time_threshold || rigidbody.isStatic)
+void RigidbodySystem::m_loadTick() {
+    // bodies of one stride are adjacent, so they are stepped as one range
+    std::stable_sort(m_movable_bodies.begin(), m_movable_bodies.end(), [](const auto& a, const auto& b) {
+        return a.first->substep_stride < b.first->substep_stride;
+    });
+    m_soa.resize(m_movable_bodies.size());
+    for (size_t i = 0; i < m_movable_bodies.size(); i++) {
+        auto& rigidbody = *m_movable_bodies[i].first;
+        m_soa.force_x[i] = rigidbody.force.x;
+        m_soa.force_y[i] = rigidbody.force.y;
+        m_soa.torque[i] = rigidbody.torque;
+        m_soa.inv_mass[i] = 1.f / rigidbody.mass();
+        m_soa.inv_inertia[i] = 1.f / rigidbody.inertia();
+        m_soa.step_scale[i] = static_cast<float>(rigidbody.substep_stride);
+        rigidbody.force = {0, 0};
+        rigidbody.torque = 0.f;
+    }
+    m_isTickLoaded = true;
+}
+void RigidbodySystem::m_findSteppedRanges(float resting_time_threshold, size_t substep) {
+    m_stepped_ranges.clear();
+    for (size_t i = 0; i < m_movable_bodies.size(); i++) {
+        const auto& rigidbody = *m_movable_bodies[i].first;
+        const bool isStepped = substep % rigidbody.substep_stride == 0;
+        if (isStepped && rigidbody.time_resting > resting_time_threshold) {
+            // forces of resting bodies are consumed as well
+            m_soa.force_x[i] = m_soa.force_y[i] = m_soa.torque[i] = 0.f;
+            continue;
+        }
+        if (!isStepped) {
             continue;
-        auto& transform = getComponent<Transform>(entity);
-        rigidbody.velocity_pre_solve = rigidbody.velocity;
-        rigidbody.velocity = (transform.position - rigidbody.prev_pos) / delT;
-        rigidbody.ang_velocity_pre_solve = rigidbody.angular_velocity;
-        rigidbody.angular_velocity = (transform.rotation - rigidbody.prev_rot) / delT;
+        }
+        if (!m_stepped_ranges.empty() && m_stepped_ranges.back().second == i) {
+            m_stepped_ranges.back().second++;
+        } else {
+            m_stepped_ranges.push_back({i, i + 1});
+        }
+    }
+}
+void RigidbodySystem::integrate(float delT, float resting_time_threshold, size_t substep) {
+    if (!m_isTickLoaded) {
+        m_loadTick();
+    }
+    m_findSteppedRanges(resting_time_threshold, substep);
+    for (auto [begin, end] : m_stepped_ranges) {
+        // solver moved bodies and changed velocities since the last substep
+        for (size_t i = begin; i < end; i++) {
+            const auto& rigidbody = *m_movable_bodies[i].first;
+            const auto& transform = *m_movable_bodies[i].second;
+            m_soa.pos_x[i] = transform.position.x;
+            m_soa.pos_y[i] = transform.position.y;
+            m_soa.rot[i] = transform.rotation;
+            m_soa.vel_x[i] = rigidbody.velocity.x;
+            m_soa.vel_y[i] = rigidbody.velocity.y;
+            m_soa.ang_vel[i] = rigidbody.angular_velocity;
+        }
+        integrateSoA(m_soa, delT, begin, end);
+        // forces are consumed by the first integration
+        std::fill(m_soa.force_x.begin() + begin, m_soa.force_x.begin() + end, 0.f);
+        std::fill(m_soa.force_y.begin() + begin, m_soa.force_y.begin() + end, 0.f);
+        std::fill(m_soa.torque.begin() + begin, m_soa.torque.begin() + end, 0.f);
+        // integrated velocities stay here until deriveVelocities,
+        // the positional solver only reads positions
+        for (size_t i = begin; i < end; i++) {
+            auto& rigidbody = *m_movable_bodies[i].first;
+            auto& transform = *m_movable_bodies[i].second;
+            rigidbody.prev_pos = {m_soa.prev_pos_x[i], m_soa.prev_pos_y[i]};
+            rigidbody.prev_rot = m_soa.prev_rot[i];
+            transform.position = {m_soa.pos_x[i], m_soa.pos_y[i]};
+            transform.rotation = m_soa.rot[i];
+        }
+    }
+}
+void RigidbodySystem::deriveVelocities(float delT) {
+    for (auto [begin, end] : m_stepped_ranges) {
+        for (size_t i = begin; i < end; i++) {
+            auto& rigidbody = *m_movable_bodies[i].first;
+            const auto& transform = *m_movable_bodies[i].second;
+            rigidbody.velocity_pre_solve = {m_soa.vel_x[i], m_soa.vel_y[i]};
+            rigidbody.ang_velocity_pre_solve = m_soa.ang_vel[i];
+            m_soa.pos_x[i] = transform.position.x;
+            m_soa.pos_y[i] = transform.position.y;
+            m_soa.rot[i] = transform.rotation;
+        }
+        deriveVelocitiesSoA(m_soa, delT, begin, end);
+        for (size_t i = begin; i < end; i++) {
+            auto& rigidbody = *m_movable_bodies[i].first;
+            rigidbody.velocity = {m_soa.vel_x[i], m_soa.vel_y[i]};
+            rigidbody.angular_velocity = m_soa.ang_vel[i];
+        }
     }
 }
 }; // namespace emp
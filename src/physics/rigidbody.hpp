@@ -1,5 +1,6 @@
 #ifndef EMP_RIGIDBODY_HPP
 #define EMP_RIGIDBODY_HPP
+#include <vector>
 #include "math/math_defs.hpp"
 #include "scene/transform.hpp"
 namespace emp {
@@ -11,16 +12,25 @@ class Rigidbody {
 
     float prev_rot = 0.f;
     float ang_velocity_pre_solve = 0.f;
+
+    float real_density = 1.f;
+    // automatic mass is recalculated from collider only when set
+    bool m_isMassDirty = true;
 public:
     float real_inertia = 1.f;
     float real_mass = 1.f;
-    float real_density = 1.f;
 
     bool isStatic = false;
     bool isRotationLocked = false;
 
     float time_resting = 0.f;
     bool useAutomaticMass = true;
+    // always swept against other bodies, for projectiles that can start slow,
+    // bodies moving fast relative to their size are swept regardless
+    bool useContinuousCollision = false;
+    // set by physics for every tick, body is only stepped on every
+    // substep_stride-th substep, covering that many substeps at once
+    uint32_t substep_stride = 1;
 
     vec2f velocity = vec2f(0.f, 0.f);
     vec2f force = vec2f(0.f, 0.f);
@@ -48,16 +58,82 @@ public:
     }
     float generalizedInverseMass(vec2f radius, vec2f normal) const;
 
+    inline float density() const {
+        return real_density;
+    }
+    inline void setDensity(float density) {
+        real_density = density;
+        m_isMassDirty = true;
+    }
+    // call after changing the shape of collider or enabling automatic mass
+    inline void invalidateMass() {
+        m_isMassDirty = true;
+    }
+
     Rigidbody() {}
     Rigidbody(bool is_static, bool is_rot_locked = false, bool use_automatic_mass = true, float density = 1.f);
     friend RigidbodySystem;
 };
+// solver state of gathered bodies laid out for the vectorized kernels,
+// masses, forces and previous positions are kept for a whole tick
+struct RigidbodySoA {
+    std::vector<float> pos_x, pos_y, rot;
+    std::vector<float> prev_pos_x, prev_pos_y, prev_rot;
+    std::vector<float> vel_x, vel_y, ang_vel;
+    std::vector<float> force_x, force_y, torque;
+    std::vector<float> inv_mass, inv_inertia;
+    // number of substeps a body advances at once, 1 unless resized otherwise
+    std::vector<float> step_scale;
+
+    size_t size() const {
+        return pos_x.size();
+    }
+    void resize(size_t size);
+};
+// widest instruction set the kernels may use, Best picks what the cpu supports
+enum class eSimdLevel {
+    Scalar,
+    SSE,
+    AVX,
+    Best
+};
+eSimdLevel supportedSimdLevel();
+// vel += delT * force * inv_mass, prev_pos = pos, pos += vel * delT * step_scale
+void integrateSoA(RigidbodySoA& bodies, float delT, size_t begin, size_t end, eSimdLevel level = eSimdLevel::Best);
+inline void integrateSoA(RigidbodySoA& bodies, float delT) {
+    integrateSoA(bodies, delT, 0, bodies.size());
+}
+// vel = (pos - prev_pos) / (delT * step_scale)
+void deriveVelocitiesSoA(RigidbodySoA& bodies, float delT, size_t begin, size_t end, eSimdLevel level = eSimdLevel::Best);
+inline void deriveVelocitiesSoA(RigidbodySoA& bodies, float delT) {
+    deriveVelocitiesSoA(bodies, delT, 0, bodies.size());
+}
+
 class RigidbodySystem : public System<Transform, Rigidbody> {
+    // slots of m_soa, sorted by substep_stride once per tick
+    std::vector<std::pair<Rigidbody*, Transform*>> m_movable_bodies;
+    // slots stepped in the current substep
+    std::vector<std::pair<size_t, size_t>> m_stepped_ranges;
+    RigidbodySoA m_soa;
+    bool m_isTickLoaded = false;
+
+    // loads forces, masses and strides, set after bodies were gathered
+    void m_loadTick();
+    void m_findSteppedRanges(float resting_time_threshold, size_t substep);
+    void m_updateMass(Entity entity, Rigidbody& rigidbody);
 public:
+    // caches components of non static bodies that are not resting longer than
+    // threshold, pointers are invalidated when any entity is destroyed so it
+    // has to be called again before integrating,
+    // also recalculates invalidated automatic masses
+    void gatherBodies(float restingTimeThreshold = INFINITY);
     //if resting_time in rigidbody is bigger than threshold it is considered not moving
-    void integrate(float delT, float restingTimeThreshold = INFINITY);
-    void deriveVelocities(float delT, float restingTimeThreshold = INFINITY);
-    void updateMasses();
+    //accumulated force and torque of gathered bodies are consumed by the first call after gathering
+    //only bodies whose substep_stride divides substep are stepped, by delT * substep_stride
+    //positions are written to transforms, integrated velocities only by deriveVelocities
+    void integrate(float delT, float restingTimeThreshold = INFINITY, size_t substep = 0);
+    // steps the same bodies as the last integrate
+    void deriveVelocities(float delT);
 };
 }; // namespace emp
 #endif
@@ -0,0 +1,256 @@
+#include "sand_world.hpp"
+#include <cassert>
+namespace emp {
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13U;
+    state ^= state >> 17U;
+    state ^= state << 5U;
+    return state;
+}
+void SandWorld::DirtyRect::include(int first_x, int first_y, int last_x, int last_y) {
+    auto lower = [](std::atomic<int>& bound, int value) {
+        int current = bound.load(std::memory_order_relaxed);
+        while (value < current && !bound.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    };
+    auto raise = [](std::atomic<int>& bound, int value) {
+        int current = bound.load(std::memory_order_relaxed);
+        while (value > current && !bound.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    };
+    lower(min_x, first_x);
+    lower(min_y, first_y);
+    raise(max_x, last_x);
+    raise(max_y, last_y);
+}
+void SandWorld::DirtyRect::reset() {
+    min_x = min_y = INT32_MAX;
+    max_x = max_y = INT32_MIN;
+}
+SandWorld::SandWorld(int width, int height, ThreadPool& thread_pool)
+    : m_width(width), m_height(height), m_thread_pool(thread_pool) {
+    assert(width > 0 && height > 0);
+    m_chunks_x = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    m_chunks_y = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    m_chunks = std::vector<Chunk>(static_cast<size_t>(m_chunks_x) * m_chunks_y);
+    m_cells.assign(static_cast<size_t>(width) * height, Cell{EMPTY, 0, 0});
+    m_pixels.assign(m_cells.size(), SandColor{});
+
+    m_materials.push_back(SandMaterial{});
+    m_materials.push_back(SandMaterial{eSandBehaviour::Static, 0, 0, {110, 108, 112, 255}, 40});
+    m_materials.push_back(SandMaterial{eSandBehaviour::Powder, 150, 0, {220, 188, 110, 255}, 50});
+    m_materials.push_back(SandMaterial{eSandBehaviour::Liquid, 100, 5, {48, 110, 220, 220}, 20});
+    m_materials.push_back(SandMaterial{eSandBehaviour::Liquid, 80, 3, {70, 52, 30, 240}, 15});
+    m_materials.push_back(SandMaterial{eSandBehaviour::Gas, 1, 3, {130, 130, 130, 140}, 40});
+    assert(m_materials.size() == BUILTIN_MATERIAL_COUNT);
+}
+uint8_t SandWorld::addMaterial(const SandMaterial& material) {
+    assert(m_materials.size() < 256U && "materials are stored in a byte");
+    assert(material.dispersion <= MAX_REACH && "cells can not move further than MAX_REACH in one step");
+    m_materials.push_back(material);
+    return static_cast<uint8_t>(m_materials.size() - 1U);
+}
+uint8_t SandWorld::get(int x, int y) const {
+    if (!m_isInside(x, y)) {
+        return EMPTY;
+    }
+    return m_cells[static_cast<size_t>(y) * m_width + x].material;
+}
+void SandWorld::set(int x, int y, uint8_t material) {
+    assert(m_isInside(x, y) && material < m_materials.size());
+    auto& cell = m_at(x, y);
+    cell.material = material;
+    cell.shade = static_cast<uint8_t>(nextRandom(m_random_state));
+    // not marked as moved in the next step
+    cell.clock = static_cast<uint8_t>(m_step);
+    m_wake(x, y);
+    m_paint(x, y);
+    m_changed_first_row = std::min(m_changed_first_row, y);
+    m_changed_last_row = std::max(m_changed_last_row, y + 1);
+}
+void SandWorld::fill(int x, int y, int width, int height, uint8_t material) {
+    for (int cy = std::max(y, 0); cy < std::min(y + height, m_height); cy++) {
+        for (int cx = std::max(x, 0); cx < std::min(x + width, m_width); cx++) {
+            set(cx, cy, material);
+        }
+    }
+}
+size_t SandWorld::activeChunkCount() const {
+    size_t result = 0;
+    for (const auto& chunk : m_chunks) {
+        if (chunk.next.min_x <= chunk.next.max_x) {
+            result++;
+        }
+    }
+    return result;
+}
+std::pair<int, int> SandWorld::takeChangedRows() {
+    std::pair<int, int> result = {0, 0};
+    if (m_changed_first_row < m_changed_last_row) {
+        result = {m_changed_first_row, m_changed_last_row};
+    }
+    m_changed_first_row = INT32_MAX;
+    m_changed_last_row = INT32_MIN;
+    return result;
+}
+void SandWorld::m_wake(int x, int y) {
+    const int first_x = std::max(x - 1, 0);
+    const int first_y = std::max(y - 1, 0);
+    const int last_x = std::min(x + 1, m_width - 1);
+    const int last_y = std::min(y + 1, m_height - 1);
+    for (int cy = first_y / CHUNK_SIZE; cy <= last_y / CHUNK_SIZE; cy++) {
+        for (int cx = first_x / CHUNK_SIZE; cx <= last_x / CHUNK_SIZE; cx++) {
+            m_chunks[cy * m_chunks_x + cx].next.include(
+                    std::max(first_x, cx * CHUNK_SIZE), std::max(first_y, cy * CHUNK_SIZE),
+                    std::min(last_x, cx * CHUNK_SIZE + CHUNK_SIZE - 1), std::min(last_y, cy * CHUNK_SIZE + CHUNK_SIZE - 1)
+            );
+        }
+    }
+}
+void SandWorld::m_paint(int x, int y) {
+    const auto& cell = m_at(x, y);
+    const auto& mat = m_materials[cell.material];
+    const uint32_t darken = 255U - cell.shade * mat.color_variation / 255U;
+    auto& pixel = m_pixels[static_cast<size_t>(y) * m_width + x];
+    pixel.red = static_cast<uint8_t>(mat.color.red * darken / 255U);
+    pixel.green = static_cast<uint8_t>(mat.color.green * darken / 255U);
+    pixel.blue = static_cast<uint8_t>(mat.color.blue * darken / 255U);
+    pixel.alpha = mat.color.alpha;
+}
+bool SandWorld::m_tryMove(int x, int y, int to_x, int to_y, uint8_t clock) {
+    if (!m_isInside(to_x, to_y)) {
+        return false;
+    }
+    auto& from = m_at(x, y);
+    auto& to = m_at(to_x, to_y);
+    if (to.material != EMPTY) {
+        const auto& mover = m_materials[from.material];
+        const auto& target = m_materials[to.material];
+        const bool isTargetFluid = target.behaviour == eSandBehaviour::Liquid || target.behaviour == eSandBehaviour::Gas;
+        // heavier cells sink, lighter gases rise through heavier ones
+        const bool isDisplacing = isTargetFluid && to.clock != clock &&
+                                  ((to_y > y && target.density < mover.density) ||
+                                   (to_y < y && mover.behaviour == eSandBehaviour::Gas &&
+                                    target.behaviour == eSandBehaviour::Gas && target.density > mover.density));
+        if (!isDisplacing) {
+            return false;
+        }
+    }
+    std::swap(from, to);
+    from.clock = clock;
+    to.clock = clock;
+    m_wake(x, y);
+    m_wake(to_x, to_y);
+    return true;
+}
+bool SandWorld::m_tryFlow(int x, int y, int dir, uint8_t clock) {
+    const auto& mat = m_materials[m_at(x, y).material];
+    const int fall_dir = mat.behaviour == eSandBehaviour::Gas ? -1 : 1;
+    int distance = 0;
+    for (int step = 1; step <= mat.dispersion; step++) {
+        const int to_x = x + dir * step;
+        if (!m_isInside(to_x, y) || m_at(to_x, y).material != EMPTY) {
+            break;
+        }
+        distance = step;
+        // stops above a gap so that it falls into it next
+        if (m_isInside(to_x, y + fall_dir) && m_at(to_x, y + fall_dir).material == EMPTY) {
+            break;
+        }
+    }
+    return distance > 0 && m_tryMove(x, y, x + dir * distance, y, clock);
+}
+void SandWorld::m_updateChunk(uint32_t chunk, uint8_t clock) {
+    const auto& area = m_chunks[chunk];
+    uint32_t random = (chunk + 1U) * 0x9E3779B9U ^ m_step * 0x85EBCA6BU;
+    random = random == 0U ? 1U : random;
+    // alternating sweeps keep liquids from drifting to one side
+    const bool isLeftToRight = (m_step & 1U) != 0U;
+    const int row_width = area.max_x - area.min_x + 1;
+    // falling cells are updated before the ones above so that columns move together
+    for (int y = area.max_y; y >= area.min_y; y--) {
+        for (int i = 0; i < row_width; i++) {
+            const int x = isLeftToRight ? area.min_x + i : area.max_x - i;
+            const auto& cell = m_at(x, y);
+            if (cell.material == EMPTY || cell.clock == clock) {
+                continue;
+            }
+            const auto& mat = m_materials[cell.material];
+            if (mat.behaviour == eSandBehaviour::Static) {
+                continue;
+            }
+            const int dir = (nextRandom(random) & 1U) != 0U ? 1 : -1;
+            const int fall = mat.behaviour == eSandBehaviour::Gas ? -1 : 1;
+            if (m_tryMove(x, y, x, y + fall, clock) || m_tryMove(x, y, x + dir, y + fall, clock) ||
+                m_tryMove(x, y, x - dir, y + fall, clock)) {
+                continue;
+            }
+            if (mat.behaviour != eSandBehaviour::Powder && !m_tryFlow(x, y, dir, clock)) {
+                m_tryFlow(x, y, -dir, clock);
+            }
+        }
+    }
+}
+template <class Task>
+void SandWorld::m_forEachChunk(const std::vector<uint32_t>& chunks, Task&& task) {
+    if (!useParallelUpdate || m_thread_pool.threadCount() == 0 || chunks.size() < 2U) {
+        for (auto chunk : chunks) {
+            task(chunk);
+        }
+        return;
+    }
+    // active chunks differ a lot in cost, so they are handed out one at a time
+    std::atomic<size_t> next = 0;
+    auto work = [&]() {
+        for (size_t i = next++; i < chunks.size(); i = next++) {
+            task(chunks[i]);
+        }
+    };
+    for (uint32_t i = 0; i < m_thread_pool.threadCount(); i++) {
+        m_thread_pool.addTask(work);
+    }
+    work();
+    m_thread_pool.waitForCompletion();
+}
+void SandWorld::step() {
+    const auto clock = static_cast<uint8_t>(++m_step);
+    // what changed during the last step is updated in this one
+    for (auto& chunk : m_chunks) {
+        chunk.min_x = chunk.next.min_x;
+        chunk.min_y = chunk.next.min_y;
+        chunk.max_x = chunk.next.max_x;
+        chunk.max_y = chunk.next.max_y;
+        chunk.next.reset();
+    }
+    for (int pass = 0; pass < 4; pass++) {
+        m_pass_chunks.clear();
+        for (int cy = pass / 2; cy < m_chunks_y; cy += 2) {
+            for (int cx = pass % 2; cx < m_chunks_x; cx += 2) {
+                const auto& chunk = m_chunks[cy * m_chunks_x + cx];
+                if (chunk.min_x <= chunk.max_x) {
+                    m_pass_chunks.push_back(static_cast<uint32_t>(cy * m_chunks_x + cx));
+                }
+            }
+        }
+        m_forEachChunk(m_pass_chunks, [&](uint32_t chunk) { m_updateChunk(chunk, clock); });
+    }
+    // every moved cell woke the area around it, so only those areas are repainted
+    m_pass_chunks.clear();
+    for (uint32_t i = 0; i < m_chunks.size(); i++) {
+        const auto& next = m_chunks[i].next;
+        if (next.min_x <= next.max_x) {
+            m_pass_chunks.push_back(i);
+            m_changed_first_row = std::min(m_changed_first_row, next.min_y.load());
+            m_changed_last_row = std::max(m_changed_last_row, next.max_y.load() + 1);
+        }
+    }
+    m_forEachChunk(m_pass_chunks, [&](uint32_t chunk) {
+        const auto& next = m_chunks[chunk].next;
+        for (int y = next.min_y; y <= next.max_y; y++) {
+            for (int x = next.min_x; x <= next.max_x; x++) {
+                m_paint(x, y);
+            }
+        }
+    });
+}
+}; // namespace emp
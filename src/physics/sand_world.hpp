@@ -0,0 +1,150 @@
+#ifndef EMP_SAND_WORLD_HPP
+#define EMP_SAND_WORLD_HPP
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "compute/multithreading/thread_pool.hpp"
+namespace emp {
+// laid out like TextureAsset::Pixel so that pixels can be uploaded as they are
+struct SandColor {
+    uint8_t red = 0;
+    uint8_t green = 0;
+    uint8_t blue = 0;
+    uint8_t alpha = 0;
+};
+enum class eSandBehaviour : uint8_t {
+    Static,
+    // falls and slides down diagonally
+    Powder,
+    // falls and flows sideways
+    Liquid,
+    // rises and flows sideways
+    Gas,
+};
+struct SandMaterial {
+    eSandBehaviour behaviour = eSandBehaviour::Static;
+    // falling powders and liquids swap places with lighter liquids and gases
+    uint8_t density = 0;
+    // cells a liquid or gas can flow sideways in one step
+    uint8_t dispersion = 0;
+    SandColor color;
+    // every cell is darkened by a random part of this when it is created
+    uint8_t color_variation = 0;
+};
+/**
+ * cellular automaton of falling sand, liquids and gases simulated on the cpu
+ *
+ * the world is split into chunks that remember the area in which cells moved,
+ * only those areas are updated in the next step so that settled chunks cost
+ * nothing, chunks are updated in four passes of a checkerboard so that chunks
+ * of one pass never touch the same cells and can run in parallel
+ *
+ * y grows downwards like in the rest of the engine, pixels() is meant to be
+ * uploaded with TextureAsset::writePixels and drawn with a Sprite
+ */
+class SandWorld {
+public:
+    static constexpr int CHUNK_SIZE = 64;
+    // furthest a cell can move in one step, chunks of a pass are a chunk apart
+    static constexpr int MAX_REACH = CHUNK_SIZE / 2 - 1;
+    // materials every world starts with, ids of added ones follow
+    enum eMaterial : uint8_t { EMPTY, STONE, SAND, WATER, OIL, SMOKE, BUILTIN_MATERIAL_COUNT };
+
+    bool useParallelUpdate = true;
+
+    // returns id of the new material
+    uint8_t addMaterial(const SandMaterial& material);
+    inline const SandMaterial& material(uint8_t id) const {
+        return m_materials[id];
+    }
+    inline int width() const {
+        return m_width;
+    }
+    inline int height() const {
+        return m_height;
+    }
+    // cells outside of the world are empty
+    uint8_t get(int x, int y) const;
+    void set(int x, int y, uint8_t material);
+    void fill(int x, int y, int width, int height, uint8_t material);
+
+    void step();
+    inline uint32_t stepCount() const {
+        return m_step;
+    }
+    // chunks that will be updated by the next step
+    size_t activeChunkCount() const;
+    inline const std::vector<SandColor>& pixels() const {
+        return m_pixels;
+    }
+    // rows [first, last) that were repainted since the last call
+    std::pair<int, int> takeChangedRows();
+
+    // chunks are split among workers of thread_pool, which has to outlive the world
+    SandWorld(int width, int height, ThreadPool& thread_pool);
+    SandWorld(const SandWorld&) = delete;
+    SandWorld& operator=(const SandWorld&) = delete;
+
+private:
+    struct Cell {
+        uint8_t material;
+        uint8_t shade;
+        // low bits of the step the cell was last moved in
+        uint8_t clock;
+    };
+    // grown from any thread, inclusive bounds in world cells
+    struct DirtyRect {
+        std::atomic<int> min_x = INT32_MAX;
+        std::atomic<int> min_y = INT32_MAX;
+        std::atomic<int> max_x = INT32_MIN;
+        std::atomic<int> max_y = INT32_MIN;
+
+        void include(int first_x, int first_y, int last_x, int last_y);
+        void reset();
+    };
+    struct Chunk {
+        // area updated by the current step
+        int min_x = 0, min_y = 0, max_x = -1, max_y = -1;
+        // area that changed during the current step and is updated by the next one
+        DirtyRect next;
+    };
+    int m_width;
+    int m_height;
+    int m_chunks_x;
+    int m_chunks_y;
+    uint32_t m_step = 0;
+    std::vector<Cell> m_cells;
+    std::vector<Chunk> m_chunks;
+    std::vector<SandMaterial> m_materials;
+    std::vector<SandColor> m_pixels;
+    int m_changed_first_row = INT32_MAX;
+    int m_changed_last_row = INT32_MIN;
+    // chunks of the pass being updated
+    std::vector<uint32_t> m_pass_chunks;
+    uint32_t m_random_state = 0x9E3779B9U;
+
+    inline bool m_isInside(int x, int y) const {
+        return x >= 0 && y >= 0 && x < m_width && y < m_height;
+    }
+    inline Cell& m_at(int x, int y) {
+        return m_cells[static_cast<size_t>(y) * m_width + x];
+    }
+    // marks the cell and its neighbours to be updated in the next step
+    void m_wake(int x, int y);
+    void m_paint(int x, int y);
+    void m_updateChunk(uint32_t chunk, uint8_t clock);
+    // moves the cell if the target is free for it, both cells are marked as
+    // moved so that neither is updated again in this step
+    bool m_tryMove(int x, int y, int to_x, int to_y, uint8_t clock);
+    // slides up to dispersion cells along a row, returns whether it moved
+    bool m_tryFlow(int x, int y, int dir, uint8_t clock);
+    // runs task(chunk) for every chunk and waits for all of them
+    template <class Task>
+    void m_forEachChunk(const std::vector<uint32_t>& chunks, Task&& task);
+
+    ThreadPool& m_thread_pool;
+};
+}; // namespace emp
+#endif
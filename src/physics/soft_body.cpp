@@ -0,0 +1,308 @@
+#include "soft_body.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "core/coordinator.hpp"
+#include "physics/tilemap_collider.hpp"
+namespace emp {
+uint32_t SoftBody::addParticle(vec2f position, float mass) {
+    assert(positions.size() < MAX_PARTICLES && "soft body has too many particles");
+    assert(mass > 0.f && "particle needs positive mass");
+    positions.push_back(position);
+    velocities.push_back(vec2f(0.f, 0.f));
+    inverse_masses.push_back(std::isinf(mass) ? 0.f : 1.f / mass);
+    return static_cast<uint32_t>(positions.size() - 1U);
+}
+void SoftBody::addDistance(uint32_t a, uint32_t b, float compliance) {
+    assert(a < positions.size() && b < positions.size() && a != b);
+    m_distances.push_back({a, b, length(positions[a] - positions[b]), compliance});
+    m_isColored = false;
+}
+void SoftBody::addArea(uint32_t a, uint32_t b, uint32_t c, float compliance) {
+    assert(a < positions.size() && b < positions.size() && c < positions.size());
+    const float area = 0.5f * perp_dot(positions[b] - positions[a], positions[c] - positions[a]);
+    m_areas.push_back({a, b, c, area, compliance});
+    m_isColored = false;
+}
+AABB SoftBody::aabb() const {
+    AABB result = AABB::Expandable();
+    for (auto position : positions) {
+        result.expandToContain(position);
+    }
+    return AABB::CreateMinMax(
+            result.min - vec2f(particle_radius, particle_radius), result.max + vec2f(particle_radius, particle_radius)
+    );
+}
+SoftBody SoftBody::CreateRope(vec2f from, vec2f to, size_t segment_count, float mass, float compliance) {
+    assert(segment_count > 0);
+    SoftBody result;
+    const float particle_mass = mass / static_cast<float>(segment_count + 1U);
+    for (size_t i = 0; i <= segment_count; i++) {
+        const float t = static_cast<float>(i) / static_cast<float>(segment_count);
+        result.addParticle(from + (to - from) * t, particle_mass);
+    }
+    for (uint32_t i = 0; i < segment_count; i++) {
+        result.addDistance(i, i + 1U, compliance);
+    }
+    return result;
+}
+// particles of a columns by rows grid spanning area, row by row
+static void addGrid(SoftBody& body, const AABB& area, size_t columns, size_t rows, float mass) {
+    assert(columns > 1 && rows > 1);
+    const float particle_mass = mass / static_cast<float>(columns * rows);
+    const vec2f step = (area.max - area.min) / vec2f(columns - 1U, rows - 1U);
+    for (size_t y = 0; y < rows; y++) {
+        for (size_t x = 0; x < columns; x++) {
+            body.addParticle(area.min + step * vec2f(x, y), particle_mass);
+        }
+    }
+}
+SoftBody SoftBody::CreateCloth(const AABB& area, size_t columns, size_t rows, float mass, float compliance) {
+    SoftBody result;
+    addGrid(result, area, columns, rows, mass);
+    auto at = [&](size_t x, size_t y) { return static_cast<uint32_t>(y * columns + x); };
+    for (size_t y = 0; y < rows; y++) {
+        for (size_t x = 0; x < columns; x++) {
+            if (x + 1U < columns) {
+                result.addDistance(at(x, y), at(x + 1U, y), compliance);
+            }
+            if (y + 1U < rows) {
+                result.addDistance(at(x, y), at(x, y + 1U), compliance);
+            }
+            if (x + 1U < columns && y + 1U < rows) {
+                result.addDistance(at(x, y), at(x + 1U, y + 1U), compliance);
+                result.addDistance(at(x + 1U, y), at(x, y + 1U), compliance);
+            }
+        }
+    }
+    return result;
+}
+SoftBody SoftBody::CreateJelly(const AABB& area, size_t columns, size_t rows, float mass, float compliance) {
+    SoftBody result;
+    addGrid(result, area, columns, rows, mass);
+    auto at = [&](size_t x, size_t y) { return static_cast<uint32_t>(y * columns + x); };
+    for (size_t y = 0; y < rows; y++) {
+        for (size_t x = 0; x < columns; x++) {
+            if (x + 1U < columns) {
+                result.addDistance(at(x, y), at(x + 1U, y), compliance);
+            }
+            if (y + 1U < rows) {
+                result.addDistance(at(x, y), at(x, y + 1U), compliance);
+            }
+            if (x + 1U < columns && y + 1U < rows) {
+                result.addDistance(at(x, y), at(x + 1U, y + 1U), compliance);
+                result.addArea(at(x, y), at(x + 1U, y), at(x + 1U, y + 1U), compliance);
+                result.addArea(at(x, y), at(x + 1U, y + 1U), at(x, y + 1U), compliance);
+            }
+        }
+    }
+    return result;
+}
+SoftBodySystem::SoftBodySystem(ThreadPool& thread_pool) : m_thread_pool(thread_pool) {}
+template <class Task>
+void SoftBodySystem::m_forEachBatch(const std::vector<size_t>& offsets, Task&& task) {
+    typedef GreedyColoring<SoftBody::MAX_PARTICLES> Coloring;
+    for (size_t color = 0; color + 1U < offsets.size(); color++) {
+        const size_t begin = offsets[color];
+        const size_t end = offsets[color + 1U];
+        const bool isParallel = useParallelSolver && m_thread_pool.threadCount() != 0 &&
+                                color != Coloring::OVERFLOW_COLOR && end - begin >= MIN_PARALLEL_BATCH;
+        if (!isParallel) {
+            task(begin, end);
+            continue;
+        }
+        auto range = [&](uint32_t first, uint32_t last) { task(begin + first, begin + last); };
+        m_thread_pool.dispatch(static_cast<uint32_t>(end - begin), range);
+        m_thread_pool.waitForCompletion();
+    }
+}
+void SoftBodySystem::m_color(SoftBody& body) {
+    m_coloring.color(body.m_distances, body.m_distance_batches, [](const auto& constraint, auto&& visit) {
+        visit(constraint.a);
+        visit(constraint.b);
+    });
+    m_coloring.color(body.m_areas, body.m_area_batches, [](const auto& constraint, auto&& visit) {
+        visit(constraint.a);
+        visit(constraint.b);
+        visit(constraint.c);
+    });
+    body.m_isColored = true;
+}
+void SoftBodySystem::m_gatherObstacles(const SoftBody& body, float delT) {
+    m_obstacles.clear();
+    m_bodies.clear();
+    auto* physics = ECS().getSystem<PhysicsSystem>();
+    if (physics == nullptr || body.positions.empty()) {
+        return;
+    }
+    float max_speed = 0.f;
+    for (auto velocity : body.velocities) {
+        max_speed = std::max(max_speed, length(velocity));
+    }
+    // particles can travel this far during the update
+    const float margin = body.particle_radius + (max_speed + length(gravity) * delT) * delT;
+    auto grown = [&](const AABB& aabb, float by) {
+        return AABB::CreateMinMax(aabb.min - vec2f(by, by), aabb.max + vec2f(by, by));
+    };
+    m_proxies.clear();
+    physics->overlapProxies(grown(body.aabb(), margin), m_proxies, body.collision_mask);
+
+    auto* tilemaps = ECS().getSystem<TilemapSystem>();
+    ConvexPiece storage;
+    for (const auto& proxy : m_proxies) {
+        const auto entity = std::get<Entity>(proxy);
+        ParticleObstacle obstacle;
+        obstacle.piece = physics->worldPiece(entity, std::get<size_t>(proxy), storage);
+        obstacle.type = eShapeType::Polygon;
+        obstacle.radius = 0.f;
+        obstacle.body = ParticleObstacle::NONE;
+        const bool isTilemap = tilemaps != nullptr && tilemaps->getEntities().contains(entity);
+        if (!isTilemap) {
+            const auto& col = *ECS().getComponent<Collider>(entity);
+            auto& trans = *ECS().getComponent<Transform>(entity);
+            obstacle.type = col.type();
+            obstacle.radius = col.isRound() ? col.transformed_radius(trans) : 0.f;
+            if (!std::get<ProxyFilter>(proxy).isStatic) {
+                // pieces of one entity are reported next to each other
+                if (m_bodies.empty() || m_bodies.back().entity != entity) {
+                    m_bodies.push_back(ParticleCoupledBody{
+                            entity, ECS().getComponent<Rigidbody>(entity), &trans,
+                            transformPoint(trans.global(), vec2f(0.f, 0.f)), vec2f(0.f, 0.f), 0.f, col.isNonMoving});
+                }
+                obstacle.body = static_cast<uint32_t>(m_bodies.size() - 1U);
+            }
+        }
+        obstacle.aabb = grown(AABB::CreateFromVerticies(obstacle.piece.vertices), obstacle.radius + margin);
+        m_obstacles.push_back(std::move(obstacle));
+    }
+}
+void SoftBodySystem::m_solveDistances(SoftBody& body, float delT) {
+    const float inv_sq_dt = 1.f / (delT * delT);
+    vec2f* positions = body.positions.data();
+    const float* inverse_masses = body.inverse_masses.data();
+    const auto* constraints = body.m_distances.data();
+    m_forEachBatch(body.m_distance_batches, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const auto& constraint = constraints[i];
+            const float w1 = inverse_masses[constraint.a];
+            const float w2 = inverse_masses[constraint.b];
+            const vec2f diff = positions[constraint.a] - positions[constraint.b];
+            const float dist = length(diff);
+            if (w1 + w2 == 0.f || dist < 1e-6f) {
+                continue;
+            }
+            const float delta_lagrange =
+                    -(dist - constraint.rest_length) / (w1 + w2 + constraint.compliance * inv_sq_dt);
+            const vec2f p = delta_lagrange * diff / dist;
+            positions[constraint.a] += w1 * p;
+            positions[constraint.b] -= w2 * p;
+        }
+    });
+}
+void SoftBodySystem::m_solveAreas(SoftBody& body, float delT) {
+    const float inv_sq_dt = 1.f / (delT * delT);
+    vec2f* positions = body.positions.data();
+    const float* inverse_masses = body.inverse_masses.data();
+    const auto* constraints = body.m_areas.data();
+    m_forEachBatch(body.m_area_batches, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const auto& constraint = constraints[i];
+            const vec2f a = positions[constraint.a];
+            const vec2f b = positions[constraint.b];
+            const vec2f c = positions[constraint.c];
+            // gradients of the signed area with respect to each corner
+            const vec2f grad_a = 0.5f * vec2f(b.y - c.y, c.x - b.x);
+            const vec2f grad_b = 0.5f * vec2f(c.y - a.y, a.x - c.x);
+            const vec2f grad_c = 0.5f * vec2f(a.y - b.y, b.x - a.x);
+            const float w1 = inverse_masses[constraint.a];
+            const float w2 = inverse_masses[constraint.b];
+            const float w3 = inverse_masses[constraint.c];
+            const float w_sum = w1 * dot(grad_a, grad_a) + w2 * dot(grad_b, grad_b) + w3 * dot(grad_c, grad_c);
+            if (w_sum == 0.f) {
+                continue;
+            }
+            const float area = 0.5f * perp_dot(b - a, c - a);
+            const float delta_lagrange = -(area - constraint.rest_area) / (w_sum + constraint.compliance * inv_sq_dt);
+            positions[constraint.a] += w1 * delta_lagrange * grad_a;
+            positions[constraint.b] += w2 * delta_lagrange * grad_b;
+            positions[constraint.c] += w3 * delta_lagrange * grad_c;
+        }
+    });
+}
+void SoftBodySystem::m_collide(SoftBody& body, float delT) {
+    for (const auto& obstacle : m_obstacles) {
+        ParticleCoupledBody* coupled = obstacle.body == ParticleObstacle::NONE ? nullptr : &m_bodies[obstacle.body];
+        for (size_t i = 0; i < body.positions.size(); i++) {
+            const float w = body.inverse_masses[i];
+            vec2f point = body.positions[i];
+            if (w == 0.f || !isOverlappingPointAABB(point, obstacle.aabb)) {
+                continue;
+            }
+            if (coupled != nullptr) {
+                // contacts already solved this update moved the body
+                point -= coupled->delta_pos;
+            }
+            vec2f normal;
+            const float depth = obstacle.penetration(body.m_start[i], point, body.particle_radius, normal);
+            if (depth <= 0.f) {
+                continue;
+            }
+            const bool isMovable = coupled != nullptr && !coupled->isDormant;
+            const vec2f correction = isMovable
+                    ? coupled->correct(point - normal * body.particle_radius, normal, depth, 1.f / w, delT)
+                    : normal * depth;
+            body.positions[i] += correction;
+            // tangential motion is cancelled up to friction times the normal correction
+            const vec2f motion = body.positions[i] - body.m_start[i];
+            const vec2f tangent = motion - normal * dot(motion, normal);
+            const float tangent_length = length(tangent);
+            if (tangent_length > 1e-6f) {
+                body.positions[i] -= tangent * std::min(1.f, body.friction * length(correction) / tangent_length);
+            }
+            // asleep bodies only start taking part from the next update
+            if (coupled != nullptr && coupled->isDormant && length(motion) / delT > PhysicsSystem::SLOW_VEL) {
+                coupled->rigidbody->time_resting = 0.f;
+            }
+        }
+    }
+}
+void SoftBodySystem::update(float delT) {
+    if (delT <= 0.f || substep_count == 0) {
+        return;
+    }
+    const float sub_dt = delT / static_cast<float>(substep_count);
+    for (auto entity : entities) {
+        auto& body = getComponent<SoftBody>(entity);
+        if (body.positions.empty()) {
+            continue;
+        }
+        if (!body.m_isColored) {
+            m_color(body);
+        }
+        m_gatherObstacles(body, delT);
+        body.m_start.resize(body.positions.size());
+        const float kept_velocity = std::max(1.f - body.damping * sub_dt, 0.f);
+        for (size_t substep = 0; substep < substep_count; substep++) {
+            for (size_t i = 0; i < body.positions.size(); i++) {
+                body.m_start[i] = body.positions[i];
+                if (body.inverse_masses[i] == 0.f) {
+                    continue;
+                }
+                body.velocities[i] = (body.velocities[i] + gravity * sub_dt) * kept_velocity;
+                body.positions[i] += body.velocities[i] * sub_dt;
+            }
+            m_solveDistances(body, sub_dt);
+            m_solveAreas(body, sub_dt);
+            m_collide(body, sub_dt);
+            for (size_t i = 0; i < body.positions.size(); i++) {
+                body.velocities[i] = body.inverse_masses[i] == 0.f
+                        ? vec2f(0.f, 0.f)
+                        : (body.positions[i] - body.m_start[i]) / sub_dt;
+            }
+        }
+        for (auto& coupled : m_bodies) {
+            coupled.apply(delT);
+        }
+    }
+}
+}; // namespace emp
@@ -0,0 +1,129 @@
+#ifndef EMP_SOFT_BODY_HPP
+#define EMP_SOFT_BODY_HPP
+#include <cstdint>
+#include <vector>
+#include "compute/multithreading/thread_pool.hpp"
+#include "core/layer.hpp"
+#include "core/system.hpp"
+#include "math/math_defs.hpp"
+#include "math/shapes/AABB.hpp"
+#include "physics/particle_contact.hpp"
+#include "physics/physics_system.hpp"
+#include "templates/graph_coloring.hpp"
+namespace emp {
+class SoftBodySystem;
+/**
+ * ropes, cloth and jelly made of particles held together by distance and
+ * area constraints, all stored in flat arrays of the component
+ *
+ * particles live in world space, the body is not moved by its Transform and
+ * reaches colliders of the physics world through a single broad phase query
+ */
+struct SoftBody {
+    static constexpr size_t MAX_PARTICLES = 4096U;
+    // keeps two particles at rest_length
+    struct DistanceConstraint {
+        uint32_t a;
+        uint32_t b;
+        float rest_length;
+        float compliance;
+    };
+    // keeps signed area of triangle a, b, c at rest_area
+    struct AreaConstraint {
+        uint32_t a;
+        uint32_t b;
+        uint32_t c;
+        float rest_area;
+        float compliance;
+    };
+    std::vector<vec2f> positions;
+    std::vector<vec2f> velocities;
+    // 0 for pinned particles
+    std::vector<float> inverse_masses;
+
+    float particle_radius = 2.f;
+    // friction coefficient between particles and colliders
+    float friction = 0.3f;
+    // part of velocity lost every second
+    float damping = 0.1f;
+    // layers of colliders particles collide with
+    LayerMask collision_mask = LayerMask().set();
+
+    // infinite mass pins the particle in place
+    uint32_t addParticle(vec2f position, float mass);
+    inline void pin(uint32_t particle) {
+        inverse_masses[particle] = 0.f;
+    }
+    // rest length and area are taken from current positions,
+    // constraints are reordered by the solver
+    void addDistance(uint32_t a, uint32_t b, float compliance = 0.f);
+    void addArea(uint32_t a, uint32_t b, uint32_t c, float compliance = 0.f);
+    inline size_t particleCount() const {
+        return positions.size();
+    }
+    inline const std::vector<DistanceConstraint>& distances() const {
+        return m_distances;
+    }
+    inline const std::vector<AreaConstraint>& areas() const {
+        return m_areas;
+    }
+    AABB aabb() const;
+
+    // chain of segment_count links, mass is spread over all particles
+    static SoftBody CreateRope(vec2f from, vec2f to, size_t segment_count, float mass, float compliance = 0.f);
+    // grid of particles with structural and shear links
+    static SoftBody CreateCloth(const AABB& area, size_t columns, size_t rows, float mass, float compliance = 0.f);
+    // grid of particles with structural links and area kept per triangle
+    static SoftBody CreateJelly(const AABB& area, size_t columns, size_t rows, float mass, float compliance = 0.f);
+
+private:
+    std::vector<DistanceConstraint> m_distances;
+    std::vector<AreaConstraint> m_areas;
+    // color offsets, rebuilt by the system after constraints were added
+    std::vector<size_t> m_distance_batches;
+    std::vector<size_t> m_area_batches;
+    bool m_isColored = false;
+    // positions at the start of the substep
+    std::vector<vec2f> m_start;
+
+    friend SoftBodySystem;
+};
+/**
+ * solves soft bodies with the compliance formulation of calcPositionalCorrection,
+ * constraints are split into colors that share no particle and big colors are
+ * solved in parallel
+ *
+ * has to be updated after PhysicsSystem with the same delta time
+ */
+class SoftBodySystem : public System<SoftBody> {
+public:
+    vec2f gravity = {0.f, 1.f};
+    // one iteration per substep, more substeps make stiffer bodies
+    size_t substep_count = 8U;
+    bool useParallelSolver = true;
+
+    // colors are split among workers of thread_pool, usually the one of PhysicsSystem
+    SoftBodySystem(ThreadPool& thread_pool);
+    void update(float delT);
+
+private:
+    static constexpr size_t MIN_PARALLEL_BATCH = 256U;
+    GreedyColoring<SoftBody::MAX_PARTICLES> m_coloring;
+    std::vector<CollidingPoly> m_proxies;
+    std::vector<ParticleObstacle> m_obstacles;
+    std::vector<ParticleCoupledBody> m_bodies;
+
+    void m_color(SoftBody& body);
+    void m_gatherObstacles(const SoftBody& body, float delT);
+    void m_solveDistances(SoftBody& body, float delT);
+    void m_solveAreas(SoftBody& body, float delT);
+    void m_collide(SoftBody& body, float delT);
+    // runs task(begin, end) over every color, big colors are split between
+    // threads, the overflow color can conflict and is run serially
+    template <class Task>
+    void m_forEachBatch(const std::vector<size_t>& offsets, Task&& task);
+
+    ThreadPool& m_thread_pool;
+};
+}; // namespace emp
+#endif
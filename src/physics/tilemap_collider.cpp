@@ -0,0 +1,145 @@
+#include "tilemap_collider.hpp"
+#include <array>
+#include <cassert>
+namespace emp {
+TilemapCollider::TilemapCollider(int width, int height, float tile_size)
+    : m_width(width), m_height(height), m_tile_size(tile_size) {
+    assert(width > 0 && height > 0 && tile_size > 0.f);
+    m_tiles.assign(static_cast<size_t>(width) * height, 0);
+    m_chunks_x = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const int chunks_y = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    m_chunks.resize(static_cast<size_t>(m_chunks_x) * chunks_y);
+}
+bool TilemapCollider::isSolid(int x, int y) const {
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height) {
+        return false;
+    }
+    return m_tiles[y * m_width + x] != 0;
+}
+void TilemapCollider::setSolid(int x, int y, bool isSolid) {
+    assert(x >= 0 && y >= 0 && x < m_width && y < m_height);
+    auto& tile = m_tiles[y * m_width + x];
+    if ((tile != 0) == isSolid) {
+        return;
+    }
+    tile = isSolid;
+    m_chunks[(y / CHUNK_SIZE) * m_chunks_x + x / CHUNK_SIZE].isDirty = true;
+}
+void TilemapCollider::fill(int x, int y, int width, int height, bool isSolid) {
+    for (int ty = y; ty < y + height; ty++) {
+        for (int tx = x; tx < x + width; tx++) {
+            setSolid(tx, ty, isSolid);
+        }
+    }
+}
+const ConvexPiece& TilemapCollider::worldPiece(size_t piece) const {
+    return m_chunks[piece / MAX_CHUNK_PIECES].world_pieces[piece % MAX_CHUNK_PIECES];
+}
+// grows runs of solid tiles along x first and then along y as long as
+// whole rows of the run are solid, every tile ends up in exactly one rect
+void TilemapCollider::m_mergeChunk(size_t chunk) {
+    const int first_x = static_cast<int>(chunk % m_chunks_x) * CHUNK_SIZE;
+    const int first_y = static_cast<int>(chunk / m_chunks_x) * CHUNK_SIZE;
+    const int width = std::min(CHUNK_SIZE, m_width - first_x);
+    const int height = std::min(CHUNK_SIZE, m_height - first_y);
+    std::array<bool, MAX_CHUNK_PIECES> isUsed{};
+    auto isFree = [&](int x, int y) {
+        return !isUsed[y * CHUNK_SIZE + x] && isSolid(first_x + x, first_y + y);
+    };
+    auto& rects = m_chunks[chunk].rects;
+    rects.clear();
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (!isFree(x, y)) {
+                continue;
+            }
+            int run_width = 1;
+            while (x + run_width < width && isFree(x + run_width, y)) {
+                run_width++;
+            }
+            int run_height = 1;
+            auto isRowFree = [&](int row) {
+                for (int i = x; i < x + run_width; i++) {
+                    if (!isFree(i, row)) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            while (y + run_height < height && isRowFree(y + run_height)) {
+                run_height++;
+            }
+            for (int ry = y; ry < y + run_height; ry++) {
+                for (int rx = x; rx < x + run_width; rx++) {
+                    isUsed[ry * CHUNK_SIZE + rx] = true;
+                }
+            }
+            rects.push_back({first_x + x, first_y + y, run_width, run_height});
+        }
+    }
+}
+vec2f TilemapCollider::m_toWorld(vec2f model) const {
+    return m_origin + m_axis_x * model.x + m_axis_y * model.y;
+}
+AABB TilemapCollider::m_worldBounds(int min_x, int min_y, int max_x, int max_y) const {
+    const vec2f min = vec2f(min_x, min_y) * m_tile_size;
+    const vec2f max = vec2f(max_x, max_y) * m_tile_size;
+    AABB result = AABB::Expandable();
+    for (auto corner : {min, max, vec2f(min.x, max.y), vec2f(max.x, min.y)}) {
+        result.expandToContain(m_toWorld(corner));
+    }
+    return result;
+}
+void TilemapCollider::m_bakeChunk(size_t chunk) {
+    auto& data = m_chunks[chunk];
+    data.world_pieces.resize(data.rects.size());
+    data.world_aabbs.resize(data.rects.size());
+    for (size_t i = 0; i < data.rects.size(); i++) {
+        const auto& rect = data.rects[i];
+        const vec2f min = vec2f(rect.x, rect.y) * m_tile_size;
+        const vec2f max = vec2f(rect.x + rect.width, rect.y + rect.height) * m_tile_size;
+        // same order as pieces of colliders
+        data.world_pieces[i] = ConvexPiece({
+                m_toWorld(vec2f(min.x, max.y)),
+                m_toWorld(max),
+                m_toWorld(vec2f(max.x, min.y)),
+                m_toWorld(min),
+        });
+        data.world_aabbs[i] = AABB::CreateFromVerticies(data.world_pieces[i].vertices);
+    }
+}
+void TilemapSystem::update(std::vector<AABB>& changed_areas) {
+    for (auto entity : entities) {
+        auto& tilemap = getComponent<TilemapCollider>(entity);
+        const auto& mat = getComponent<Transform>(entity).global();
+        const vec2f origin = transformPoint(mat, vec2f(0.f, 0.f));
+        const vec2f axis_x = transformPoint(mat, vec2f(1.f, 0.f)) - origin;
+        const vec2f axis_y = transformPoint(mat, vec2f(0.f, 1.f)) - origin;
+        const bool isMoved = origin != tilemap.m_origin || axis_x != tilemap.m_axis_x ||
+                             axis_y != tilemap.m_axis_y;
+        if (isMoved) {
+            changed_areas.push_back(tilemap.m_worldBounds(0, 0, tilemap.m_width, tilemap.m_height));
+            tilemap.m_origin = origin;
+            tilemap.m_axis_x = axis_x;
+            tilemap.m_axis_y = axis_y;
+            changed_areas.push_back(tilemap.m_worldBounds(0, 0, tilemap.m_width, tilemap.m_height));
+        }
+        for (size_t chunk = 0; chunk < tilemap.m_chunks.size(); chunk++) {
+            auto& data = tilemap.m_chunks[chunk];
+            if (!data.isDirty && !isMoved) {
+                continue;
+            }
+            if (data.isDirty) {
+                tilemap.m_mergeChunk(chunk);
+                data.isDirty = false;
+                const int x = static_cast<int>(chunk % tilemap.m_chunks_x) * TilemapCollider::CHUNK_SIZE;
+                const int y = static_cast<int>(chunk / tilemap.m_chunks_x) * TilemapCollider::CHUNK_SIZE;
+                changed_areas.push_back(tilemap.m_worldBounds(
+                        x, y, x + TilemapCollider::CHUNK_SIZE, y + TilemapCollider::CHUNK_SIZE
+                ));
+            }
+            tilemap.m_bakeChunk(chunk);
+        }
+    }
+}
+}; // namespace emp
@@ -0,0 +1,146 @@
+#ifndef EMP_TILEMAP_COLLIDER_HPP
+#define EMP_TILEMAP_COLLIDER_HPP
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "core/system.hpp"
+#include "math/geometry_func.hpp"
+#include "math/math_defs.hpp"
+#include "math/shapes/AABB.hpp"
+#include "scene/transform.hpp"
+namespace emp {
+class TilemapSystem;
+/**
+ * static collision geometry of a grid of square tiles
+ *
+ * tile (x, y) covers [x, x + 1] * tile_size by [y, y + 1] * tile_size in model
+ * space, solid tiles of every chunk are merged into few rectangles that are only
+ * rebuilt when a tile of the chunk changes
+ *
+ * the entity also needs a static Rigidbody, a Material and a default
+ * constructed Collider that provides its layer
+ */
+struct TilemapCollider {
+    static constexpr int CHUNK_SIZE = 16;
+    // piece index of rect r in chunk c is c * MAX_CHUNK_PIECES + r
+    static constexpr size_t MAX_CHUNK_PIECES = CHUNK_SIZE * CHUNK_SIZE;
+    // solid tiles merged into one rectangle, in tiles
+    struct Rect {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+private:
+    struct Chunk {
+        std::vector<Rect> rects;
+        // rects baked with the transform of the tilemap
+        std::vector<ConvexPiece> world_pieces;
+        std::vector<AABB> world_aabbs;
+        bool isDirty = true;
+    };
+    int m_width = 0;
+    int m_height = 0;
+    float m_tile_size = 1.f;
+    int m_chunks_x = 0;
+    std::vector<uint8_t> m_tiles;
+    std::vector<Chunk> m_chunks;
+    // transform chunks were baked with, model space axes in world space
+    vec2f m_origin = vec2f(0.f, 0.f);
+    vec2f m_axis_x = vec2f(0.f, 0.f);
+    vec2f m_axis_y = vec2f(0.f, 0.f);
+
+    void m_mergeChunk(size_t chunk);
+    void m_bakeChunk(size_t chunk);
+    vec2f m_toWorld(vec2f model) const;
+    // world space bounds of tiles in [min, max)
+    AABB m_worldBounds(int min_x, int min_y, int max_x, int max_y) const;
+public:
+    inline int width() const {
+        return m_width;
+    }
+    inline int height() const {
+        return m_height;
+    }
+    inline float tile_size() const {
+        return m_tile_size;
+    }
+    // tiles outside of the map are empty
+    bool isSolid(int x, int y) const;
+    void setSolid(int x, int y, bool isSolid);
+    void fill(int x, int y, int width, int height, bool isSolid);
+
+    inline size_t chunkCount() const {
+        return m_chunks.size();
+    }
+    inline const std::vector<Rect>& rects(size_t chunk) const {
+        return m_chunks[chunk].rects;
+    }
+    // only valid after TilemapSystem::update
+    const ConvexPiece& worldPiece(size_t piece) const;
+    // calls visit(piece index, world AABB) for every rect that overlaps area,
+    // only chunks covering area are looked at
+    template <class Visitor>
+    void forEachPieceIn(const AABB& area, Visitor&& visit) const;
+
+    TilemapCollider() {}
+    TilemapCollider(int width, int height, float tile_size);
+    friend TilemapSystem;
+};
+// keeps merged rects and baked pieces of tilemaps up to date
+class TilemapSystem : public System<Transform, TilemapCollider> {
+public:
+    // merges dirty chunks and bakes them into world space, moved tilemaps are
+    // baked again whole, world bounds of what changed are appended to changed_areas
+    void update(std::vector<AABB>& changed_areas);
+    // calls visit(entity, piece index, world AABB) for every rect of every
+    // tilemap that overlaps area
+    template <class Visitor>
+    void forEachPieceIn(const AABB& area, Visitor&& visit) const {
+        for (auto entity : entities) {
+            getComponent<TilemapCollider>(entity).forEachPieceIn(area, [&](size_t piece, const AABB& aabb) {
+                visit(entity, piece, aabb);
+            });
+        }
+    }
+};
+
+template <class Visitor>
+void TilemapCollider::forEachPieceIn(const AABB& area, Visitor&& visit) const {
+    const float det = perp_dot(m_axis_x, m_axis_y);
+    if (m_chunks.empty() || det == 0.f) {
+        return;
+    }
+    // area is brought into model space where chunks are a regular grid
+    AABB local = AABB::Expandable();
+    for (auto corner : {area.min, area.max, vec2f(area.min.x, area.max.y), vec2f(area.max.x, area.min.y)}) {
+        const vec2f offset = corner - m_origin;
+        local.expandToContain(vec2f(perp_dot(offset, m_axis_y), perp_dot(m_axis_x, offset)) / det);
+    }
+    const int chunks_y = static_cast<int>(m_chunks.size()) / m_chunks_x;
+    const float chunk_extent = static_cast<float>(CHUNK_SIZE) * m_tile_size;
+    // clamped before the conversion so that huge areas stay in range
+    auto chunkRange = [&](float min, float max, int count) {
+        const float last = static_cast<float>(count - 1);
+        return std::make_pair(
+                static_cast<int>(std::clamp(floorf(min / chunk_extent), 0.f, last + 1.f)),
+                static_cast<int>(std::clamp(floorf(max / chunk_extent), -1.f, last))
+        );
+    };
+    const auto [first_x, last_x] = chunkRange(local.min.x, local.max.x, m_chunks_x);
+    const auto [first_y, last_y] = chunkRange(local.min.y, local.max.y, chunks_y);
+    for (int cy = first_y; cy <= last_y; cy++) {
+        for (int cx = first_x; cx <= last_x; cx++) {
+            const size_t chunk = cy * m_chunks_x + cx;
+            const auto& aabbs = m_chunks[chunk].world_aabbs;
+            for (size_t i = 0; i < aabbs.size(); i++) {
+                if (isOverlappingAABBAABB(area, aabbs[i])) {
+                    visit(chunk * MAX_CHUNK_PIECES + i, aabbs[i]);
+                }
+            }
+        }
+    }
+}
+}; // namespace emp
+#endif
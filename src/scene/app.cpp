@@ -12,6 +12,8 @@
 #include "vulkan/buffer.hpp"
 #include "io/keyboard_controller.hpp"
 #include "physics/collider.hpp"
+#include "physics/fluid_system.hpp"
+#include "physics/soft_body.hpp"
 #include "physics/rigidbody.hpp"
 #include "scene/register_scene_types.hpp"
 #include "scene_defs.hpp"
@@ -79,12 +81,6 @@ void App::run() {
     ECS.addComponent(viewer_object, Transform({0.f, 0.f}));
     // viewerObject.transform.translation.z = -2.5f;
 
-    auto& physics_sys = *ECS.getSystem<PhysicsSystem>();
-    auto& transform_sys = *ECS.getSystem<TransformSystem>();
-    auto& rigidbody_sys = *ECS.getSystem<RigidbodySystem>();
-    auto& constraint_sys = *ECS.getSystem<ConstraintSystem>();
-    auto& collider_sys = *ECS.getSystem<ColliderSystem>();
-
     auto& sprite_sys = *ECS.getSystem<SpriteSystem>();
 
 #if EMP_ENABLE_RENDER_THREAD || EMP_ENABLE_PHYSICS_THREAD
@@ -145,27 +141,9 @@ void App::run() {
 #endif
         }
 #if not EMP_ENABLE_PHYSICS_THREAD
-
         static Stopwatch physics_clock;
-        float physics_time = physics_clock.getElapsedTime();
         physics_clock.restart();
-        if(physics_time < 1.f / m_physics_tick_rate) {
-            const float sleep_duration =
-                    (1.f / m_physics_tick_rate - physics_time);
-            auto duration = std::chrono::nanoseconds(
-                    static_cast<long long>(floorf(1e9 * sleep_duration))
-            );
-            std::this_thread::sleep_for(duration);
-        }
-        onFixedUpdate(delta_time, window, controller);
-        rigidbody_sys.updateMasses();
-        physics_sys.update(
-                transform_sys,
-                collider_sys,
-                rigidbody_sys,
-                constraint_sys,
-                delta_time
-        );
+        m_advancePhysics(delta_time);
         gui_manager.addPhysicsTime(physics_clock.restart());
 #endif
 #if not EMP_ENABLE_RENDER_THREAD
@@ -217,14 +195,53 @@ std::unique_ptr<std::thread> App::createRenderThread(
 void App::setPhysicsTickrate(const float tick_rate) {
     m_physics_tick_rate = tick_rate;
 }
+void App::m_advancePhysics(float delta_time) {
+    auto& physics_sys = *ECS.getSystem<PhysicsSystem>();
+    auto& transform_sys = *ECS.getSystem<TransformSystem>();
+    auto& rigidbody_sys = *ECS.getSystem<RigidbodySystem>();
+    auto& collider_sys = *ECS.getSystem<ColliderSystem>();
+    auto& constraint_sys = *ECS.getSystem<ConstraintSystem>();
+    auto* fluid_sys = ECS.getSystem<FluidSystem>();
+    auto* soft_body_sys = ECS.getSystem<SoftBodySystem>();
+
+    const float fixed_delta_time = 1.f / m_physics_tick_rate;
+    m_physics_time_accumulator += delta_time;
+    int tick_count = 0;
+    while (m_physics_time_accumulator >= fixed_delta_time) {
+        if (tick_count == MAX_PHYSICS_TICKS_PER_FRAME) {
+            // falling behind, simulation slows down instead of every
+            // frame taking longer than the one before
+            EMP_LOG_INTERVAL(WARNING, 5.f) << "physics can not keep up, dropping "
+                                           << m_physics_time_accumulator << "s";
+            m_physics_time_accumulator = 0.f;
+            break;
+        }
+        transform_sys.savePrevious();
+        onFixedUpdate(fixed_delta_time, window, controller);
+        physics_sys.update(
+                transform_sys,
+                collider_sys,
+                rigidbody_sys,
+                constraint_sys,
+                fixed_delta_time
+        );
+        if (fluid_sys != nullptr) {
+            fluid_sys->update(fixed_delta_time);
+        }
+        if (soft_body_sys != nullptr) {
+            soft_body_sys->update(fixed_delta_time);
+        }
+        m_physics_time_accumulator -= fixed_delta_time;
+        tick_count++;
+    }
+    m_since_physics_clock.restart();
+}
+float App::m_interpolationAlpha() {
+    const float elapsed = m_physics_time_accumulator + m_since_physics_clock.getElapsedTime();
+    return std::fmin(elapsed * m_physics_tick_rate, 1.f);
+}
 std::unique_ptr<std::thread> App::createPhysicsThread() {
     return std::move(std::make_unique<std::thread>([&]() {
-        auto& physics_sys = *ECS.getSystem<PhysicsSystem>();
-        auto& transform_sys = *ECS.getSystem<TransformSystem>();
-        auto& rigidbody_sys = *ECS.getSystem<RigidbodySystem>();
-        auto& collider_sys = *ECS.getSystem<ColliderSystem>();
-        auto& constraint_sys = *ECS.getSystem<ConstraintSystem>();
-
         Stopwatch clock;
         auto last_sleep_duration = std::chrono::nanoseconds(0);
         while (isAppRunning) {
@@ -251,15 +268,7 @@ std::unique_ptr<std::thread> App::createPhysicsThread() {
             }
             m_isPhysics_waiting = false;
 
-            onFixedUpdate(delta_time, window, controller);
-            rigidbody_sys.updateMasses();
-            physics_sys.update(
-                    transform_sys,
-                    collider_sys,
-                    rigidbody_sys,
-                    constraint_sys,
-                    delta_time
-            );
+            m_advancePhysics(delta_time);
             gui_manager.addPhysicsTime(delta_time);
             EMP_LOG_INTERVAL(DEBUG2, 5.f)
                     << "{physics thread}: " << 1.f / delta_time << " TPS";
@@ -322,10 +331,11 @@ void App::renderFrame(
             auto& animated_sprite_sys = *ECS.getSystem<AnimatedSpriteSystem>();
 
             // models_sys->updateBuffer(frameIndex);
-            sprite_sys.updateBuffer(frame_index);
-            model_sys.updateBuffer(frame_index);
+            const float interpolation = m_interpolationAlpha();
+            sprite_sys.updateBuffer(frame_index, interpolation);
+            model_sys.updateBuffer(frame_index, interpolation);
             animated_sprite_sys.updateTransitions(delta_time);
-            animated_sprite_sys.updateBuffer(frame_index);
+            animated_sprite_sys.updateBuffer(frame_index, interpolation);
             {
                 renderer.beginSwapChainRenderPass(command_buffer);
 
@@ -20,6 +20,7 @@
 #include "io/window.hpp"
 #include "math/math_defs.hpp"
 #include "physics/physics_system.hpp"
+#include "utils/time.hpp"
 namespace emp {
 class App {
 public:
@@ -74,7 +75,12 @@ private:
     std::atomic<bool> m_isRenderer_waiting = false;
     std::atomic<bool> m_isPhysics_waiting = false;
 
-    std::atomic<float> m_physics_tick_rate = INFINITY;
+    std::atomic<float> m_physics_tick_rate = 60.f;
+    // physics is advanced in fixed ticks, time that did not add up to a whole
+    // tick is carried over and used to interpolate rendered transforms
+    static constexpr int MAX_PHYSICS_TICKS_PER_FRAME = 4;
+    float m_physics_time_accumulator = 0.f;
+    Stopwatch m_since_physics_clock;
     std::atomic<bool> isAppRunning = true;
 
     RendererContext renderer_context;
@@ -90,6 +96,11 @@ private:
         Buffer& uboBuffer,
         Buffer& computeUboBuffer);
     void loadAssets();
+    // runs as many fixed ticks as fit into the accumulated time,
+    // has to be called with access to the coordinator
+    void m_advancePhysics(float delta_time);
+    // part of a tick that passed since the last one, in range [0, 1]
+    float m_interpolationAlpha();
 
     void renderFrame(
             Camera& camera,
@@ -8,9 +8,11 @@
 #include "graphics/sprite_system.hpp"
 #include "io/keyboard_controller.hpp"
 #include "physics/collider.hpp"
+#include "physics/fluid_system.hpp"
 #include "physics/material.hpp"
 #include "physics/physics_system.hpp"
 #include "physics/rigidbody.hpp"
+#include "physics/soft_body.hpp"
 #include "scene/behaviour.hpp"
 
 namespace emp {
@@ -29,7 +31,10 @@ void registerSceneSystems(Device& device, Coordinator& ECS) {
     ECS.registerSystem<RigidbodySystem>();
     ECS.registerSystem<ColliderSystem>();
     ECS.registerSystem<ConstraintSystem>();
-    ECS.registerSystem<PhysicsSystem>();
+    ECS.registerSystem<TilemapSystem>();
+    auto& physics_sys = ECS.registerSystem<PhysicsSystem>();
+    ECS.registerSystem<FluidSystem>(std::ref(physics_sys.threadPool()));
+    ECS.registerSystem<SoftBodySystem>(std::ref(physics_sys.threadPool()));
 
     ECS.registerSystem<ParticleSystem>();
     ECS.registerSystem<SpriteSystem>(std::ref(device));
@@ -11,6 +11,8 @@
 #include "physics/constraint.hpp"
 #include "physics/material.hpp"
 #include "physics/physics_system.hpp"
+#include "physics/soft_body.hpp"
+#include "physics/tilemap_collider.hpp"
 #include "scene/behaviour.hpp"
 #include "scene/transform.hpp"
 #include "templates/type_pack.hpp"
@@ -23,6 +25,8 @@ namespace emp {
         Material,
         Collider,
         Rigidbody,
+        TilemapCollider,
+        SoftBody,
         Model,
         ParticleEmitter,
         Sprite,
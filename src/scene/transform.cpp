@@ -50,6 +50,19 @@ float Transform::m_getRotation(const TransformMatrix& mat) const {
     float r = atan2(normalizedmat[0][1], normalizedmat[0][0]);
     return r;
 }
+TransformMatrix Transform::interpolated(float alpha) const {
+    if(alpha >= 1.f || !m_isPreviousValid) {
+        return m_global_transform;
+    }
+    // change within a single tick is small enough for blending columns,
+    // unlike decomposing it keeps mirrored scales intact
+    TransformMatrix result;
+    for(int i = 0; i < 4; i++) {
+        result[i] = m_previous_global_transform[i] +
+                    (m_global_transform[i] - m_previous_global_transform[i]) * alpha;
+    }
+    return result;
+}
 vec2f Transform::getGlobalPosition() {
     return m_getPosition(m_global_transform);
 }
@@ -84,6 +97,11 @@ EMP_DEBUGCALL(
         transform.m_updateLocalTransform();
         transform.m_global_transform =
                 transform.m_parents_global_transform * transform.m_local_transform;
+        // new entities have nothing to be interpolated from
+        if(!transform.m_isPreviousValid) {
+            transform.m_previous_global_transform = transform.m_global_transform;
+            transform.m_isPreviousValid = true;
+        }
 EMP_DEBUGCALL(
         updated_entities[entity] = true;
 )
@@ -96,6 +114,14 @@ EMP_DEBUGCALL(
                              << ", because of invalid parent";
         }
     })
+}
+void TransformSystem::savePrevious() {
+    for(auto entity : entities) {
+        auto& transform = getComponent<Transform>(entity);
+        if(transform.m_isPreviousValid) {
+            transform.m_previous_global_transform = transform.m_global_transform;
+        }
+    }
 }
     // for (auto entity : entities) {
     //     auto& trans = getComponent<Transform>(entity);
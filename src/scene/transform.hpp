@@ -13,6 +13,9 @@ class Transform {
     TransformMatrix m_local_transform;
     TransformMatrix m_parents_global_transform = TransformMatrix(1.f);
     TransformMatrix m_global_transform;
+    // global transform before the last fixed tick, used for render interpolation
+    TransformMatrix m_previous_global_transform;
+    bool m_isPreviousValid = false;
 
     void m_updateLocalTransform();
 
@@ -44,6 +47,9 @@ public:
     inline const TransformMatrix& global() const {
         return m_global_transform;
     }
+    // blends global transforms of the last two fixed ticks,
+    // alpha of 1 returns the current one
+    TransformMatrix interpolated(float alpha) const;
     Transform() {
     }
     Transform(
@@ -65,6 +71,9 @@ class TransformSystem : public System<Transform> {
 public:
     void performDFS(std::function<void(Entity, Transform&)>&& action);
     void update();
+    // has to be called before every fixed tick so that renderers
+    // can interpolate between the last two
+    void savePrevious();
     void onEntityRemoved(Entity entity) override final;
     void onEntityAdded(Entity entity) override final;
     
@@ -1,30 +1,19 @@
 #ifndef EMP_DISJOINT_SET_HPP
 #define EMP_DISJOINT_SET_HPP
-#include <stack>
-#include <vector>
-#include "debug/log.hpp"
+#include <utility>
 namespace emp {
+// union find that can only grow its groups, groups that have to be split
+// again are handled by IslandGraph
 template<std::size_t Size>
 struct DisjointSet {
     int parent[Size];
-    int rank[Size] {0};
-    void isolate(int element) {
-        int group_head = group(element);
-        rank[group_head] -= 1;
-        rank[element] = 0;
-        parent[element] = element;
-    }
+    int size[Size];
+    // halves the path on the way up so no extra storage is needed
     int group(int element) {
-        std::stack<int> to_correct;
         while(parent[element] != element) {
-            to_correct.push(element);
+            parent[element] = parent[parent[element]];
             element = parent[element];
         }
-        while(!to_correct.empty()) {
-            auto idx = to_correct.top();
-            parent[idx] = element;
-            to_correct.pop();
-        }
         return element;
     }
     bool isHead(int element) {
@@ -35,18 +24,21 @@ struct DisjointSet {
         int group2 = group(element2);
         if(group1 == group2)
             return;
+        if(size[group1] < size[group2])
+            std::swap(group1, group2);
 
-        int bigger_group  = (rank[group1] > rank[group2] ? group1 : group2);
-        int smaller_group = (bigger_group == group1 ? group2 : group1);
-
-        rank[bigger_group] += rank[smaller_group] + 1;
-        parent[smaller_group] = bigger_group;
+        size[group1] += size[group2];
+        parent[group2] = group1;
     }
-    DisjointSet() {
-        for(int i = 0; i < Size; i++) {
+    void reset() {
+        for(int i = 0; i < static_cast<int>(Size); i++) {
             parent[i] = i;
+            size[i] = 1;
         }
     }
+    DisjointSet() {
+        reset();
+    }
 
 };
 };
@@ -0,0 +1,86 @@
+#ifndef EMP_GRAPH_COLORING_HPP
+#define EMP_GRAPH_COLORING_HPP
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+namespace emp {
+// greedy coloring of items (constraints, contacts) that reference elements
+// (bodies), no two items of the same color share an element so every color
+// can be processed in parallel
+template <std::size_t Size>
+class GreedyColoring {
+public:
+    static constexpr std::size_t MAX_COLORS = 64;
+    // items that did not fit into any other color end up here,
+    // this color can contain conflicting items and has to be processed serially
+    static constexpr std::size_t OVERFLOW_COLOR = MAX_COLORS - 1;
+
+    /**
+     * reorders items so that items of one color are adjacent
+     * @param for_each_element callable (const T&, Visitor) that calls Visitor
+     * with every element index referenced by item
+     * @param offsets filled so that color c spans [offsets[c], offsets[c + 1]),
+     * empty colors are trimmed from the back
+     */
+    template <class T, class ForEachElement>
+    void color(
+            std::vector<T>& items,
+            std::vector<std::size_t>& offsets,
+            ForEachElement&& for_each_element
+    ) {
+        m_item_colors.resize(items.size());
+        std::array<std::size_t, MAX_COLORS + 1> counts{};
+        for (std::size_t i = 0; i < items.size(); i++) {
+            uint64_t used = 0;
+            for_each_element(items[i], [&](std::size_t element) {
+                used |= m_used_colors[element];
+            });
+            std::size_t color = std::countr_one(used);
+            if (color >= OVERFLOW_COLOR) {
+                color = OVERFLOW_COLOR;
+            }
+            for_each_element(items[i], [&](std::size_t element) {
+                if (m_used_colors[element] == 0) {
+                    m_touched.push_back(element);
+                }
+                m_used_colors[element] |= (uint64_t(1) << color);
+            });
+            m_item_colors[i] = color;
+            counts[color + 1]++;
+        }
+        for (auto element : m_touched) {
+            m_used_colors[element] = 0;
+        }
+        m_touched.clear();
+
+        std::size_t color_count = MAX_COLORS;
+        while (color_count > 0 && counts[color_count] == 0) {
+            color_count--;
+        }
+        for (std::size_t c = 1; c <= MAX_COLORS; c++) {
+            counts[c] += counts[c - 1];
+        }
+        offsets.assign(counts.begin(), counts.begin() + color_count + 1);
+
+        // stable counting sort keeps the original order inside of a color
+        m_sorted.resize(items.size());
+        for (std::size_t i = 0; i < items.size(); i++) {
+            m_sorted[counts[m_item_colors[i]]++] = i;
+        }
+        std::vector<T> reordered;
+        reordered.reserve(items.size());
+        for (auto idx : m_sorted) {
+            reordered.push_back(std::move(items[idx]));
+        }
+        items.swap(reordered);
+    }
+
+private:
+    std::array<uint64_t, Size> m_used_colors{};
+    std::vector<std::size_t> m_touched;
+    std::vector<uint8_t> m_item_colors;
+    std::vector<std::size_t> m_sorted;
+};
+}; // namespace emp
+#endif // EMP_GRAPH_COLORING_HPP
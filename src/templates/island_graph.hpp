@@ -0,0 +1,196 @@
+#ifndef EMP_ISLAND_GRAPH_HPP
+#define EMP_ISLAND_GRAPH_HPP
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "templates/free_list.hpp"
+namespace emp {
+// persistent graph of nodes (bodies) connected by edges (contacts, joints),
+// islands merge as soon as an edge is added, removing an edge only marks
+// its island and islands are split lazily when split() is called
+template <std::size_t Size>
+class IslandGraph {
+public:
+    static constexpr int NONE = -1;
+
+    // head of the island of node, halves the path on the way up
+    int find(int node) {
+        while (m_parent[node] != node) {
+            m_parent[node] = m_parent[m_parent[node]];
+            node = m_parent[node];
+        }
+        return node;
+    }
+    bool isConnected(int node1, int node2) {
+        return find(node1) == find(node2);
+    }
+    int islandSize(int node) {
+        return m_size[find(node)];
+    }
+    // calls visit with every node of the island of node, node included,
+    // the graph must not be modified while visiting
+    template <class Visitor>
+    void forEachInIsland(int node, Visitor&& visit) const {
+        int current = node;
+        do {
+            visit(current);
+            current = m_next[current];
+        } while (current != node);
+    }
+    template <class Visitor>
+    void forEachNeighbour(int node, Visitor&& visit) const {
+        for (int edge = m_first_edge[node]; edge != NONE;) {
+            const auto& e = m_edges[edge];
+            const int side = m_sideOf(e, node);
+            visit(e.nodes[1 - side]);
+            edge = e.next[side];
+        }
+    }
+    bool hasEdge(int node1, int node2) const {
+        return m_findEdge(node1, node2) != NONE;
+    }
+    // adding an already present edge does nothing
+    void addEdge(int node1, int node2) {
+        if (node1 == node2 || hasEdge(node1, node2)) {
+            return;
+        }
+        const int edge = m_edges.insert(Edge{{node1, node2}, {NONE, NONE}, {NONE, NONE}});
+        m_linkEdge(edge, 0);
+        m_linkEdge(edge, 1);
+        m_merge(node1, node2);
+    }
+    void removeEdge(int node1, int node2) {
+        const int edge = m_findEdge(node1, node2);
+        if (edge == NONE) {
+            return;
+        }
+        m_removeEdge(edge);
+        m_dirty.push_back(node1);
+    }
+    // removes every edge of node and detaches it from its island right away,
+    // so the node can be reused before the next split()
+    void removeNode(int node) {
+        while (m_first_edge[node] != NONE) {
+            m_removeEdge(m_first_edge[node]);
+        }
+        if (m_next[node] != node) {
+            m_splitIsland(node);
+        }
+    }
+    // rebuilds islands that lost an edge since the last call
+    void split() {
+        for (auto& node : m_dirty) {
+            node = find(node);
+        }
+        std::sort(m_dirty.begin(), m_dirty.end());
+        m_dirty.erase(std::unique(m_dirty.begin(), m_dirty.end()), m_dirty.end());
+        for (auto head : m_dirty) {
+            m_splitIsland(head);
+        }
+        m_dirty.clear();
+    }
+    void reset() {
+        for (int i = 0; i < static_cast<int>(Size); i++) {
+            m_parent[i] = i;
+            m_size[i] = 1;
+            m_next[i] = i;
+            m_first_edge[i] = NONE;
+        }
+        m_edges.clear();
+        m_dirty.clear();
+    }
+    IslandGraph() {
+        reset();
+    }
+
+private:
+    // edges are linked into a list of each of their nodes
+    struct Edge {
+        std::array<int, 2> nodes;
+        std::array<int, 2> next;
+        std::array<int, 2> prev;
+    };
+    static int m_sideOf(const Edge& edge, int node) {
+        return edge.nodes[0] == node ? 0 : 1;
+    }
+    int m_findEdge(int node1, int node2) const {
+        for (int edge = m_first_edge[node1]; edge != NONE;) {
+            const auto& e = m_edges[edge];
+            const int side = m_sideOf(e, node1);
+            if (e.nodes[1 - side] == node2) {
+                return edge;
+            }
+            edge = e.next[side];
+        }
+        return NONE;
+    }
+    void m_linkEdge(int edge, int side) {
+        auto& e = m_edges[edge];
+        const int node = e.nodes[side];
+        const int first = m_first_edge[node];
+        e.prev[side] = NONE;
+        e.next[side] = first;
+        if (first != NONE) {
+            auto& f = m_edges[first];
+            f.prev[m_sideOf(f, node)] = edge;
+        }
+        m_first_edge[node] = edge;
+    }
+    void m_unlinkEdge(int edge, int side) {
+        auto& e = m_edges[edge];
+        const int node = e.nodes[side];
+        if (e.prev[side] != NONE) {
+            auto& p = m_edges[e.prev[side]];
+            p.next[m_sideOf(p, node)] = e.next[side];
+        } else {
+            m_first_edge[node] = e.next[side];
+        }
+        if (e.next[side] != NONE) {
+            auto& n = m_edges[e.next[side]];
+            n.prev[m_sideOf(n, node)] = e.prev[side];
+        }
+    }
+    void m_removeEdge(int edge) {
+        m_unlinkEdge(edge, 0);
+        m_unlinkEdge(edge, 1);
+        m_edges.erase(edge);
+    }
+    void m_merge(int node1, int node2) {
+        int head1 = find(node1);
+        int head2 = find(node2);
+        if (head1 == head2) {
+            return;
+        }
+        if (m_size[head1] < m_size[head2]) {
+            std::swap(head1, head2);
+        }
+        m_parent[head2] = head1;
+        m_size[head1] += m_size[head2];
+        // swapping successors of two separate rings splices them into one
+        std::swap(m_next[node1], m_next[node2]);
+    }
+    // every member becomes its own island and is merged back along its edges
+    void m_splitIsland(int node) {
+        m_members.clear();
+        forEachInIsland(node, [&](int member) { m_members.push_back(member); });
+        for (auto member : m_members) {
+            m_parent[member] = member;
+            m_size[member] = 1;
+            m_next[member] = member;
+        }
+        for (auto member : m_members) {
+            forEachNeighbour(member, [&](int other) { m_merge(member, other); });
+        }
+    }
+
+    std::array<int, Size> m_parent;
+    std::array<int, Size> m_size;
+    // members of an island form a ring so it can be walked without a search
+    std::array<int, Size> m_next;
+    std::array<int, Size> m_first_edge;
+    FreeList<Edge> m_edges;
+    std::vector<int> m_dirty;
+    std::vector<int> m_members;
+};
+}; // namespace emp
+#endif // EMP_ISLAND_GRAPH_HPP
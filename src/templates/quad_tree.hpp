@@ -38,12 +38,30 @@ public:
         remove(m_root, m_box, value);
     }
 
+    // appends to values instead of allocating
+    void query(const AABB& box, std::vector<T>& values) const
+    {
+        query(m_root, m_box, box, values);
+    }
     std::vector<T> query(const AABB& box) const
     {
         auto values = std::vector<T>();
         query(m_root, m_box, box, values);
         return values;
     }
+    // appends values whose aabb is crossed by segment from ray_origin to ray_origin + ray_dir,
+    // only nodes along the segment are visited
+    void queryRay(vec2f ray_origin, vec2f ray_dir, std::vector<T>& values) const
+    {
+        queryRay(m_root, m_box, ray_origin, ray_dir, values);
+    }
+    // calls visit(const T&) with values of every node whose box is accepted by
+    // overlaps(const AABB&), values are not filtered, nothing is allocated
+    template<class Overlaps, class Visit>
+    void traverse(Overlaps&& overlaps, Visit&& visit) const
+    {
+        traverse(m_root, m_box, overlaps, visit);
+    }
     void update(T value) {
         // auto itr = _locations.find(value);
         // if(itr != _locations.end()) {
@@ -61,7 +79,16 @@ public:
 
     std::vector<std::pair<T, T>> findAllIntersections() const
     {
-        return findAllIntersections(m_root);
+        std::vector<std::pair<T, T>> intersections;
+        auto accept_all = [](const T&, const T&) { return true; };
+        findAllIntersections(m_root, intersections, accept_all);
+        return intersections;
+    }
+    // appends only pairs accepted by filter(const T&, const T&)
+    template<class Filter>
+    void findAllIntersections(std::vector<std::pair<T, T>>& intersections, Filter&& filter) const
+    {
+        findAllIntersections(m_root, intersections, filter);
     }
 
     AABB getAABB() const 
@@ -363,9 +390,47 @@ private:
         }
     }
 
+    void queryRay(int node_idx, const AABB& box, vec2f ray_origin, vec2f ray_dir, std::vector<T>& values) const
+    {
+        assert(node_idx != invalid);
+        int elem_idx = m_nodes[node_idx].first_elem;
+        while(elem_idx != invalid) {
+            const auto& value = m_elements[elem_idx].value;
+            if (segmentEntryTimeAABB(ray_origin, ray_dir, m_getAABB(value)) <= 1.f)
+                values.push_back(value);
+            elem_idx = m_elements[elem_idx].next;
+        }
+        if (!isLeaf(node_idx)) {
+            for (int i = 0; i < 4; i++) {
+                auto childAABB = computeAABB(box, static_cast<int>(i));
+                auto child_idx = m_nodes[node_idx].first_child + i;
+                if (segmentEntryTimeAABB(ray_origin, ray_dir, childAABB) <= 1.f)
+                    queryRay(child_idx, childAABB, ray_origin, ray_dir, values);
+            }
+        }
+    }
+
+    template<class Overlaps, class Visit>
+    void traverse(int node_idx, const AABB& box, Overlaps& overlaps, Visit& visit) const
+    {
+        assert(node_idx != invalid);
+        if (!overlaps(box))
+            return;
+        for (int elem_idx = m_nodes[node_idx].first_elem; elem_idx != invalid;
+             elem_idx = m_elements[elem_idx].next) {
+            visit(m_elements[elem_idx].value);
+        }
+        if (!isLeaf(node_idx)) {
+            for (int i = 0; i < 4; i++) {
+                traverse(m_nodes[node_idx].first_child + i, computeAABB(box, i), overlaps, visit);
+            }
+        }
+    }
+
+    template<class Filter>
     void searchIntersecionsInNode(int node_idx, int node_depth,
         std::vector<std::pair<T, T>>& intersections,
-        std::array<int, max_depth>& parent_stack) const
+        std::array<int, max_depth>& parent_stack, Filter& filter) const
     {
         if(node_idx == invalid)
             return;
@@ -378,7 +443,7 @@ private:
             {
                 const auto& value2 = m_elements[elem2_idx].value;
 
-                if (isOverlappingAABBAABB(m_getAABB(value1), m_getAABB(value2)))
+                if (filter(value1, value2) && isOverlappingAABBAABB(m_getAABB(value1), m_getAABB(value2)))
                     intersections.emplace_back(value1, value2);
 
                 elem2_idx = m_elements[elem2_idx].next;
@@ -394,7 +459,7 @@ private:
                 int elem2_idx = m_nodes[node_idx].first_elem;
                 while(elem2_idx != invalid) {
                     const auto& value2 = m_elements[elem2_idx].value;
-                    if (isOverlappingAABBAABB(m_getAABB(value1), m_getAABB(value2)))
+                    if (filter(value1, value2) && isOverlappingAABBAABB(m_getAABB(value1), m_getAABB(value2)))
                         intersections.emplace_back(value1, value2);
                     elem2_idx = m_elements[elem2_idx].next;
                 }
@@ -402,13 +467,13 @@ private:
             }
         }
     }
-    std::vector<std::pair<T, T>> findAllIntersections(int root_idx) const 
+    template<class Filter>
+    void findAllIntersections(int root_idx, std::vector<std::pair<T, T>>& intersections, Filter& filter) const
     {
         struct NodeInfo {
             int index;
             int depth;
         };
-        std::vector<std::pair<T, T>> intersections;
 
         std::stack<NodeInfo> to_process;
         std::array<int, max_depth> parent_stack;
@@ -418,7 +483,7 @@ private:
             to_process.pop();
             if(node.index == invalid)
                 continue;;
-            searchIntersecionsInNode(node.index, node.depth, intersections, parent_stack);
+            searchIntersecionsInNode(node.index, node.depth, intersections, parent_stack, filter);
             if(isLeaf(node.index))
                 continue;
             parent_stack[node.depth] = node.index;
@@ -430,7 +495,6 @@ private:
                  to_process.push({first_child_idx + i, node.depth + 1});
             }
         }
-        return intersections;
     }
 };
 
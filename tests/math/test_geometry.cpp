@@ -19,4 +19,235 @@ TEST(GeometryTest, Overlaps) {
     ASSERT_TRUE(isOverlappingPointPoly(vec2f(-1.5, -3), poly.getVertecies()));
 }
 TEST(GeometryTest, Intersection) {
+    EXPECT_NEAR(segmentEntryTimeAABB({-10, 5}, {20, 0}, AABB::CreateMinMax({0, 0}, {10, 10})), 0.5f, 1e-5f);
+    EXPECT_EQ(segmentEntryTimeAABB({-10, 5}, {5, 0}, AABB::CreateMinMax({0, 0}, {10, 10})), INFINITY);
+    // axis aligned segment lying outside of the slab
+    EXPECT_EQ(segmentEntryTimeAABB({-10, 20}, {40, 0}, AABB::CreateMinMax({0, 0}, {10, 10})), INFINITY);
+
+    std::vector<vec2f> box = {{-20, -20}, {-20, 20}, {20, 20}, {20, -20}};
+    auto face = intersectRayConvex({-40, 0}, {80, 0}, ConvexPiece(box));
+    ASSERT_TRUE(face.detected);
+    EXPECT_NEAR(face.time_hit, 0.25f, 1e-5f);
+    EXPECT_NEAR(face.contact_normal.x, -1.f, 1e-5f);
+    EXPECT_FALSE(intersectRayConvex({-40, 0}, {10, 0}, ConvexPiece(box)).detected);
+    EXPECT_FALSE(intersectRayConvex({-40, 30}, {80, 0}, ConvexPiece(box)).detected);
+    auto inside = intersectRayConvex({0, 0}, {80, 0}, ConvexPiece(box));
+    ASSERT_TRUE(inside.detected);
+    EXPECT_EQ(inside.time_hit, 0.f);
+
+    auto circle = intersectRayCircle({0, -30}, {0, 60}, Circle({0, 0}, 10.f));
+    ASSERT_TRUE(circle.detected);
+    EXPECT_NEAR(circle.time_hit, 1.f / 3.f, 1e-5f);
+    EXPECT_NEAR(circle.contact_normal.y, -1.f, 1e-5f);
+    // circle behind the segment
+    EXPECT_FALSE(intersectRayCircle({0, 30}, {0, 60}, Circle({0, 0}, 10.f)).detected);
+
+    Capsule capsule({-10, 0}, {10, 0}, 5.f);
+    auto side = intersectRayCapsule({0, -20}, {0, 40}, capsule);
+    ASSERT_TRUE(side.detected);
+    EXPECT_NEAR(side.contact_point.y, -5.f, 1e-4f);
+    auto end = intersectRayCapsule({-30, 0}, {40, 0}, capsule);
+    ASSERT_TRUE(end.detected);
+    EXPECT_NEAR(end.contact_point.x, -15.f, 1e-4f);
+    EXPECT_NEAR(end.contact_normal.x, -1.f, 1e-4f);
+}
+TEST(GeometryTest, ContactManifold) {
+    auto box = [](vec2f center, float half) {
+        return std::vector<vec2f>{
+                center + vec2f(-half, -half), center + vec2f(-half, half),
+                center + vec2f(half, half), center + vec2f(half, -half)};
+    };
+    auto resting = intersectPolygonPolygon(box({0, 0}, 20.f), box({5, 39.5f}, 20.f));
+    ASSERT_TRUE(resting.detected);
+    ASSERT_EQ(resting.point_count, 2);
+    for (int i = 0; i < resting.point_count; i++) {
+        const auto& point = resting.points[i];
+        EXPECT_NEAR(point.depth, 0.5f, 1e-4f);
+        EXPECT_NEAR(point.point1.y, 20.f, 1e-4f);
+        EXPECT_NEAR(point.point2.y, 19.5f, 1e-4f);
+        // clipped to the part where both faces overlap
+        EXPECT_GE(point.point1.x, -15.f - 1e-4f);
+        EXPECT_LE(point.point1.x, 20.f + 1e-4f);
+    }
+    EXPECT_NE(resting.points[0].feature_id, resting.points[1].feature_id);
+
+    // same features touching after a small slide keep their ids
+    auto slid = intersectPolygonPolygon(box({0, 0}, 20.f), box({6, 39.5f}, 20.f));
+    ASSERT_EQ(slid.point_count, 2);
+    EXPECT_EQ(slid.points[0].feature_id, resting.points[0].feature_id);
+    EXPECT_EQ(slid.points[1].feature_id, resting.points[1].feature_id);
+
+    // corner hitting a face only gives a single point
+    std::vector<vec2f> diamond = {{0, -10}, {-10, 0}, {0, 10}, {10, 0}};
+    for (auto& v : diamond) {
+        v += vec2f(0, 29.f);
+    }
+    auto corner = intersectPolygonPolygon(box({0, 0}, 20.f), diamond);
+    ASSERT_TRUE(corner.detected);
+    EXPECT_EQ(corner.point_count, 1);
+    EXPECT_NEAR(corner.points[0].depth, 1.f, 1e-4f);
+}
+TEST(GeometryTest, SeparatingAxisCache) {
+    auto box = [](vec2f center, float half) {
+        return ConvexPiece({
+                center + vec2f(-half, -half), center + vec2f(-half, half),
+                center + vec2f(half, half), center + vec2f(half, -half)});
+    };
+    uint32_t axis = 0;
+    EXPECT_FALSE(intersectPolygonPolygon(box({0, 0}, 10.f), box({25.f, 3.f}, 10.f), axis).detected);
+    const uint32_t found = axis;
+    // cached axis still separates so it is kept
+    EXPECT_FALSE(intersectPolygonPolygon(box({0, 0}, 10.f), box({24.f, 5.f}, 10.f), axis).detected);
+    EXPECT_EQ(axis, found);
+
+    auto touching = intersectPolygonPolygon(box({0, 0}, 10.f), box({19.f, 3.f}, 10.f), axis);
+    ASSERT_TRUE(touching.detected);
+    EXPECT_NEAR(touching.overlap, 1.f, 1e-4f);
+    EXPECT_NEAR(std::abs(touching.contact_normal.x), 1.f, 1e-4f);
+    EXPECT_EQ(touching.point_count, 2);
+}
+TEST(GeometryTest, RoundShapes) {
+    auto circles = collideCircleCircle(Circle({0, 0}, 10.f), Circle({0, 18.f}, 10.f));
+    ASSERT_TRUE(circles.detected);
+    EXPECT_NEAR(circles.overlap, 2.f, 1e-4f);
+    EXPECT_NEAR(circles.contact_normal.y, -1.f, 1e-4f);
+    EXPECT_FALSE(collideCircleCircle(Circle({0, 0}, 10.f), Circle({0, 21.f}, 10.f)).detected);
+
+    std::vector<vec2f> box = {{-20, -20}, {-20, 20}, {20, 20}, {20, -20}};
+    auto on_face = collideCirclePolygon(Circle({0, -29.f}, 10.f), ConvexPiece(box));
+    ASSERT_TRUE(on_face.detected);
+    EXPECT_NEAR(on_face.overlap, 1.f, 1e-4f);
+    EXPECT_NEAR(on_face.cp2.y, -20.f, 1e-4f);
+    // near the corner but outside of the rounded reach
+    EXPECT_FALSE(collideCirclePolygon(Circle({28.f, -28.f}, 10.f), ConvexPiece(box)).detected);
+
+    // capsule lying on a face touches with both ends
+    auto lying = collideCapsulePolygon(Capsule({-10, -29.f}, {10, -29.f}, 10.f), ConvexPiece(box));
+    ASSERT_TRUE(lying.detected);
+    ASSERT_EQ(lying.point_count, 2);
+    EXPECT_NEAR(lying.points[0].depth, 1.f, 1e-4f);
+    EXPECT_NEAR(lying.points[1].depth, 1.f, 1e-4f);
+    auto flipped_lying = flipped(lying);
+    EXPECT_NEAR(flipped_lying.contact_normal.y, -lying.contact_normal.y, 1e-4f);
+
+    auto parallel = collideCapsuleCapsule(
+            Capsule({-10, 0}, {10, 0}, 5.f), Capsule({0, 9.f}, {20, 9.f}, 5.f)
+    );
+    ASSERT_TRUE(parallel.detected);
+    EXPECT_EQ(parallel.point_count, 2);
+    EXPECT_NEAR(parallel.overlap, 1.f, 1e-4f);
+}
+TEST(GeometryTest, RoundMassProperties) {
+    auto circle = calculateMassInertiaArea(Circle({0, 0}, 2.f));
+    EXPECT_NEAR(circle.area, fEMP_PI * 4.f, 1e-3f);
+    EXPECT_NEAR(circle.MMOI, circle.mass * 2.f, 1e-3f);
+
+    // zero length capsule is a circle
+    auto degenerate = calculateMassInertiaArea(Capsule({0, 0}, {0, 0}, 2.f));
+    EXPECT_NEAR(degenerate.MMOI, circle.MMOI, 1e-3f);
+
+    // compared against a finely sampled polygon outline
+    std::vector<vec2f> outline;
+    const int segments = 64;
+    for (int i = 0; i < segments; i++) {
+        float angle = fEMP_PI / 2.f - fEMP_PI * i / (segments - 1);
+        outline.push_back(vec2f(5.f, 0.f) + vec2f(cosf(angle), sinf(angle)) * 2.f);
+    }
+    for (int i = 0; i < segments; i++) {
+        float angle = -fEMP_PI / 2.f - fEMP_PI * i / (segments - 1);
+        outline.push_back(vec2f(-5.f, 0.f) + vec2f(cosf(angle), sinf(angle)) * 2.f);
+    }
+    auto sampled = calculateMassInertiaArea(outline);
+    auto capsule = calculateMassInertiaArea(Capsule({-5.f, 0.f}, {5.f, 0.f}, 2.f));
+    EXPECT_NEAR(capsule.area, sampled.area, sampled.area * 1e-3f);
+    EXPECT_NEAR(capsule.MMOI, sampled.MMOI, sampled.MMOI * 1e-3f);
+}
+TEST(GeometryTest, RayPackets) {
+    // every lane has to agree with the single segment routines
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> coord(-60.f, 60.f);
+    const auto aabb = AABB::CreateMinMax({-20, -10}, {25, 30});
+    const ConvexPiece piece({{-20, -20}, {-20, 20}, {10, 25}, {25, 0}, {10, -20}});
+    for (int iteration = 0; iteration < 200; iteration++) {
+        RayPacket packet;
+        for (size_t lane = 0; lane < RayPacket::WIDTH; lane++) {
+            packet.origin_x[lane] = coord(gen);
+            packet.origin_y[lane] = coord(gen);
+            packet.dir_x[lane] = lane == 3 ? 0.f : coord(gen) * 2.f;
+            packet.dir_y[lane] = coord(gen) * 2.f;
+            packet.max_time[lane] = 1.f;
+        }
+        float times[RayPacket::WIDTH];
+        vec2f normals[RayPacket::WIDTH];
+        const uint32_t aabb_lanes = segmentPacketEntryMaskAABB(packet, aabb);
+        const uint32_t piece_lanes = intersectRayPacketConvex(packet, piece, times, normals);
+        for (size_t lane = 0; lane < RayPacket::WIDTH; lane++) {
+            const vec2f origin(packet.origin_x[lane], packet.origin_y[lane]);
+            const vec2f dir(packet.dir_x[lane], packet.dir_y[lane]);
+            EXPECT_EQ((aabb_lanes >> lane) & 1U, segmentEntryTimeAABB(origin, dir, aabb) != INFINITY);
+            const auto expected = intersectRayConvex(origin, dir, piece);
+            ASSERT_EQ((piece_lanes >> lane) & 1U, expected.detected);
+            if (expected.detected) {
+                EXPECT_NEAR(times[lane], expected.time_hit, 1e-5f);
+                EXPECT_NEAR(normals[lane].x, expected.contact_normal.x, 1e-5f);
+                EXPECT_NEAR(normals[lane].y, expected.contact_normal.y, 1e-5f);
+            }
+        }
+    }
+    // disabled lanes never hit
+    RayPacket disabled{};
+    for (size_t lane = 0; lane < RayPacket::WIDTH; lane++) {
+        disabled.max_time[lane] = -1.f;
+    }
+    EXPECT_EQ(segmentPacketEntryMaskAABB(disabled, aabb), 0U);
+    float times[RayPacket::WIDTH];
+    vec2f normals[RayPacket::WIDTH];
+    EXPECT_EQ(intersectRayPacketConvex(disabled, piece, times, normals), 0U);
+}
+static float polygonArea(const std::vector<vec2f>& poly) {
+    float result = 0.f;
+    for (size_t i = 0; i < poly.size(); i++) {
+        result += perp_dot(poly[i], poly[(i + 1) % poly.size()]);
+    }
+    return fabsf(result) / 2.f;
+}
+TEST(GeometryTest, SubtractConvex) {
+    const std::vector<vec2f> box = {vec2f(0.f, 0.f), vec2f(4.f, 0.f), vec2f(4.f, 4.f), vec2f(0.f, 4.f)};
+    std::vector<std::vector<vec2f>> result;
+    // far away cutter leaves the piece alone
+    const std::vector<vec2f> far = {vec2f(10.f, 10.f), vec2f(11.f, 10.f), vec2f(11.f, 11.f)};
+    ASSERT_FALSE(subtractConvex(box, far, result));
+    ASSERT_TRUE(result.empty());
+
+    // hole in the middle, the rest is still the whole ring
+    const std::vector<vec2f> hole = {vec2f(1.f, 1.f), vec2f(1.f, 3.f), vec2f(3.f, 3.f), vec2f(3.f, 1.f)};
+    ASSERT_TRUE(subtractConvex(box, hole, result));
+    float area = 0.f;
+    for (const auto& piece : result) {
+        area += polygonArea(piece);
+    }
+    EXPECT_NEAR(area, 12.f, 1e-4f);
+
+    // cutting off the right half merges back into a single rectangle
+    result.clear();
+    const std::vector<vec2f> half = {vec2f(2.f, -1.f), vec2f(5.f, -1.f), vec2f(5.f, 5.f), vec2f(2.f, 5.f)};
+    ASSERT_TRUE(subtractConvex(box, half, result));
+    mergeConvexNeighbours(result);
+    ASSERT_EQ(result.size(), 1U);
+    EXPECT_NEAR(polygonArea(result.front()), 8.f, 1e-4f);
+}
+TEST(GeometryTest, MergeConvexNeighbours) {
+    // two boxes stacked on a wider one share only parts of its top edge
+    std::vector<std::vector<vec2f>> pieces = {
+            {vec2f(0.f, 0.f), vec2f(4.f, 0.f), vec2f(4.f, 1.f), vec2f(0.f, 1.f)},
+            {vec2f(0.f, 1.f), vec2f(2.f, 1.f), vec2f(2.f, 2.f), vec2f(0.f, 2.f)},
+            {vec2f(2.f, 1.f), vec2f(4.f, 1.f), vec2f(4.f, 2.f), vec2f(2.f, 2.f)},
+    };
+    EXPECT_TRUE(areConvexNeighbours(pieces[0], pieces[1]));
+    EXPECT_FALSE(areConvexNeighbours(
+            pieces[1], {vec2f(2.f, 2.f), vec2f(3.f, 2.f), vec2f(3.f, 3.f), vec2f(2.f, 3.f)}
+    ));
+    mergeConvexNeighbours(pieces);
+    ASSERT_EQ(pieces.size(), 1U);
+    EXPECT_NEAR(polygonArea(pieces.front()), 8.f, 1e-4f);
 }
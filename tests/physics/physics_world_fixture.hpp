@@ -0,0 +1,56 @@
+#ifndef EMP_TESTS_PHYSICS_WORLD_FIXTURE_HPP
+#define EMP_TESTS_PHYSICS_WORLD_FIXTURE_HPP
+#include <gtest/gtest.h>
+#include "core/coordinator.hpp"
+#include "physics/constraint.hpp"
+#include "physics/physics_system.hpp"
+#include "scene/transform.hpp"
+
+namespace emp {
+// coordinator with every system the physics update needs
+class PhysicsWorld {
+public:
+    static constexpr float DELTA_TIME = 1.f / 60.f;
+    Coordinator ECS;
+    PhysicsSystem* physics_sys = nullptr;
+    PhysicsWorld() {
+        ECS.registerComponent<Transform>();
+        ECS.registerComponent<Constraint>();
+        ECS.registerComponent<Material>();
+        ECS.registerComponent<Collider>();
+        ECS.registerComponent<Rigidbody>();
+        ECS.registerSystem<TransformSystem>();
+        ECS.registerSystem<RigidbodySystem>();
+        ECS.registerSystem<ColliderSystem>();
+        ECS.registerSystem<ConstraintSystem>();
+        physics_sys = &ECS.registerSystem<PhysicsSystem>();
+        ECS.addComponent(ECS.world(), Transform(vec2f(0.f, 0.f)));
+        physics_sys->gravity = vec2f(0.f, 1000.f);
+    }
+    Entity addBox(vec2f position, vec2f size, bool isStatic, float density = 1.f) {
+        const vec2f half = size / 2.f;
+        auto entity = ECS.createEntity();
+        ECS.addComponent(entity, Transform(position));
+        ECS.addComponent(entity, Collider({vec2f(-half.x, -half.y), vec2f(-half.x, half.y), half,
+                                           vec2f(half.x, -half.y)}));
+        ECS.addComponent(entity, Rigidbody(isStatic, false, true, density));
+        ECS.addComponent(entity, Material());
+        return entity;
+    }
+    // systems updated after physics with the same delta time
+    virtual void onTick(float) {}
+    void simulate(int tick_count) {
+        for (int i = 0; i < tick_count; i++) {
+            physics_sys->update(
+                    *ECS.getSystem<TransformSystem>(), *ECS.getSystem<ColliderSystem>(),
+                    *ECS.getSystem<RigidbodySystem>(), *ECS.getSystem<ConstraintSystem>(), DELTA_TIME
+            );
+            onTick(DELTA_TIME);
+        }
+    }
+    virtual ~PhysicsWorld() = default;
+};
+// tests derive from it and register the systems they exercise in their own SetUp
+class PhysicsWorldTest : public testing::Test, public PhysicsWorld {};
+}; // namespace emp
+#endif
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include "core/coordinator.hpp"
+#include "physics/collider.hpp"
+#include "physics/rigidbody.hpp"
+#include "scene/transform.hpp"
+
+using namespace emp;
+class CollisionEventsTest : public testing::Test {
+protected:
+    Coordinator ECS;
+    ColliderSystem* col_sys;
+    Entity a, b, c;
+    int enter_count = 0;
+    int exit_count = 0;
+    void SetUp() override {
+        ECS.registerComponent<Transform>();
+        ECS.registerComponent<Collider>();
+        ECS.registerComponent<Rigidbody>();
+        ECS.registerSystem<TransformSystem>();
+        col_sys = &ECS.registerSystem<ColliderSystem>();
+        ECS.addComponent(ECS.world(), Transform(vec2f(0.f, 0.f)));
+        std::vector<vec2f> box = {{-1.f, -1.f}, {-1.f, 1.f}, {1.f, 1.f}, {1.f, -1.f}};
+        for (auto* e : {&a, &b, &c}) {
+            *e = ECS.createEntity();
+            ECS.addComponent(*e, Transform(vec2f(0.f, 0.f)));
+            Collider col(box);
+            col.isNonMoving = false;
+            ECS.addComponent(*e, col);
+        }
+        col_sys->onCollisionEnter(a, a, [&](const CollisionInfo& info) {
+            ASSERT_EQ(info.collider_entity, a);
+            enter_count++;
+        });
+        col_sys->onCollisionExit(a, a, [&](Entity me, Entity other) {
+            ASSERT_EQ(me, a);
+            exit_count++;
+        });
+    }
+    void notify(Entity e1, Entity e2) {
+        CollisionInfo info;
+        info.collider_entity = e1;
+        info.collidee_entity = e2;
+        col_sys->notifyOfCollision(e1, e2, info);
+    }
+};
+TEST_F(CollisionEventsTest, EnterOnceWhileColliding) {
+    notify(a, b);
+    notify(b, a);
+    col_sys->processCollisionNotifications();
+    ASSERT_EQ(enter_count, 1);
+    notify(b, a);
+    col_sys->processCollisionNotifications();
+    ASSERT_EQ(enter_count, 1);
+    ASSERT_EQ(exit_count, 0);
+}
+TEST_F(CollisionEventsTest, ExitAfterCollisionEnds) {
+    notify(a, b);
+    notify(a, c);
+    col_sys->processCollisionNotifications();
+    ASSERT_EQ(enter_count, 2);
+    notify(a, c);
+    col_sys->processCollisionNotifications();
+    ASSERT_EQ(exit_count, 1);
+    col_sys->processCollisionNotifications();
+    ASSERT_EQ(exit_count, 2);
+}
+TEST_F(CollisionEventsTest, SleepingPairKeepsColliding) {
+    notify(a, b);
+    col_sys->processCollisionNotifications();
+    ECS.getComponent<Collider>(a)->isNonMoving = true;
+    ECS.getComponent<Collider>(b)->isNonMoving = true;
+    col_sys->processCollisionNotifications();
+    ASSERT_EQ(exit_count, 0);
+    ECS.getComponent<Collider>(b)->isNonMoving = false;
+    col_sys->processCollisionNotifications();
+    ASSERT_EQ(exit_count, 1);
+}
+TEST(ColliderShapeTest, IdenticalOutlinesShareShape) {
+    std::vector<vec2f> box = {{-2.f, -2.f}, {-2.f, 2.f}, {2.f, 2.f}, {2.f, -2.f}};
+    const size_t before = ColliderShape::countInterned();
+    {
+        Collider a(box);
+        Collider b(box);
+        Collider centered(box, true);
+        ASSERT_EQ(a.shape(), b.shape());
+        ASSERT_NE(a.shape(), centered.shape());
+        ASSERT_EQ(Collider::CreateCircle(3.f).shape(), Collider::CreateCircle(3.f).shape());
+        ASSERT_NE(Collider::CreateCircle(3.f).shape(), Collider::CreateCircle(4.f).shape());
+        ASSERT_EQ(ColliderShape::countInterned(), before + 2);
+    }
+    // shapes are released together with their last collider
+    ASSERT_EQ(ColliderShape::countInterned(), before);
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "physics/fluid_system.hpp"
+#include "physics_world_fixture.hpp"
+#include "utils/time.hpp"
+
+using namespace emp;
+class FluidTest : public PhysicsWorldTest {
+protected:
+    FluidSystem* fluid_sys;
+    static constexpr float FLOOR = 200.f;
+    static constexpr float WIDTH = 200.f;
+    void SetUp() override {
+        PhysicsWorldTest::SetUp();
+        fluid_sys = &ECS.registerSystem<FluidSystem>(std::ref(physics_sys->threadPool()));
+        fluid_sys->gravity = physics_sys->gravity;
+        addBox(vec2f(WIDTH / 2.f, FLOOR + 50.f), vec2f(WIDTH + 200.f, 100.f), true);
+        addBox(vec2f(-50.f, FLOOR / 2.f), vec2f(100.f, FLOOR + 200.f), true);
+        addBox(vec2f(WIDTH + 50.f, FLOOR / 2.f), vec2f(100.f, FLOOR + 200.f), true);
+        fluid_sys->addBlock(AABB::CreateMinMax(vec2f(0.f, FLOOR - 60.f), vec2f(WIDTH, FLOOR)));
+    }
+    void onTick(float delT) override {
+        fluid_sys->update(delT);
+    }
+};
+TEST_F(FluidTest, StaysInsideContainer) {
+    const size_t count = fluid_sys->particleCount();
+    simulate(120);
+    ASSERT_EQ(fluid_sys->particleCount(), count);
+    const auto& particles = fluid_sys->particles();
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_TRUE(std::isfinite(particles.pos_x[i]) && std::isfinite(particles.pos_y[i]));
+        ASSERT_GT(particles.pos_x[i], 0.f);
+        ASSERT_LT(particles.pos_x[i], WIDTH);
+        ASSERT_LT(particles.pos_y[i], FLOOR);
+    }
+}
+TEST_F(FluidTest, LightBodiesFloatAndHeavyOnesSink) {
+    auto light = addBox(vec2f(50.f, 100.f), vec2f(40.f, 40.f), false, 0.3f);
+    auto heavy = addBox(vec2f(150.f, 100.f), vec2f(40.f, 40.f), false, 3.f);
+    simulate(300);
+    // surface of the fluid is about 60 above the floor
+    const float surface = FLOOR - 60.f;
+    const float light_top = ECS.getComponent<Transform>(light)->position.y - 20.f;
+    const float heavy_top = ECS.getComponent<Transform>(heavy)->position.y - 20.f;
+    ASSERT_LT(light_top, surface - 10.f);
+    ASSERT_GT(heavy_top, surface);
+}
+TEST_F(FluidTest, SpreadOutParticlesCollideInTimeOfTheirCount) {
+    // bounds of the fluid span about 6 * 10^7 cells, most of them under the block
+    fluid_sys->clear();
+    fluid_sys->addParticle(vec2f(-40000.f, -40000.f));
+    fluid_sys->addParticle(vec2f(44990.f, 5000.f));
+    auto block = addBox(vec2f(5000.f, 5000.f), vec2f(80000.f, 80000.f), true);
+    ECS.getSystem<TransformSystem>()->update();
+    Stopwatch clock;
+    fluid_sys->update(DELTA_TIME);
+    ASSERT_LT(clock.stop(), 0.1);
+    ASSERT_EQ(fluid_sys->particleCount(), 2U);
+    // particle under the block is still pushed out of it
+    const auto& particles = fluid_sys->particles();
+    const AABB block_area = AABB::CreateCenterSize(ECS.getComponent<Transform>(block)->position, vec2f(80000.f));
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_FALSE(isOverlappingPointAABB(vec2f(particles.pos_x[i], particles.pos_y[i]), block_area));
+    }
+}
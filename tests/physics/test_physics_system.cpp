@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "physics_world_fixture.hpp"
+
+using namespace emp;
+// boxes hanging from hinges, big enough to be solved as a colored island,
+// a short chain solved as a small island and a pile falling onto a floor
+static std::vector<Entity> buildHangingScene(PhysicsWorld& world, size_t link_count) {
+    auto& ECS = world.ECS;
+    std::vector<Entity> bodies;
+    world.addBox(vec2f(0.f, 500.f), vec2f(4000.f, 40.f), true);
+    for (int i = 0; i < 6; i++) {
+        bodies.push_back(world.addBox(vec2f(-300.f + i * 3.f, 400.f - i * 50.f), vec2f(40.f, 40.f), false));
+    }
+    for (auto [start, count] : {std::pair{0.f, link_count}, std::pair{-800.f, size_t(4)}}) {
+        auto anchor = ECS.createEntity();
+        ECS.addComponent(anchor, Transform(vec2f(start, 0.f)));
+        Entity prev = anchor;
+        for (size_t i = 0; i < count; i++) {
+            auto link = world.addBox(vec2f(start + (i + 1) * 12.f, 0.f), vec2f(10.f, 4.f), false);
+            auto builder = Constraint::Builder();
+            if (prev == anchor) {
+                builder.addAnchorEntity(anchor, *ECS.getComponent<Transform>(anchor));
+            } else {
+                builder.addConstrainedEntity(prev, *ECS.getComponent<Transform>(prev));
+            }
+            auto constraint = builder.setHinge(vec2f(start + i * 12.f + 6.f, 0.f))
+                                      .addConstrainedEntity(link, *ECS.getComponent<Transform>(link))
+                                      .build();
+            ECS.addComponent(ECS.createEntity(), constraint);
+            bodies.push_back(link);
+            prev = link;
+        }
+    }
+    return bodies;
+}
+TEST(PhysicsSystemTest, SameSceneGivesSameResult) {
+    PhysicsWorld first;
+    PhysicsWorld second;
+    // triangulation of colliders starts at a random vertex, which changes
+    // their inertia in the last bits
+    std::srand(0);
+    const auto first_bodies = buildHangingScene(first, 160);
+    std::srand(0);
+    const auto second_bodies = buildHangingScene(second, 160);
+    first.simulate(30);
+    second.simulate(30);
+    ASSERT_EQ(first_bodies, second_bodies);
+    for (auto body : first_bodies) {
+        const auto& trans1 = *first.ECS.getComponent<Transform>(body);
+        const auto& trans2 = *second.ECS.getComponent<Transform>(body);
+        ASSERT_EQ(trans1.position, trans2.position);
+        ASSERT_EQ(trans1.rotation, trans2.rotation);
+    }
+}
+TEST_F(PhysicsWorldTest, FastBodyStopsAtThinWall) {
+    physics_sys->gravity = vec2f(0.f, 0.f);
+    const float wall_face = 58.f;
+    addBox(vec2f(wall_face + 2.f, 0.f), vec2f(4.f, 200.f), true);
+    auto bullet = addBox(vec2f(0.f, 0.f), vec2f(4.f, 4.f), false);
+    auto& rigidbody = *ECS.getComponent<Rigidbody>(bullet);
+    rigidbody.useContinuousCollision = true;
+    // every substep moves it further than wall and bullet are thick together
+    rigidbody.velocity = vec2f(6000.f, 0.f);
+    ASSERT_GT(rigidbody.velocity.x * DELTA_TIME / static_cast<float>(physics_sys->substep_count), 8.f);
+    simulate(1);
+    const float bullet_face = ECS.getComponent<Transform>(bullet)->position.x + 2.f;
+    ASSERT_LT(bullet_face, wall_face + 0.5f);
+    ASSERT_GT(bullet_face, wall_face - 1.f);
+}
+// three boxes stacked on a floor and one lying on its own far away from them
+class SleepTest : public PhysicsWorldTest {
+protected:
+    std::vector<Entity> pile;
+    Entity lone;
+    void SetUp() override {
+        addBox(vec2f(0.f, 100.f), vec2f(800.f, 20.f), true);
+        for (int i = 0; i < 3; i++) {
+            pile.push_back(addBox(vec2f(0.f, 80.f - i * 20.f), vec2f(20.f, 20.f), false));
+        }
+        lone = addBox(vec2f(300.f, 80.f), vec2f(20.f, 20.f), false);
+        simulate(static_cast<int>(2.f * PhysicsSystem::DORMANT_TIME_THRESHOLD / DELTA_TIME));
+    }
+};
+TEST_F(SleepTest, SettledPileFallsAsleep) {
+    for (auto body : pile) {
+        ASSERT_TRUE(physics_sys->isSleeping(body));
+        ASSERT_TRUE(ECS.getComponent<Collider>(body)->isNonMoving);
+    }
+    ASSERT_TRUE(physics_sys->isSleeping(lone));
+    // nothing is left in the quad tree to be paired
+    ASSERT_EQ(physics_sys->islandCount(), 0U);
+}
+TEST_F(SleepTest, BodyDroppedOnPileWakesWholeIsland) {
+    auto dropped = addBox(vec2f(0.f, 15.f), vec2f(20.f, 20.f), false);
+    ECS.getComponent<Rigidbody>(dropped)->velocity = vec2f(0.f, 300.f);
+    simulate(3);
+    for (auto body : pile) {
+        ASSERT_FALSE(physics_sys->isSleeping(body));
+        ASSERT_FALSE(ECS.getComponent<Collider>(body)->isNonMoving);
+    }
+    ASSERT_TRUE(physics_sys->isSleeping(lone));
+}
+TEST_F(SleepTest, ForceOnOneMemberWakesWholeIsland) {
+    ECS.getComponent<Rigidbody>(pile.front())->force = vec2f(1000.f, 0.f);
+    simulate(1);
+    for (auto body : pile) {
+        ASSERT_FALSE(physics_sys->isSleeping(body));
+    }
+    ASSERT_TRUE(physics_sys->isSleeping(lone));
+}
+TEST_F(PhysicsWorldTest, RadialFieldPushesAwayFromCenterInsideItsArea) {
+    physics_sys->gravity = vec2f(0.f, 0.f);
+    physics_sys->force_fields.push_back(ForceField::Radial(vec2f(0.f, 0.f), 100.f, 100000.f));
+    auto right = addBox(vec2f(40.f, 0.f), vec2f(10.f, 10.f), false);
+    auto below_left = addBox(vec2f(-30.f, 30.f), vec2f(10.f, 10.f), false);
+    auto outside = addBox(vec2f(300.f, 0.f), vec2f(10.f, 10.f), false);
+    simulate(10);
+    const vec2f right_pos = ECS.getComponent<Transform>(right)->position;
+    ASSERT_GT(right_pos.x, 40.5f);
+    ASSERT_NEAR(right_pos.y, 0.f, 1e-3f);
+    const vec2f below_left_pos = ECS.getComponent<Transform>(below_left)->position;
+    ASSERT_LT(below_left_pos.x, -30.5f);
+    ASSERT_GT(below_left_pos.y, 30.5f);
+    ASSERT_EQ(ECS.getComponent<Transform>(outside)->position, vec2f(300.f, 0.f));
+    ASSERT_EQ(ECS.getComponent<Rigidbody>(outside)->velocity, vec2f(0.f, 0.f));
+}
+// of a box with density 1 around its center
+static float boxInertia(float width, float height) {
+    return width * height * (width * width + height * height) / 12.f;
+}
+TEST_F(PhysicsWorldTest, CarvingBarInTwoSplitsIt) {
+    physics_sys->gravity = vec2f(0.f, 0.f);
+    auto bar = addBox(vec2f(0.f, 0.f), vec2f(200.f, 20.f), false);
+    simulate(1);
+    auto& rigidbody = *ECS.getComponent<Rigidbody>(bar);
+    rigidbody.useAutomaticMass = false;
+    rigidbody.real_mass = 100.f;
+    rigidbody.real_inertia = 1000.f;
+    rigidbody.velocity = vec2f(10.f, 0.f);
+    rigidbody.angular_velocity = 1.f;
+    const vec2f bar_position = ECS.getComponent<Transform>(bar)->position;
+
+    // removes x in [-5, 5] from the middle of the bar
+    std::vector<Entity> fragments;
+    physics_sys->carve(
+            {bar_position + vec2f(-5.f, -50.f), bar_position + vec2f(-5.f, 50.f),
+             bar_position + vec2f(5.f, 50.f), bar_position + vec2f(5.f, -50.f)},
+            fragments
+    );
+    ASSERT_EQ(fragments.size(), 1U);
+    ASSERT_TRUE(ECS.isEntityAlive(bar));
+    ASSERT_NE(fragments[0], bar);
+    const float half_area = 95.f * 20.f;
+    for (auto piece : {bar, fragments[0]}) {
+        const auto& piece_rb = *ECS.getComponent<Rigidbody>(piece);
+        const auto& piece_col = *ECS.getComponent<Collider>(piece);
+        const vec2f offset = ECS.getComponent<Transform>(piece)->position - bar_position;
+        ASSERT_NEAR(piece_col.mass_properties().area, half_area, 1e-2f);
+        // the removed strip takes its part of the mass with it
+        ASSERT_NEAR(piece_rb.real_mass, 100.f * 95.f / 200.f, 1e-3f);
+        ASSERT_NEAR(piece_rb.real_inertia, 1000.f * boxInertia(95.f, 20.f) / boxInertia(200.f, 20.f), 1e-2f);
+        // each half is centered on its own origin on the far side of the cut
+        ASSERT_NEAR(std::abs(offset.x), 52.5f, 1e-3f);
+        ASSERT_NEAR(offset.y, 0.f, 1e-3f);
+        ASSERT_NEAR(piece_col.mass_properties().centroid.x, 0.f, 1e-3f);
+        // keeps the velocity its centroid had on the spinning bar
+        ASSERT_NEAR(piece_rb.velocity.x, 10.f, 1e-3f);
+        ASSERT_NEAR(piece_rb.velocity.y, offset.x, 1e-3f);
+        ASSERT_EQ(piece_rb.angular_velocity, 1.f);
+    }
+}
+TEST_F(PhysicsWorldTest, CarvingHoleLowersManualMass) {
+    physics_sys->gravity = vec2f(0.f, 0.f);
+    auto bar = addBox(vec2f(0.f, 0.f), vec2f(200.f, 20.f), false);
+    simulate(1);
+    auto& rigidbody = *ECS.getComponent<Rigidbody>(bar);
+    rigidbody.useAutomaticMass = false;
+    rigidbody.real_mass = 100.f;
+    rigidbody.real_inertia = 1000.f;
+    const vec2f bar_position = ECS.getComponent<Transform>(bar)->position;
+
+    // removes a 10 by 10 square from the middle without splitting the bar
+    std::vector<Entity> fragments;
+    physics_sys->carve(
+            {bar_position + vec2f(-5.f, -5.f), bar_position + vec2f(-5.f, 5.f),
+             bar_position + vec2f(5.f, 5.f), bar_position + vec2f(5.f, -5.f)},
+            fragments
+    );
+    ASSERT_TRUE(fragments.empty());
+    const auto& carved_rb = *ECS.getComponent<Rigidbody>(bar);
+    const auto& carved_col = *ECS.getComponent<Collider>(bar);
+    ASSERT_NEAR(carved_col.mass_properties().area, 3900.f, 1e-2f);
+    ASSERT_NEAR(carved_rb.real_mass, 100.f * 3900.f / 4000.f, 1e-3f);
+    const float kept_inertia = boxInertia(200.f, 20.f) - boxInertia(10.f, 10.f);
+    ASSERT_NEAR(carved_rb.real_inertia, 1000.f * kept_inertia / boxInertia(200.f, 20.f), 1e-2f);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "physics/rigidbody.hpp"
+
+using namespace emp;
+// odd count so both vectorized and scalar paths are used
+static RigidbodySoA makeBodies(size_t count) {
+    RigidbodySoA bodies;
+    bodies.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const float f = static_cast<float>(i);
+        bodies.pos_x[i] = f;
+        bodies.pos_y[i] = -f;
+        bodies.rot[i] = f * 0.1f;
+        bodies.vel_x[i] = 1.f;
+        bodies.vel_y[i] = f;
+        bodies.ang_vel[i] = 0.5f;
+        bodies.force_x[i] = 2.f * f;
+        bodies.force_y[i] = 10.f;
+        bodies.torque[i] = 1.f;
+        bodies.inv_mass[i] = 1.f / (f + 1.f);
+        bodies.inv_inertia[i] = i % 2 == 0 ? 0.f : 0.5f;
+    }
+    return bodies;
+}
+TEST(RigidbodySoATest, IntegrateMatchesScalar) {
+    const float delT = 0.01f;
+    auto bodies = makeBodies(19);
+    const auto before = bodies;
+    integrateSoA(bodies, delT);
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const float vel_x = before.vel_x[i] + delT * before.force_x[i] * before.inv_mass[i];
+        const float ang_vel = before.ang_vel[i] + delT * before.torque[i] * before.inv_inertia[i];
+        ASSERT_FLOAT_EQ(bodies.vel_x[i], vel_x);
+        ASSERT_FLOAT_EQ(bodies.prev_pos_x[i], before.pos_x[i]);
+        ASSERT_FLOAT_EQ(bodies.pos_x[i], before.pos_x[i] + vel_x * delT);
+        ASSERT_FLOAT_EQ(bodies.ang_vel[i], ang_vel);
+        ASSERT_FLOAT_EQ(bodies.rot[i], before.rot[i] + ang_vel * delT);
+    }
+}
+TEST(RigidbodySoATest, DeriveVelocitiesInvertsIntegration) {
+    const float delT = 0.5f;
+    auto bodies = makeBodies(13);
+    integrateSoA(bodies, delT);
+    const auto integrated = bodies;
+    deriveVelocitiesSoA(bodies, delT);
+    for (size_t i = 0; i < bodies.size(); i++) {
+        ASSERT_NEAR(bodies.vel_x[i], integrated.vel_x[i], 1e-4f);
+        ASSERT_NEAR(bodies.vel_y[i], integrated.vel_y[i], 1e-4f);
+        ASSERT_NEAR(bodies.ang_vel[i], integrated.ang_vel[i], 1e-4f);
+    }
+}
+TEST(RigidbodySoATest, StepScaleAdvancesSeveralSubsteps) {
+    const float delT = 0.01f;
+    auto bodies = makeBodies(11);
+    for (size_t i = 0; i < bodies.size(); i++) {
+        bodies.step_scale[i] = i % 2 == 0 ? 1.f : 4.f;
+    }
+    const auto before = bodies;
+    integrateSoA(bodies, delT);
+    for (size_t i = 0; i < bodies.size(); i++) {
+        // forces act over a single substep regardless of the scale
+        const float vel_y = before.vel_y[i] + delT * before.force_y[i] * before.inv_mass[i];
+        ASSERT_FLOAT_EQ(bodies.vel_y[i], vel_y);
+        ASSERT_NEAR(bodies.pos_y[i], before.pos_y[i] + vel_y * delT * before.step_scale[i], 1e-4f);
+    }
+    const auto integrated = bodies;
+    deriveVelocitiesSoA(bodies, delT);
+    for (size_t i = 0; i < bodies.size(); i++) {
+        ASSERT_NEAR(bodies.vel_y[i], integrated.vel_y[i], 1e-3f);
+    }
+}
+// 15 bodies run 8 through avx, 4 through sse and 3 through the scalar loop
+TEST(RigidbodySoATest, EverySimdLevelMatchesScalar) {
+    const float delT = 0.01f;
+    auto scalar = makeBodies(15);
+    integrateSoA(scalar, delT, 0, scalar.size(), eSimdLevel::Scalar);
+    auto derived_scalar = scalar;
+    deriveVelocitiesSoA(derived_scalar, delT, 0, scalar.size(), eSimdLevel::Scalar);
+    for (auto level : {eSimdLevel::SSE, eSimdLevel::AVX}) {
+        if (level > supportedSimdLevel()) {
+            continue;
+        }
+        auto bodies = makeBodies(15);
+        integrateSoA(bodies, delT, 0, bodies.size(), level);
+        for (size_t i = 0; i < bodies.size(); i++) {
+            ASSERT_FLOAT_EQ(bodies.pos_x[i], scalar.pos_x[i]);
+            ASSERT_FLOAT_EQ(bodies.pos_y[i], scalar.pos_y[i]);
+            ASSERT_FLOAT_EQ(bodies.rot[i], scalar.rot[i]);
+            ASSERT_FLOAT_EQ(bodies.vel_y[i], scalar.vel_y[i]);
+            ASSERT_FLOAT_EQ(bodies.prev_pos_y[i], scalar.prev_pos_y[i]);
+        }
+        deriveVelocitiesSoA(bodies, delT, 0, bodies.size(), level);
+        for (size_t i = 0; i < bodies.size(); i++) {
+            ASSERT_FLOAT_EQ(bodies.vel_x[i], derived_scalar.vel_x[i]);
+            ASSERT_FLOAT_EQ(bodies.ang_vel[i], derived_scalar.ang_vel[i]);
+        }
+    }
+}
+TEST(RigidbodySoATest, RangeLeavesOtherBodiesUntouched) {
+    auto bodies = makeBodies(20);
+    const auto before = bodies;
+    integrateSoA(bodies, 0.01f, 3, 14);
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const bool isInRange = i >= 3 && i < 14;
+        ASSERT_EQ(bodies.pos_y[i] != before.pos_y[i], isInRange);
+    }
+}
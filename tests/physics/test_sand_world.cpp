@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "physics/sand_world.hpp"
+
+using namespace emp;
+static int countOf(const SandWorld& world, uint8_t material) {
+    int result = 0;
+    for (int y = 0; y < world.height(); y++) {
+        for (int x = 0; x < world.width(); x++) {
+            result += world.get(x, y) == material;
+        }
+    }
+    return result;
+}
+// column of water in every x of [first_x, last_x]
+static std::vector<int> waterHeights(const SandWorld& world, int first_x, int last_x) {
+    std::vector<int> result;
+    for (int x = first_x; x <= last_x; x++) {
+        int height = 0;
+        for (int y = 0; y < world.height(); y++) {
+            height += world.get(x, y) == SandWorld::WATER;
+        }
+        result.push_back(height);
+    }
+    return result;
+}
+class SandWorldTest : public testing::Test {
+protected:
+    ThreadPool thread_pool{std::max(std::thread::hardware_concurrency(), 1U) - 1U};
+};
+TEST_F(SandWorldTest, SandPilesAcrossChunksAndSleeps) {
+    SandWorld world(128, 128, thread_pool);
+    world.fill(0, 127, 128, 1, SandWorld::STONE);
+    // falls on the border between two chunks
+    world.fill(60, 0, 8, 20, SandWorld::SAND);
+    for (int i = 0; i < 400; i++) {
+        world.step();
+    }
+    ASSERT_EQ(countOf(world, SandWorld::SAND), 8 * 20);
+    for (int y = 0; y < 127; y++) {
+        for (int x = 0; x < 128; x++) {
+            if (world.get(x, y) == SandWorld::SAND) {
+                ASSERT_NE(world.get(x, y + 1), SandWorld::EMPTY);
+            }
+        }
+    }
+    // pile spreads to both sides
+    ASSERT_EQ(world.get(56, 126), SandWorld::SAND);
+    ASSERT_EQ(world.get(71, 126), SandWorld::SAND);
+    ASSERT_EQ(world.activeChunkCount(), 0U);
+    ASSERT_EQ(world.pixels()[126 * 128 + 64].alpha, 255);
+}
+TEST_F(SandWorldTest, WaterLevelsOut) {
+    SandWorld world(160, 64, thread_pool);
+    world.fill(0, 63, 160, 1, SandWorld::STONE);
+    world.fill(0, 0, 1, 64, SandWorld::STONE);
+    world.fill(159, 0, 1, 64, SandWorld::STONE);
+    world.fill(1, 23, 40, 40, SandWorld::WATER);
+    for (int i = 0; i < 1500; i++) {
+        world.step();
+    }
+    ASSERT_EQ(countOf(world, SandWorld::WATER), 40 * 40);
+    const auto heights = waterHeights(world, 1, 158);
+    const auto [min, max] = std::minmax_element(heights.begin(), heights.end());
+    ASSERT_LE(*max - *min, 1);
+}
+TEST_F(SandWorldTest, HeavierMaterialsSink) {
+    SandWorld world(64, 64, thread_pool);
+    world.fill(0, 63, 64, 1, SandWorld::STONE);
+    world.fill(0, 43, 64, 20, SandWorld::OIL);
+    world.fill(0, 33, 64, 10, SandWorld::WATER);
+    world.fill(0, 28, 64, 5, SandWorld::SAND);
+    world.fill(0, 0, 64, 10, SandWorld::SMOKE);
+    for (int i = 0; i < 1000; i++) {
+        world.step();
+    }
+    for (int x = 0; x < 64; x++) {
+        ASSERT_EQ(world.get(x, 62), SandWorld::SAND);
+        ASSERT_EQ(world.get(x, 52), SandWorld::WATER);
+        ASSERT_EQ(world.get(x, 40), SandWorld::OIL);
+        ASSERT_EQ(world.get(x, 0), SandWorld::SMOKE);
+    }
+}
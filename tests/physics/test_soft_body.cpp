@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "physics/soft_body.hpp"
+#include "physics_world_fixture.hpp"
+
+using namespace emp;
+class SoftBodyTest : public PhysicsWorldTest {
+protected:
+    SoftBodySystem* soft_body_sys;
+    static constexpr float FLOOR = 200.f;
+    void SetUp() override {
+        PhysicsWorldTest::SetUp();
+        ECS.registerComponent<SoftBody>();
+        soft_body_sys = &ECS.registerSystem<SoftBodySystem>(std::ref(physics_sys->threadPool()));
+        soft_body_sys->gravity = physics_sys->gravity;
+        addBox(vec2f(0.f, FLOOR + 50.f), vec2f(400.f, 100.f), true);
+    }
+    SoftBody& addSoftBody(SoftBody body) {
+        auto entity = ECS.createEntity();
+        ECS.addComponent(entity, std::move(body));
+        return *ECS.getComponent<SoftBody>(entity);
+    }
+    void onTick(float delT) override {
+        soft_body_sys->update(delT);
+    }
+};
+TEST_F(SoftBodyTest, PinnedRopeHangsWithoutStretching) {
+    auto& rope = addSoftBody(SoftBody::CreateRope(vec2f(0.f, 0.f), vec2f(100.f, 0.f), 20, 1.f));
+    rope.pin(0);
+    simulate(300);
+    float rope_length = 0.f;
+    for (size_t i = 0; i + 1U < rope.particleCount(); i++) {
+        rope_length += length(rope.positions[i + 1U] - rope.positions[i]);
+    }
+    ASSERT_EQ(rope.positions[0], vec2f(0.f, 0.f));
+    ASSERT_LT(rope_length, 105.f);
+    // swung down and hangs below the pin
+    ASSERT_GT(rope.positions.back().y, 90.f);
+    ASSERT_LT(std::abs(rope.positions.back().x), 10.f);
+}
+TEST_F(SoftBodyTest, JellyRestsOnFloorAndKeepsArea) {
+    auto& jelly = addSoftBody(SoftBody::CreateJelly(
+            AABB::CreateMinMax(vec2f(-40.f, 0.f), vec2f(40.f, 80.f)), 9, 9, 1.f, 1e-6f
+    ));
+    auto total_area = [&]() {
+        float result = 0.f;
+        for (const auto& area : jelly.areas()) {
+            const vec2f a = jelly.positions[area.a];
+            result += 0.5f * perp_dot(jelly.positions[area.b] - a, jelly.positions[area.c] - a);
+        }
+        return result;
+    };
+    const float rest_area = total_area();
+    simulate(300);
+    for (auto position : jelly.positions) {
+        ASSERT_TRUE(std::isfinite(position.x) && std::isfinite(position.y));
+        ASSERT_LT(position.y, FLOOR);
+    }
+    ASSERT_GT(jelly.aabb().max.y, FLOOR - 10.f);
+    ASSERT_NEAR(total_area(), rest_area, rest_area * 0.2f);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <optional>
+#include "core/coordinator.hpp"
+#include "math/shapes/ray.hpp"
+#include "physics/tilemap_collider.hpp"
+#include "physics_world_fixture.hpp"
+#include "scene/transform.hpp"
+
+using namespace emp;
+class TilemapColliderTest : public testing::Test {
+protected:
+    Coordinator ECS;
+    TilemapSystem* tile_sys;
+    Entity map;
+    std::vector<AABB> changed;
+    void SetUp() override {
+        ECS.registerComponent<Transform>();
+        ECS.registerComponent<TilemapCollider>();
+        ECS.registerSystem<TransformSystem>();
+        tile_sys = &ECS.registerSystem<TilemapSystem>();
+        ECS.addComponent(ECS.world(), Transform(vec2f(0.f, 0.f)));
+        map = ECS.createEntity();
+        ECS.addComponent(map, Transform(vec2f(0.f, 0.f)));
+        TilemapCollider tiles(40, 20, 1.f);
+        tiles.fill(0, 0, 40, 4, true);
+        tiles.fill(5, 4, 3, 7, true);
+        ECS.addComponent(map, tiles);
+        ECS.getSystem<TransformSystem>()->update();
+        tile_sys->update(changed);
+    }
+    TilemapCollider& tiles() {
+        return *ECS.getComponent<TilemapCollider>(map);
+    }
+};
+TEST_F(TilemapColliderTest, RectsCoverSolidTilesOnce) {
+    std::vector<int> covered(40 * 20, 0);
+    size_t rect_count = 0;
+    for (size_t c = 0; c < tiles().chunkCount(); c++) {
+        for (const auto& rect : tiles().rects(c)) {
+            rect_count++;
+            for (int y = rect.y; y < rect.y + rect.height; y++) {
+                for (int x = rect.x; x < rect.x + rect.width; x++) {
+                    covered[y * 40 + x]++;
+                }
+            }
+        }
+    }
+    for (int y = 0; y < 20; y++) {
+        for (int x = 0; x < 40; x++) {
+            ASSERT_EQ(covered[y * 40 + x], tiles().isSolid(x, y) ? 1 : 0);
+        }
+    }
+    // floor is only split by chunk borders
+    ASSERT_EQ(rect_count, 4U);
+}
+TEST_F(TilemapColliderTest, OnlyChangedChunksAreRebuilt) {
+    changed.clear();
+    tile_sys->update(changed);
+    ASSERT_TRUE(changed.empty());
+    tiles().setSolid(20, 2, false);
+    tile_sys->update(changed);
+    ASSERT_EQ(changed.size(), 1U);
+    std::vector<size_t> found;
+    tiles().forEachPieceIn(AABB::CreateMinMax(vec2f(20.2f, 2.2f), vec2f(20.8f, 2.8f)),
+                           [&](size_t piece, const AABB&) { found.push_back(piece); });
+    ASSERT_TRUE(found.empty());
+    tiles().forEachPieceIn(AABB::CreateMinMax(vec2f(6.2f, 8.2f), vec2f(6.8f, 8.8f)),
+                           [&](size_t piece, const AABB&) { found.push_back(piece); });
+    ASSERT_EQ(found.size(), 1U);
+}
+// ground of a tilemap seen through the queries of PhysicsSystem
+class TilemapQueryTest : public PhysicsWorldTest {
+protected:
+    Entity map;
+    void SetUp() override {
+        ECS.registerComponent<TilemapCollider>();
+        ECS.registerSystem<TilemapSystem>();
+        map = ECS.createEntity();
+        ECS.addComponent(map, Transform(vec2f(0.f, 0.f)));
+        TilemapCollider tiles(40, 20, 10.f);
+        tiles.fill(0, 10, 40, 10, true);
+        ECS.addComponent(map, tiles);
+        ECS.addComponent(map, Collider());
+        ECS.addComponent(map, Rigidbody(true));
+        ECS.addComponent(map, Material());
+        simulate(1);
+    }
+};
+TEST_F(TilemapQueryTest, RaycastHitsTiles) {
+    const auto hit = physics_sys->raycast(vec2f(55.f, 0.f), vec2f(0.f, 300.f));
+    ASSERT_TRUE(hit.has_value());
+    ASSERT_EQ(hit->entity, map);
+    ASSERT_NEAR(hit->time, 1.f / 3.f, 1e-4f);
+    ASSERT_NEAR(hit->point.y, 100.f, 1e-2f);
+    ASSERT_NEAR(hit->normal.y, -1.f, 1e-4f);
+    ASSERT_FALSE(physics_sys->raycast(vec2f(55.f, 0.f), vec2f(0.f, 90.f)).has_value());
+
+    const Ray rays[] = {Ray::CreatePositionDirection(vec2f(55.f, 0.f), vec2f(0.f, 300.f)),
+                        Ray::CreatePositionDirection(vec2f(255.f, 50.f), vec2f(0.f, 100.f))};
+    std::optional<PhysicsSystem::RaycastHit> hits[2];
+    physics_sys->raycastBatch(rays, hits);
+    for (const auto& batch_hit : hits) {
+        ASSERT_TRUE(batch_hit.has_value());
+        ASSERT_EQ(batch_hit->entity, map);
+        ASSERT_NEAR(batch_hit->point.y, 100.f, 1e-2f);
+    }
+}
+TEST_F(TilemapQueryTest, OverlapsFindTiles) {
+    std::vector<Entity> found;
+    physics_sys->overlapPoint(vec2f(55.f, 150.f), found);
+    ASSERT_EQ(found, std::vector<Entity>{map});
+    found.clear();
+    physics_sys->overlapPoint(vec2f(55.f, 50.f), found);
+    ASSERT_TRUE(found.empty());
+    physics_sys->overlapAABB(AABB::CreateMinMax(vec2f(10.f, 90.f), vec2f(30.f, 105.f)), found);
+    ASSERT_EQ(found, std::vector<Entity>{map});
+}
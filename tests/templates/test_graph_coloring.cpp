@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <utility>
+#include <vector>
+#include "templates/graph_coloring.hpp"
+
+using namespace emp;
+typedef std::pair<size_t, size_t> Edge;
+static auto forEachVertex = [](const Edge& edge, auto&& visit) {
+    visit(edge.first);
+    visit(edge.second);
+};
+TEST(GraphColoringTest, ColorsHaveNoSharedElements) {
+    std::vector<Edge> edges;
+    for (size_t i = 0; i < 10; i++) {
+        edges.push_back({i, i + 1});
+        edges.push_back({i, (i + 5) % 11});
+    }
+    GreedyColoring<16> coloring;
+    std::vector<size_t> offsets;
+    coloring.color(edges, offsets, forEachVertex);
+    ASSERT_GE(offsets.size(), 2U);
+    ASSERT_EQ(offsets.front(), 0U);
+    ASSERT_EQ(offsets.back(), edges.size());
+    for (size_t c = 0; c + 1 < offsets.size(); c++) {
+        std::vector<bool> used(16, false);
+        for (size_t i = offsets[c]; i < offsets[c + 1]; i++) {
+            ASSERT_FALSE(used[edges[i].first]);
+            ASSERT_FALSE(used[edges[i].second]);
+            used[edges[i].first] = true;
+            used[edges[i].second] = true;
+        }
+    }
+}
+TEST(GraphColoringTest, StarNeedsOneColorPerEdge) {
+    std::vector<Edge> edges;
+    for (size_t i = 1; i < 8; i++) {
+        edges.push_back({0, i});
+    }
+    GreedyColoring<8> coloring;
+    std::vector<size_t> offsets;
+    coloring.color(edges, offsets, forEachVertex);
+    ASSERT_EQ(offsets.size(), edges.size() + 1);
+    // coloring state is reset between calls
+    std::vector<Edge> disjoint = {{1, 2}, {3, 4}, {5, 6}};
+    coloring.color(disjoint, offsets, forEachVertex);
+    ASSERT_EQ(offsets.size(), 2U);
+    ASSERT_EQ(offsets[1], disjoint.size());
+}
+TEST(GraphColoringTest, OverflowColorCollectsTheRest) {
+    typedef GreedyColoring<2> Coloring_t;
+    std::vector<Edge> edges(Coloring_t::MAX_COLORS + 10, Edge{0, 1});
+    Coloring_t coloring;
+    std::vector<size_t> offsets;
+    coloring.color(edges, offsets, forEachVertex);
+    ASSERT_EQ(offsets.size(), Coloring_t::MAX_COLORS + 1);
+    ASSERT_EQ(
+            offsets[Coloring_t::OVERFLOW_COLOR + 1] -
+                    offsets[Coloring_t::OVERFLOW_COLOR],
+            11U
+    );
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+#include "templates/island_graph.hpp"
+
+using namespace emp;
+static std::vector<int> membersOf(const IslandGraph<16>& graph, int node) {
+    std::vector<int> result;
+    graph.forEachInIsland(node, [&](int member) { result.push_back(member); });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+TEST(IslandGraphTest, EdgesMergeIslands) {
+    IslandGraph<16> graph;
+    graph.addEdge(1, 2);
+    graph.addEdge(3, 4);
+    ASSERT_TRUE(graph.isConnected(1, 2));
+    ASSERT_FALSE(graph.isConnected(2, 3));
+    graph.addEdge(2, 3);
+    graph.addEdge(2, 3);
+    ASSERT_TRUE(graph.isConnected(1, 4));
+    ASSERT_EQ(graph.islandSize(4), 4);
+    ASSERT_EQ(membersOf(graph, 3), (std::vector<int>{1, 2, 3, 4}));
+    ASSERT_EQ(membersOf(graph, 5), (std::vector<int>{5}));
+}
+TEST(IslandGraphTest, SplitsOnlyAfterRemovedEdges) {
+    IslandGraph<16> graph;
+    // cycle 1-2-3-1 with a tail 3-4
+    graph.addEdge(1, 2);
+    graph.addEdge(2, 3);
+    graph.addEdge(3, 1);
+    graph.addEdge(3, 4);
+    graph.removeEdge(1, 2);
+    graph.split();
+    ASSERT_EQ(graph.islandSize(1), 4);
+
+    graph.removeEdge(3, 4);
+    // islands are split lazily
+    ASSERT_TRUE(graph.isConnected(1, 4));
+    graph.split();
+    ASSERT_FALSE(graph.isConnected(1, 4));
+    ASSERT_EQ(membersOf(graph, 1), (std::vector<int>{1, 2, 3}));
+    ASSERT_EQ(membersOf(graph, 4), (std::vector<int>{4}));
+}
+TEST(IslandGraphTest, RemovedNodeIsDetached) {
+    IslandGraph<16> graph;
+    graph.addEdge(1, 2);
+    graph.addEdge(2, 3);
+    graph.removeNode(2);
+    ASSERT_FALSE(graph.hasEdge(1, 2));
+    ASSERT_EQ(membersOf(graph, 2), (std::vector<int>{2}));
+    ASSERT_FALSE(graph.isConnected(1, 3));
+    graph.addEdge(2, 5);
+    ASSERT_EQ(membersOf(graph, 5), (std::vector<int>{2, 5}));
+}